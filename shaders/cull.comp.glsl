@@ -0,0 +1,229 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+struct ObjectData {
+    mat4 model;
+    vec4 bounding_sphere;
+    uint mesh_index;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+struct MeshData {
+    uint index_count;
+    uint first_index;
+    int vertex_offset;
+    uint command_offset;
+    uint first_meshlet;
+    uint meshlet_count;
+    uint padding0;
+    uint padding1;
+};
+
+struct MeshletData {
+    uint first_index;
+    uint triangle_count;
+    uint vertex_count;
+    uint padding;
+    vec4 bounding_sphere;
+    vec4 cone;
+};
+
+// Same layout as VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Meshes {
+    MeshData meshes[];
+};
+
+layout(std430, set = 0, binding = 2) writeonly buffer Commands {
+    DrawCommand commands[];
+};
+
+// One draw count per mesh, cleared before the dispatch
+layout(std430, set = 0, binding = 3) buffer Counts {
+    uint counts[];
+};
+
+layout(std430, set = 0, binding = 4) readonly buffer Meshlets {
+    MeshletData meshlets[];
+};
+
+// Clusters tested, culled by the frustum, culled by their cone, then the same in triangles. Then the objects of the late phase
+// tested against the depth pyramid, those it occluded and those drawn by it. Cleared before the first phase
+layout(std430, set = 0, binding = 5) buffer Statistics {
+    uint statistics[9];
+};
+
+// Whether each object passed the late phase, read from one and written to the other, swapped every frame
+layout(std430, set = 0, binding = 6) buffer VisibilityA {
+    uint visibility_a[];
+};
+
+layout(std430, set = 0, binding = 7) buffer VisibilityB {
+    uint visibility_b[];
+};
+
+// Farthest depth of each texel, built between the phases from the depth of the first one
+layout(set = 0, binding = 8) uniform sampler2D depth_pyramid;
+
+// Without a pyramid everything in the frustum is drawn at once. Otherwise the early phase draws the objects visible last
+// time, and the late phase tests the others against the pyramid of what the early phase drew
+const uint PHASE_ALL = 0;
+const uint PHASE_EARLY = 1;
+const uint PHASE_LATE = 2;
+
+layout(push_constant) uniform CullData {
+    mat4 view_projection;
+    vec4 camera_position;
+    vec2 pyramid_size;
+    uint pyramid_level_count;
+    uint object_count;
+    uint first_object;
+    uint phase;
+    uint visibility_parity;
+} cull;
+
+// Summed in shared memory first, so each workgroup only touches the statistics buffer once per counter
+shared uint group_statistics[9];
+
+// The same planes as Frustum::from_view_projection
+bool outside_frustum(vec3 center, float radius) {
+    mat4 rows = transpose(cull.view_projection);
+    vec4 planes[6] = vec4[6](rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2]);
+    for (int i = 0; i < 6; i++) {
+        if (dot(planes[i].xyz, center) + planes[i].w < -radius * length(planes[i].xyz))
+            return true;
+    }
+    return false;
+}
+
+// Conservative: the nearest depth of the sphere's bounding box against the farthest depth of the pyramid under its screen
+// rectangle, read at the level where the rectangle spans at most 2x2 texels
+bool occluded(vec3 center, float radius) {
+    vec2 rect_min = vec2(1.0);
+    vec2 rect_max = vec2(-1.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = cull.view_projection * vec4(corner, 1.0);
+        // Behind the camera the projection folds over, the object is kept
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        rect_min = min(rect_min, ndc.xy);
+        rect_max = max(rect_max, ndc.xy);
+        nearest = min(nearest, ndc.z);
+    }
+
+    vec2 uv_min = clamp(rect_min * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uv_max = clamp(rect_max * 0.5 + 0.5, 0.0, 1.0);
+    vec2 size = (uv_max - uv_min) * cull.pyramid_size;
+    int level = min(int(ceil(log2(max(max(size.x, size.y), 1.0)))), int(cull.pyramid_level_count) - 1);
+
+    ivec2 level_size = max(ivec2(cull.pyramid_size) >> level, ivec2(1));
+    ivec2 first = clamp(ivec2(uv_min * vec2(level_size)), ivec2(0), level_size - 1);
+    ivec2 last = clamp(ivec2(uv_max * vec2(level_size)), ivec2(0), level_size - 1);
+    float farthest = max(max(texelFetch(depth_pyramid, first, level).r, texelFetch(depth_pyramid, ivec2(last.x, first.y), level).r),
+        max(texelFetch(depth_pyramid, ivec2(first.x, last.y), level).r, texelFetch(depth_pyramid, last, level).r));
+    return nearest > farthest;
+}
+
+// A workgroup row per object along y, a thread per meshlet of its mesh along x
+void main() {
+    if (gl_LocalInvocationIndex < 9)
+        group_statistics[gl_LocalInvocationIndex] = 0;
+    barrier();
+
+    uint object_index = cull.first_object + gl_WorkGroupID.y;
+    uint meshlet_offset = gl_GlobalInvocationID.x;
+    if (object_index < cull.object_count) {
+        ObjectData object = objects[object_index];
+        MeshData mesh = meshes[object.mesh_index];
+        vec3 scales = vec3(length(object.model[0].xyz), length(object.model[1].xyz), length(object.model[2].xyz));
+        float scale = max(scales.x, max(scales.y, scales.z));
+
+        // The whole object first, all its meshlets share the answer
+        vec3 object_center = (object.model * vec4(object.bounding_sphere.xyz, 1.0)).xyz;
+        float object_radius = object.bounding_sphere.w * scale;
+        bool object_culled = outside_frustum(object_center, object_radius);
+
+        // Each object is tested in a single phase, objects the pyramid occludes not at all
+        bool tested = true;
+        if (cull.phase != PHASE_ALL) {
+            bool was_visible = (cull.visibility_parity == 0 ? visibility_a[object_index] : visibility_b[object_index]) != 0;
+            if (cull.phase == PHASE_EARLY) {
+                tested = was_visible;
+            } else {
+                bool object_occluded = !object_culled && occluded(object_center, object_radius);
+                tested = !was_visible && !object_occluded;
+                // What the early phase drew isn't tested again, but whether it is still visible is
+                if (meshlet_offset == 0) {
+                    uint visible = !object_culled && !object_occluded ? 1 : 0;
+                    if (cull.visibility_parity == 0)
+                        visibility_b[object_index] = visible;
+                    else
+                        visibility_a[object_index] = visible;
+                    if (!object_culled) {
+                        atomicAdd(group_statistics[6], 1);
+                        if (object_occluded)
+                            atomicAdd(group_statistics[7], 1);
+                        else if (!was_visible)
+                            atomicAdd(group_statistics[8], 1);
+                    }
+                }
+            }
+        }
+
+        if (tested && meshlet_offset < mesh.meshlet_count) {
+            MeshletData meshlet = meshlets[mesh.first_meshlet + meshlet_offset];
+            vec3 center = (object.model * vec4(meshlet.bounding_sphere.xyz, 1.0)).xyz;
+            bool frustum_culled = object_culled || outside_frustum(center, meshlet.bounding_sphere.w * scale);
+
+            // The cone is only carried over by rotations and uniform scales, a mirror would also flip the winding
+            bool cone_culled = false;
+            if (!frustum_culled && min(scales.x, min(scales.y, scales.z)) >= scale * 0.99 && determinant(mat3(object.model)) > 0.0) {
+                vec3 axis = normalize(mat3(object.model) * meshlet.cone.xyz);
+                vec3 to_center = center - cull.camera_position.xyz;
+                cone_culled = dot(to_center, axis) >= meshlet.cone.w * length(to_center) + meshlet.bounding_sphere.w * scale;
+            }
+
+            atomicAdd(group_statistics[0], 1);
+            atomicAdd(group_statistics[3], meshlet.triangle_count);
+            if (frustum_culled) {
+                atomicAdd(group_statistics[1], 1);
+                atomicAdd(group_statistics[4], meshlet.triangle_count);
+            } else if (cone_culled) {
+                atomicAdd(group_statistics[2], 1);
+                atomicAdd(group_statistics[5], meshlet.triangle_count);
+            } else {
+                // Each mesh owns a region of the command buffer, visible meshlets are compacted at its start
+                uint slot = atomicAdd(counts[object.mesh_index], 1);
+
+                DrawCommand command;
+                command.index_count = meshlet.triangle_count * 3;
+                command.instance_count = 1;
+                command.first_index = mesh.first_index + meshlet.first_index;
+                command.vertex_offset = mesh.vertex_offset;
+                command.first_instance = object_index;
+                commands[mesh.command_offset + slot] = command;
+            }
+        }
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex < 9 && group_statistics[gl_LocalInvocationIndex] > 0)
+        atomicAdd(statistics[gl_LocalInvocationIndex], group_statistics[gl_LocalInvocationIndex]);
+}
@@ -0,0 +1,19 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform  CameraUBO {
+    mat4 view;
+    mat4 proj;
+} camera_data;
+
+// Only the position is fetched, the color is left in the vertex buffer
+layout(location = 0) in vec3 in_position;
+
+// Per instance, takes locations 2 to 5
+layout(location = 2) in mat4 in_model;
+
+// Has to match shader.vert bit for bit
+invariant gl_Position;
+
+void main() {
+    gl_Position = camera_data.proj * camera_data.view * in_model * vec4(in_position, 1.0);
+}
@@ -0,0 +1,30 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+// The level above, or the depth buffer itself for level 0
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform ReduceData {
+    uvec2 source_size;
+    uvec2 destination_size;
+} reduce;
+
+// A workgroup row per row of texels. Each texel keeps the farthest depth under it: 2x2 source texels between levels, up to
+// 3x3 from a depth buffer whose size isn't a power of two
+void main() {
+    uvec2 texel = gl_GlobalInvocationID.xy;
+    if (texel.x >= reduce.destination_size.x || texel.y >= reduce.destination_size.y)
+        return;
+
+    uvec2 first = texel * reduce.source_size / reduce.destination_size;
+    uvec2 last = min(((texel + 1) * reduce.source_size + reduce.destination_size - 1) / reduce.destination_size, reduce.source_size) - 1;
+
+    float depth = 0.0;
+    for (uint y = first.y; y <= last.y; y++) {
+        for (uint x = first.x; x <= last.x; x++)
+            depth = max(depth, texelFetch(source, ivec2(x, y), 0).r);
+    }
+    imageStore(destination, ivec2(texel), vec4(depth));
+}
@@ -0,0 +1,34 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform  CameraUBO {
+    mat4 view;
+    mat4 proj;
+} camera_data;
+
+struct ObjectData {
+    mat4 model;
+    vec4 bounding_sphere;
+    uint mesh_index;
+    uint padding0;
+    uint padding1;
+    uint padding2;
+};
+
+// The culling pass writes the object index in firstInstance, so it comes back as gl_InstanceIndex
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+    ObjectData objects[];
+};
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_color;
+
+layout(location = 0) out vec3 frag_color;
+
+// Paired with depth_indirect.vert
+invariant gl_Position;
+
+void main() {
+    mat4 model = objects[gl_InstanceIndex].model;
+    gl_Position = camera_data.proj * camera_data.view * model * vec4(in_position, 1.0);
+    frag_color = in_color;
+}
@@ -0,0 +1,30 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform  CameraUBO {
+    mat4 view;
+    mat4 proj;
+} camera_data;
+
+// Maps the quantized positions back onto the bounding box of the mesh
+layout(push_constant) uniform Dequantization {
+    vec4 offset;
+    vec4 scale;
+} dequantization;
+
+// R16G16B16A16_SNORM and R8G8B8A8_UNORM, already normalized by the vertex fetch
+layout(location = 0) in vec4 in_position;
+layout(location = 1) in vec4 in_color;
+
+// Per instance, takes locations 2 to 5
+layout(location = 2) in mat4 in_model;
+
+layout(location = 0) out vec3 frag_color;
+
+// Paired with depth_quantized.vert
+invariant gl_Position;
+
+void main() {
+    vec3 position = dequantization.offset.xyz + in_position.xyz * dequantization.scale.xyz;
+    gl_Position = camera_data.proj * camera_data.view * in_model * vec4(position, 1.0);
+    frag_color = in_color.rgb;
+}
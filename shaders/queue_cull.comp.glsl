@@ -0,0 +1,140 @@
+#version 450
+
+layout(local_size_x = 64) in;
+
+// Same layout as VkDrawIndexedIndirectCommand
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int vertex_offset;
+    uint first_instance;
+};
+
+// A batch of BasicRenderer's render queue, drawn once in each phase with its own command
+struct BatchData {
+    DrawCommand early_command;
+    DrawCommand late_command;
+    uint padding0;
+    uint padding1;
+    vec4 bounding_sphere;
+};
+
+// The frame's instances as the CPU wrote them, in the order of the batches
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    mat4 instances[];
+};
+
+// Instance counts start at 0, the visible instances of each phase are counted in its command
+layout(std430, set = 0, binding = 1) buffer Batches {
+    BatchData batches[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer InstanceBatches {
+    uint instance_batches[];
+};
+
+// Whether the early phase left each instance out, only those are tested again by the late phase
+layout(std430, set = 0, binding = 3) buffer Occluded {
+    uint occluded_instances[];
+};
+
+// Bound as the instance vertex buffer, each command draws its batch's range from its start
+layout(std430, set = 0, binding = 4) writeonly buffer CulledInstances {
+    mat4 culled_instances[];
+};
+
+// Instances tested, those the late phase still found occluded, and those it drew. Cleared before the early phase
+layout(std430, set = 0, binding = 5) buffer Statistics {
+    uint statistics[3];
+};
+
+layout(set = 0, binding = 6) uniform sampler2D depth_pyramid;
+
+// The early phase tests against the pyramid of the last frame that built one, seen from where it was built, the late phase
+// against this frame's pyramid
+const uint PHASE_EARLY = 1;
+const uint PHASE_LATE = 2;
+
+layout(push_constant) uniform QueueCullData {
+    mat4 view_projection;
+    vec2 pyramid_size;
+    uint pyramid_level_count;
+    uint instance_count;
+    uint base_instance;
+    uint phase;
+    // No pyramid was built yet, the early phase draws everything
+    uint test_pyramid;
+} cull;
+
+shared uint group_statistics[3];
+
+// Same test as cull.comp: the nearest depth of the sphere's bounding box against the farthest depth of the pyramid under its
+// screen rectangle
+bool occluded(vec3 center, float radius) {
+    vec2 rect_min = vec2(1.0);
+    vec2 rect_max = vec2(-1.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = cull.view_projection * vec4(corner, 1.0);
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        rect_min = min(rect_min, ndc.xy);
+        rect_max = max(rect_max, ndc.xy);
+        nearest = min(nearest, ndc.z);
+    }
+
+    vec2 uv_min = clamp(rect_min * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uv_max = clamp(rect_max * 0.5 + 0.5, 0.0, 1.0);
+    vec2 size = (uv_max - uv_min) * cull.pyramid_size;
+    int level = min(int(ceil(log2(max(max(size.x, size.y), 1.0)))), int(cull.pyramid_level_count) - 1);
+
+    ivec2 level_size = max(ivec2(cull.pyramid_size) >> level, ivec2(1));
+    ivec2 first = clamp(ivec2(uv_min * vec2(level_size)), ivec2(0), level_size - 1);
+    ivec2 last = clamp(ivec2(uv_max * vec2(level_size)), ivec2(0), level_size - 1);
+    float farthest = max(max(texelFetch(depth_pyramid, first, level).r, texelFetch(depth_pyramid, ivec2(last.x, first.y), level).r),
+        max(texelFetch(depth_pyramid, ivec2(first.x, last.y), level).r, texelFetch(depth_pyramid, last, level).r));
+    return nearest > farthest;
+}
+
+// A thread per instance, the frustum already culled them on the CPU
+void main() {
+    if (gl_LocalInvocationIndex < 3)
+        group_statistics[gl_LocalInvocationIndex] = 0;
+    barrier();
+
+    uint instance_index = gl_GlobalInvocationID.x;
+    if (instance_index < cull.instance_count && (cull.phase == PHASE_EARLY || occluded_instances[instance_index] != 0)) {
+        mat4 model = instances[cull.base_instance + instance_index];
+        uint batch_index = instance_batches[instance_index];
+        vec4 sphere = batches[batch_index].bounding_sphere;
+        float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+        vec3 center = (model * vec4(sphere.xyz, 1.0)).xyz;
+
+        bool hidden = (cull.phase == PHASE_LATE || cull.test_pyramid != 0) && occluded(center, sphere.w * scale);
+        if (cull.phase == PHASE_EARLY) {
+            occluded_instances[instance_index] = hidden ? 1 : 0;
+            atomicAdd(group_statistics[0], 1);
+        } else if (hidden) {
+            atomicAdd(group_statistics[1], 1);
+        } else {
+            atomicAdd(group_statistics[2], 1);
+        }
+
+        // Compacted at the start of the batch's range, the early phase's draws are done before the late phase reuses it
+        if (!hidden) {
+            uint slot;
+            if (cull.phase == PHASE_EARLY)
+                slot = batches[batch_index].early_command.first_instance + atomicAdd(batches[batch_index].early_command.instance_count, 1);
+            else
+                slot = batches[batch_index].late_command.first_instance + atomicAdd(batches[batch_index].late_command.instance_count, 1);
+            culled_instances[slot] = model;
+        }
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex < 3 && group_statistics[gl_LocalInvocationIndex] > 0)
+        atomicAdd(statistics[gl_LocalInvocationIndex], group_statistics[gl_LocalInvocationIndex]);
+}
@@ -5,17 +5,18 @@ layout(set = 0, binding = 0) uniform  CameraUBO {
     mat4 proj;
 } camera_data;
 
-layout( push_constant ) uniform constants
-{
-    mat4 model;
-} model_data;
-
 layout(location = 0) in vec3 in_position;
 layout(location = 1) in vec3 in_color;
 
+// Per instance, takes locations 2 to 5
+layout(location = 2) in mat4 in_model;
+
 layout(location = 0) out vec3 frag_color;
 
+// Has to match depth.vert bit for bit, after a prepass the color pass only keeps EQUAL depths
+invariant gl_Position;
+
 void main() {
-    gl_Position = camera_data.proj * camera_data.view * model_data.model * vec4(in_position, 1.0);
+    gl_Position = camera_data.proj * camera_data.view * in_model * vec4(in_position, 1.0);
     frag_color = in_color;
-}
\ No newline at end of file
+}
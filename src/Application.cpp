@@ -2,21 +2,64 @@
 // Created by nathan on 1/10/23.
 //
 
+#include <algorithm>
+#include <thread>
 #include "Application.h"
 #include "Window.h"
 #include "renderer/Renderer.h"
 #include "input.h"
 #include "vulkan/VulkanInstance.h"
 #include "renderer/BasicRenderer.h"
+#include "renderer/GpuDrivenRenderer.h"
+#include "renderer/MeshOptimizer.h"
+#include "vulkan/MemoryAllocator.h"
+#include "core/JobSystem.h"
+#include "core/Profiler.h"
+#include "log.h"
+#include "utils.h"
+#include "glm/gtc/constants.hpp"
 
 namespace Vulkan {
 
-Application::Application(const std::string &name, i32 x, i32 y, i32 width, i32 height)
-	:_initialized_properly(false)
+// UV sphere with counter-clockwise triangles seen from outside, the degenerate ones at the poles are left out
+static void generate_sphere(f32 radius, u32 rings, u32 segments, std::vector<Vertex>& vertices, std::vector<u32>& indices)
 {
-	if (!Window::initialize(name, x, y, width, height))
+	for (u32 ring = 0; ring <= rings; ring++) {
+		f32 theta = glm::pi<f32>() * ring / rings;
+		for (u32 segment = 0; segment <= segments; segment++) {
+			f32 phi = 2.0f * glm::pi<f32>() * segment / segments;
+			glm::vec3 normal(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			vertices.emplace_back(normal * radius, normal * 0.5f + 0.5f);
+		}
+	}
+
+	for (u32 ring = 0; ring < rings; ring++) {
+		for (u32 segment = 0; segment < segments; segment++) {
+			u32 current = ring * (segments + 1) + segment;
+			u32 below = current + segments + 1;
+			if (ring != rings - 1)
+				indices.insert(indices.end(), {current, below, below + 1});
+			if (ring != 0)
+				indices.insert(indices.end(), {current, below + 1, current + 1});
+		}
+	}
+}
+
+Application::Application(const std::string &name, i32 x, i32 y, i32 width, i32 height, const Settings& settings)
+	:_initialized_properly(false), mesh_transform(0), mesh_node(SceneGraph::INVALID_NODE), satellite_node(SceneGraph::INVALID_NODE)
+{
+	if (!JobSystem::initialize())
 		return;
-	if (!BasicRenderer::initialize())
+	if (settings.headless) {
+		if (!Window::initialize_headless(width, height))
+			return;
+	} else if (!Window::initialize(name, x, y, width, height)) {
+		return;
+	}
+	u32 recording_threads = settings.recording_threads;
+	if (recording_threads == Settings::AUTO_THREADS)
+		recording_threads = std::max(1u, std::thread::hardware_concurrency()) - 1;
+	if (!BasicRenderer::initialize(settings.frames_in_flight, recording_threads, settings.depth_prepass))
 		return;
 
 	std::vector<Vertex> verticies = {Vertex({0.0f, 0.0f, 0.0f}, {1.0f, 1.0f, 0.0f}),
@@ -29,22 +72,54 @@ Application::Application(const std::string &name, i32 x, i32 y, i32 width, i32 h
 											Vertex({0.0f, -5.0f, 5.0f}, {0.0f, 0.0f, 1.0f})};
 
 	std::vector<u32> indices = {0, 1, 2, 0, 2, 3, 4, 5, 1, 4, 1, 0, 1, 5, 6, 1, 6, 2, 4, 0, 3, 4, 3, 7, 3, 2, 6, 3, 6, 7, 5, 4, 7, 5, 7, 6};
-	mesh = BasicRenderer::Mesh(verticies, indices);
+	MeshOptimizer::optimize(verticies, indices);
+	mesh = BasicRenderer::Mesh(verticies, indices, VertexFormat::Float, 4);
+	quantized_mesh = BasicRenderer::Mesh(verticies, indices, VertexFormat::Quantized);
+	mesh_transform = transforms.create();
+
+	// A smaller, quantized copy attached to the side of the cube, it follows it without being moved itself
+	mesh_node = scene.create_node();
+	satellite_node = scene.create_node(mesh_node, TransformStore::compose(glm::vec3(7.0f, 0.0f, 0.0f),
+		glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.3f)));
+
+	// A dense sphere for the GPU-driven path, enough triangles for cluster culling to matter. It follows the cube too,
+	// the scene graph hands its new world matrix to the GPU-driven renderer
+	if (settings.dense_scene && GpuDrivenRenderer::is_enabled()) {
+		std::vector<Vertex> sphere_vertices;
+		std::vector<u32> sphere_indices;
+		generate_sphere(1.0f, 256, 512, sphere_vertices, sphere_indices);
+		MeshOptimizer::optimize(sphere_vertices, sphere_indices);
+		dense_mesh = BasicRenderer::Mesh(sphere_vertices, sphere_indices);
+		SceneGraph::NodeHandle dense_node = scene.create_node(mesh_node, TransformStore::compose(glm::vec3(1.25f, 0.25f, -1.25f),
+			glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f)));
+		attach_object(dense_node, GpuDrivenRenderer::add_object(dense_mesh, scene.local_transform(dense_node)));
+	}
+	MemoryAllocator::log_statistics();
+	BasicRenderer::Mesh::log_geometry_statistics();
 
 	_initialized_properly = true;
+	_start_time = get_absolute_time();
 }
 
 Application::~Application()
 {
 	vkDeviceWaitIdle(VulkanInstance::logical_device());
+	// Until the GPU is done with the last frame, the throughput of a headless benchmark
+	if (_frame_count > 0) {
+		f64 elapsed = get_absolute_time() - _start_time;
+		CORE_INFO("Application: %lu frames in %.3f s (%.1f fps)", _frame_count, elapsed, _frame_count / elapsed);
+	}
 	mesh.release_ressources();
+	quantized_mesh.release_ressources();
+	dense_mesh.release_ressources();
 	BasicRenderer::shutdown();
 	Window::shutdown();
+	JobSystem::shutdown();
 }
 
 bool Application::should_close()
 {
-	return !_initialized_properly || Window::should_close();
+	return !_initialized_properly || Window::should_close() || (_frame_limit > 0 && _frame_count >= _frame_limit);
 }
 
 void Application::update()
@@ -52,6 +127,7 @@ void Application::update()
 	static double frames = 0.0;
 	static glm::vec3 pos(0.0f, 0.0f, 0.0f);
 //	static glm::vec3 rot(0.0f, 0.0f, 0.0f);
+	PROFILE_SCOPE("Frame");
 
 	Window::update();
 
@@ -68,10 +144,39 @@ void Application::update()
 	if (is_key_down(Keys::LSHIFT))
 		pos.y += 0.1f;
 
+	transforms.set_position(mesh_transform, pos);
+	transforms.set_rotation(mesh_transform, glm::vec3(0.0f, frames, 0.0f));
+	transforms.update();
+	scene.set_local_transform(mesh_node, transforms.matrix(mesh_transform));
+	scene.update();
+	upload_scene_changes();
+
 	BasicRenderer::begin_frame();
-	BasicRenderer::draw(mesh, pos, glm::vec3(0.0f, frames, 0.0f));
+	BasicRenderer::draw(mesh, scene.world_transform(mesh_node));
+	BasicRenderer::draw(quantized_mesh, scene.world_transform(satellite_node));
 	BasicRenderer::end_frame();
 	frames += 0.005;
+	_frame_count++;
+}
+
+void Application::attach_object(SceneGraph::NodeHandle node, GpuDrivenRenderer::ObjectHandle object)
+{
+	if (node == SceneGraph::INVALID_NODE || object == GpuDrivenRenderer::INVALID_OBJECT)
+		return ;
+	if (node >= node_objects.size())
+		node_objects.resize(node + 1, GpuDrivenRenderer::INVALID_OBJECT);
+	node_objects[node] = object;
+}
+
+void Application::upload_scene_changes()
+{
+	// Only the subtrees that moved are listed, the other objects keep what the GPU already has
+	const std::vector<SceneGraph::NodeHandle>& nodes = scene.changed_nodes();
+	const std::vector<glm::mat4>& world_transforms = scene.changed_world_transforms();
+	for (u32 i = 0; i < nodes.size(); i++) {
+		if (nodes[i] < node_objects.size() && node_objects[nodes[i]] != GpuDrivenRenderer::INVALID_OBJECT)
+			GpuDrivenRenderer::update_object(node_objects[nodes[i]], world_transforms[i]);
+	}
 }
 
 }
@@ -6,23 +6,65 @@
 #define APPLICATION_H
 
 #include <string>
+#include <vector>
 #include "defines.h"
 #include "renderer/BasicRenderer.h"
+#include "renderer/GpuDrivenRenderer.h"
+#include "renderer/TransformStore.h"
+#include "renderer/SceneGraph.h"
 
 namespace Vulkan {
 
 class Application
 {
 public:
-	Application(const std::string &name, i32 x, i32 y, i32 width, i32 height);
+	struct Settings
+	{
+		// recording_threads picks one per core but the main thread's
+		static constexpr u32	AUTO_THREADS = ~0u;
+
+		// Nothing is shown: frames are rendered into offscreen images of width x height
+		bool	headless = false;
+		u32		frames_in_flight = 2;
+		// Threads recording the render pass in secondary command buffers, 0 records it on the main thread
+		u32		recording_threads = AUTO_THREADS;
+		// Depth is laid down first by depth-only pipelines, only the visible fragments are shaded
+		bool	depth_prepass = false;
+		// Adds a 256 x 512 sphere drawn by the GPU-driven renderer, generated and optimized at startup
+		bool	dense_scene = false;
+	};
+
+public:
+	Application(const std::string &name, i32 x, i32 y, i32 width, i32 height, const Settings& settings);
 	~Application();
 
 	bool should_close();
 	void update();
 
+	bool initialized_properly() const { return _initialized_properly; }
+	// Closes after frame_limit frames, 0 runs until the window is closed
+	void set_frame_limit(u64 frame_limit) { _frame_limit = frame_limit; }
+
+private:
+	// The object follows the node's world matrix from the next update() on
+	void attach_object(SceneGraph::NodeHandle node, GpuDrivenRenderer::ObjectHandle object);
+	void upload_scene_changes();
+
 private:
 	bool _initialized_properly;
+	u64 _frame_limit = 0;
+	u64 _frame_count = 0;
+	f64 _start_time = 0.0;
 	BasicRenderer::Mesh mesh;
+	BasicRenderer::Mesh quantized_mesh;
+	BasicRenderer::Mesh dense_mesh;
+	TransformStore transforms;
+	TransformStore::Handle mesh_transform;
+	SceneGraph scene;
+	SceneGraph::NodeHandle mesh_node;
+	SceneGraph::NodeHandle satellite_node;
+	// Indexed by node handle, INVALID_OBJECT for the nodes without one
+	std::vector<GpuDrivenRenderer::ObjectHandle> node_objects;
 };
 
 }
@@ -5,12 +5,14 @@
 #include "Window.h"
 #include "log.h"
 #include "input.h"
+#include "core/Profiler.h"
 #include "vulkan/VulkanInstance.h"
 #include "vulkan/vulkan_errors.h"
 
 namespace Vulkan {
 
 bool				Window::initialized = false;
+bool				Window::headless = false;
 bool				Window::has_resized = false;
 bool				Window::visible = true;
 std::string			Window::name;
@@ -40,14 +42,31 @@ bool Window::initialize(const std::string &win_name, i32 x, i32 y, u32 win_width
 	return true;
 }
 
+bool Window::initialize_headless(u32 win_width, u32 win_height)
+{
+	if (win_width == 0 || win_height == 0) {
+		CORE_ERROR("A headless window needs a size to render at, got %ux%u", win_width, win_height);
+		return false;
+	}
+	name = "headless";
+	width = win_width;
+	height = win_height;
+	headless = true;
+	CORE_TRACE("Headless window of %ux%u", width, height);
+	return true;
+}
+
 void Window::shutdown()
 {
-	glfwTerminate();
+	if (!headless)
+		glfwTerminate();
 }
 
 void Window::destroy_surface()
 {
-	vkDestroySurfaceKHR(VulkanInstance::instance(), surface, nullptr);
+	if (surface != VK_NULL_HANDLE)
+		vkDestroySurfaceKHR(VulkanInstance::instance(), surface, nullptr);
+	surface = VK_NULL_HANDLE;
 }
 
 bool Window::initialize_window(i32 x, i32 y)
@@ -69,12 +88,18 @@ bool Window::initialize_window(i32 x, i32 y)
 
 void Window::update()
 {
+	PROFILE_SCOPE("Window::update");
 	has_resized = false;
-	glfwPollEvents();
+	if (!headless)
+		glfwPollEvents();
 }
 
 bool Window::initialize_surface()
 {
+	// Nothing is ever presented, the surface stays null
+	if (headless)
+		return true;
+
 	VkResult result = glfwCreateWindowSurface(VulkanInstance::instance(), window, nullptr, &surface);
 	if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't create a window surface: %s", vulkan_error_to_string(result));
@@ -143,6 +168,9 @@ void Window::framebuffer_size_callback(GLFWwindow *from_window, int new_width, i
 
 std::vector<const char *> Window::get_required_instance_extensions()
 {
+	if (headless)
+		return {};
+
 	u32 count;
 	const char** extensions = glfwGetRequiredInstanceExtensions(&count);
 	if (!extensions) {
@@ -159,7 +187,8 @@ std::vector<const char *> Window::get_required_instance_extensions()
 
 bool Window::should_close()
 {
-	return glfwWindowShouldClose(window);
+	// Only the application knows when a headless run is over
+	return !headless && glfwWindowShouldClose(window);
 }
 
 }
@@ -22,6 +22,8 @@ public:
 	// Initialization
 	//----
 	static bool							initialize(const std::string& win_name, i32 x, i32 y, u32 win_width, u32 win_height);
+	// No GLFW window and no surface, the renderer draws into offscreen images of this size
+	static bool							initialize_headless(u32 win_width, u32 win_height);
 	static bool							initialize_surface();
 	static void							destroy_surface();
 	static void							shutdown();
@@ -37,6 +39,7 @@ public:
 	// Getters
 	//----
 	static bool					is_initialized() 	{ return initialized; }
+	static bool					is_headless()		{ return headless; }
 	static bool					did_resize()		{ return has_resized; }
 	static bool					is_visible()		{ return visible; }
 	static const VkSurfaceKHR&	get_surface()		{ return surface; }
@@ -61,6 +64,7 @@ private:	// Methods
 
 private:	// Members
 	static bool			initialized;
+	static bool			headless;
 	static bool			has_resized;
 	static bool			visible;
 
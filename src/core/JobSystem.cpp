@@ -0,0 +1,250 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "log.h"
+
+namespace Vulkan {
+
+std::vector<std::unique_ptr<JobSystem::JobQueue>>	JobSystem::queues;
+std::vector<std::thread>	JobSystem::workers;
+
+std::atomic<u32>			JobSystem::queued_jobs(0);
+std::atomic<u32>			JobSystem::sleeping_workers(0);
+std::atomic<u32>			JobSystem::next_queue(0);
+std::mutex					JobSystem::sleep_mutex;
+std::condition_variable		JobSystem::wake_condition;
+std::atomic<bool>			JobSystem::stopping(false);
+
+// Index in queues of the current thread, set once when the thread starts
+static thread_local u32		current_thread_index = std::numeric_limits<u32>::max();
+
+bool JobSystem::initialize(u32 thread_count)
+{
+	if (is_initialized()) {
+		CORE_WARN("JobSystem is already initialized");
+		return true;
+	}
+
+	if (thread_count == 0)
+		thread_count = std::max(1u, std::thread::hardware_concurrency());
+
+	stopping = false;
+	queued_jobs = 0;
+	sleeping_workers = 0;
+	for (u32 i = 0; i < thread_count; i++)
+		queues.push_back(std::make_unique<JobQueue>());
+
+	current_thread_index = 0;
+	for (u32 i = 1; i < thread_count; i++)
+		workers.emplace_back(worker_main, i);
+
+	CORE_TRACE("JobSystem initialized with %u threads", thread_count);
+	return true;
+}
+
+void JobSystem::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	wake_condition.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+	queues.clear();
+	current_thread_index = std::numeric_limits<u32>::max();
+}
+
+u32 JobSystem::thread_index()
+{
+	return current_thread_index;
+}
+
+void JobSystem::run(JobFunction job, Counter *counter)
+{
+	if (counter != nullptr)
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+	Job new_job;
+	new_job.function = std::move(job);
+	new_job.counter = counter;
+	if (!is_initialized()) {
+		execute(new_job);
+		return ;
+	}
+	push(std::move(new_job));
+}
+
+void JobSystem::run_after(Counter &dependency, JobFunction job, Counter *counter)
+{
+	if (counter != nullptr)
+		counter->_pending.fetch_add(1, std::memory_order_relaxed);
+
+	{
+		// finish() decrements under the same lock, once the count is 0 nothing would collect the continuation
+		std::lock_guard<std::mutex> lock(dependency._mutex);
+		if (!dependency.is_done()) {
+			dependency._continuations.emplace_back(std::move(job), counter);
+			return ;
+		}
+	}
+
+	// The counter was already incremented, run() must not do it again
+	Job new_job;
+	new_job.function = std::move(job);
+	new_job.counter = counter;
+	if (!is_initialized())
+		execute(new_job);
+	else
+		push(std::move(new_job));
+}
+
+void JobSystem::wait(Counter &counter)
+{
+	const u32 thread = current_thread_index;
+	Job job;
+	while (!counter.is_done()) {
+		if (thread != std::numeric_limits<u32>::max() && pop_or_steal(thread, job))
+			execute(job);
+		else
+			std::this_thread::yield();
+	}
+
+	// The job that brought the count to 0 may still hold the lock, the counter can't be destroyed before it lets go
+	std::lock_guard<std::mutex> lock(counter._mutex);
+}
+
+void JobSystem::parallel_for(u32 count, u32 grain_size, const RangeFunction &function)
+{
+	if (count == 0)
+		return ;
+
+	grain_size = std::max(grain_size, 1u);
+	if (!is_initialized() || count <= grain_size) {
+		function(0, count);
+		return ;
+	}
+
+	// A few chunks per thread, so the threads that finish early can steal from the slow ones
+	u32 chunk_count = std::min((count + grain_size - 1) / grain_size, thread_count() * 4);
+	u32 chunk_size = (count + chunk_count - 1) / chunk_count;
+
+	Counter counter;
+	for (u32 first = chunk_size; first < count; first += chunk_size) {
+		u32 last = std::min(first + chunk_size, count);
+		run([&function, first, last] { function(first, last); }, &counter);
+	}
+
+	// The first chunk runs right away on this thread
+	function(0, std::min(chunk_size, count));
+	wait(counter);
+}
+
+void JobSystem::push(Job &&job)
+{
+	// Threads that are not part of the system spread their jobs over every queue
+	u32 thread = current_thread_index;
+	if (thread >= queues.size())
+		thread = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+	{
+		std::lock_guard<std::mutex> lock(queues[thread]->mutex);
+		queues[thread]->jobs.push_back(std::move(job));
+	}
+
+	// A worker going to sleep increments sleeping_workers before checking queued_jobs, one of the two sees the other
+	queued_jobs.fetch_add(1);
+	if (sleeping_workers.load() > 0) {
+		{ std::lock_guard<std::mutex> lock(sleep_mutex); }
+		wake_condition.notify_one();
+	}
+}
+
+bool JobSystem::pop_or_steal(u32 thread, Job &job)
+{
+	if (queued_jobs.load(std::memory_order_relaxed) == 0)
+		return false;
+
+	// Newest job of its own queue first, its data is the most likely to still be in cache
+	{
+		JobQueue& queue = *queues[thread];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.back());
+			queue.jobs.pop_back();
+			queued_jobs.fetch_sub(1);
+			return true;
+		}
+	}
+
+	// Then the oldest job of the others, which tends to be the largest piece of work left
+	for (u32 i = 1; i < queues.size(); i++) {
+		JobQueue& queue = *queues[(thread + i) % queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.jobs.empty()) {
+			job = std::move(queue.jobs.front());
+			queue.jobs.pop_front();
+			queued_jobs.fetch_sub(1);
+			return true;
+		}
+	}
+	return false;
+}
+
+void JobSystem::execute(Job &job)
+{
+	PROFILE_SCOPE("Job");
+	job.function();
+	job.function = nullptr;
+	if (job.counter != nullptr)
+		finish(*job.counter);
+}
+
+void JobSystem::finish(Counter &counter)
+{
+	// Decremented under the lock, wait() takes it before returning so the counter outlives this access
+	std::vector<std::pair<JobFunction, Counter*>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter._mutex);
+		if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			continuations.swap(counter._continuations);
+	}
+	for (auto& [function, continuation_counter] : continuations) {
+		Job job;
+		job.function = std::move(function);
+		job.counter = continuation_counter;
+		if (!is_initialized())
+			execute(job);
+		else
+			push(std::move(job));
+	}
+}
+
+void JobSystem::worker_main(u32 thread)
+{
+	current_thread_index = thread;
+	PROFILE_THREAD_NAME("Job worker " + std::to_string(thread));
+
+	Job job;
+	while (!stopping.load()) {
+		if (pop_or_steal(thread, job)) {
+			execute(job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		sleeping_workers.fetch_add(1);
+		wake_condition.wait(lock, [] { return stopping.load() || queued_jobs.load() > 0; });
+		sleeping_workers.fetch_sub(1);
+	}
+}
+
+} // Vulkan
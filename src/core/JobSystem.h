@@ -0,0 +1,114 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include "defines.h"
+
+namespace Vulkan {
+
+// Work-stealing scheduler. Every thread owns a deque: it pushes and pops its own jobs at the back,
+// idle threads steal the oldest jobs from the front of the others.
+// The thread calling initialize() is thread 0 and takes part by running jobs while it waits.
+class JobSystem
+{
+public:		// Types
+	using JobFunction = std::function<void()>;
+	// Called with a sub-range [first, last) of a parallel_for
+	using RangeFunction = std::function<void(u32 first, u32 last)>;
+
+	// Counts the unfinished jobs attached to it. Jobs started with run_after() wait for it to reach 0.
+	// Must be wait()ed on before it is destroyed.
+	class Counter
+	{
+	public:
+		Counter() = default;
+		Counter(const Counter& other) = delete;
+		Counter& operator=(const Counter& other) = delete;
+
+		bool	is_done()	const	{ return _pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class JobSystem;
+
+		std::atomic<u32>	_pending{0};
+		std::mutex			_mutex;
+		std::vector<std::pair<JobFunction, Counter*>>	_continuations;
+	};
+
+public:		// Methods
+	//----
+	// Initialization
+	//----
+	// 0 sizes it to the hardware concurrency, the calling thread included
+	static bool	initialize(u32 thread_count = 0);
+	static void	shutdown();
+
+	//----
+	// Jobs
+	//----
+	// counter, when given, is incremented now and decremented once the job ran
+	static void	run(JobFunction job, Counter *counter = nullptr);
+	// Same, but the job is only queued once dependency reached 0
+	static void	run_after(Counter& dependency, JobFunction job, Counter *counter = nullptr);
+	// Runs other jobs until the counter reaches 0
+	static void	wait(Counter& counter);
+
+	// Splits [0, count) in chunks of at least grain_size items, and returns once all of them ran.
+	// Runs everything on the calling thread when the system isn't initialized.
+	static void	parallel_for(u32 count, u32 grain_size, const RangeFunction& function);
+
+	//----
+	// Getters
+	//----
+	static bool	is_initialized()	{ return !queues.empty(); }
+	// Workers plus the thread that initialized the system
+	static u32	thread_count()		{ return static_cast<u32>(queues.size()); }
+	// 0 for the thread that initialized the system, max() for threads it doesn't know
+	static u32	thread_index();
+
+private:	// Types
+	struct Job
+	{
+		JobFunction	function;
+		Counter		*counter	= nullptr;
+	};
+
+	struct JobQueue
+	{
+		std::mutex			mutex;
+		std::deque<Job>		jobs;
+	};
+
+private:	// Methods
+	static void	push(Job&& job);
+	static bool	pop_or_steal(u32 thread, Job& job);
+	static void	execute(Job& job);
+	static void	finish(Counter& counter);
+	static void	worker_main(u32 thread);
+
+private:	// Members
+	static std::vector<std::unique_ptr<JobQueue>>	queues;
+	static std::vector<std::thread>					workers;
+
+	// Jobs sitting in any queue, the workers sleep while it is 0
+	static std::atomic<u32>							queued_jobs;
+	static std::atomic<u32>							sleeping_workers;
+	static std::atomic<u32>							next_queue;
+	static std::mutex								sleep_mutex;
+	static std::condition_variable					wake_condition;
+	static std::atomic<bool>						stopping;
+};
+
+} // Vulkan
+
+#endif //JOBSYSTEM_H
@@ -0,0 +1,190 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <cstdio>
+#include <ctime>
+#if defined __x86_64__ || defined __i386__
+# include <x86intrin.h>
+#endif
+#include "Profiler.h"
+#include "utils.h"
+#include "log.h"
+
+namespace Vulkan {
+
+std::atomic<bool>		Profiler::_capturing(false);
+std::atomic<u32>		Profiler::_capture(0);
+u64						Profiler::_start_ticks = 0;
+u64						Profiler::_end_ticks = 0;
+f64						Profiler::_start_time = 0.0;
+f64						Profiler::_end_time = 0.0;
+std::mutex				Profiler::_threads_mutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>>	Profiler::_threads;
+
+Profiler::Zone::Zone(const char *name)
+	: _name(is_capturing() ? name : nullptr), _begin(_name != nullptr ? ticks() : 0)
+{
+}
+
+Profiler::Zone::~Zone()
+{
+	// A zone still open as the capture ends isn't part of it
+	if (_name != nullptr && is_capturing())
+		record(_name, _begin, ticks());
+}
+
+void Profiler::begin_capture()
+{
+	// Buffers of the previous capture are reset by their own thread, as it records in this one
+	_capture.fetch_add(1, std::memory_order_relaxed);
+	_start_time = get_absolute_time();
+	_start_ticks = ticks();
+	_capturing.store(true, std::memory_order_release);
+}
+
+bool Profiler::end_capture(const std::string &file_name)
+{
+	if (!_capturing.exchange(false, std::memory_order_acq_rel)) {
+		CORE_WARN("Profiler: no capture is running");
+		return false;
+	}
+	_end_ticks = ticks();
+	_end_time = get_absolute_time();
+	return write_chrome_trace(file_name);
+}
+
+void Profiler::set_thread_name(const std::string &name)
+{
+	ThreadBuffer *buffer = thread_buffer();
+	std::lock_guard<std::mutex> lock(_threads_mutex);
+	buffer->name = name;
+}
+
+u64 Profiler::ticks()
+{
+#if defined __x86_64__ || defined __i386__
+	// Constant rate on every CPU of the last decade, whatever their frequency
+	return __rdtsc();
+#else
+	struct timespec now{};
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<u64>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+#endif
+}
+
+//----
+// Recording
+//----
+
+void Profiler::record(const char *name, u64 begin, u64 end)
+{
+	ThreadBuffer *buffer = thread_buffer();
+	const u32 capture = _capture.load(std::memory_order_relaxed);
+	if (buffer->capture.load(std::memory_order_relaxed) != capture) {
+		if (buffer->events.empty())
+			buffer->events.resize(EVENTS_PER_THREAD);
+		buffer->count.store(0, std::memory_order_relaxed);
+		buffer->dropped.store(0, std::memory_order_relaxed);
+		buffer->capture.store(capture, std::memory_order_release);
+	}
+
+	const u32 index = buffer->count.load(std::memory_order_relaxed);
+	if (index >= EVENTS_PER_THREAD) {
+		buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+		return ;
+	}
+	buffer->events[index] = { name, begin, end };
+	buffer->count.store(index + 1, std::memory_order_release);
+}
+
+Profiler::ThreadBuffer *Profiler::thread_buffer()
+{
+	static thread_local ThreadBuffer *buffer = nullptr;
+	if (buffer != nullptr)
+		return buffer;
+
+	// Once per thread, buffers are never released so that threads can outlive a capture
+	std::lock_guard<std::mutex> lock(_threads_mutex);
+	_threads.push_back(std::make_unique<ThreadBuffer>());
+	buffer = _threads.back().get();
+	buffer->thread_id = static_cast<u32>(_threads.size() - 1);
+	return buffer;
+}
+
+//----
+// Export
+//----
+
+static void write_json_string(FILE *file, const char *string)
+{
+	fputc('"', file);
+	for (; *string != '\0'; string++) {
+		if (*string == '"' || *string == '\\')
+			fputc('\\', file);
+		if (static_cast<unsigned char>(*string) >= 0x20)
+			fputc(*string, file);
+	}
+	fputc('"', file);
+}
+
+bool Profiler::write_chrome_trace(const std::string &file_name)
+{
+	FILE *file = fopen(file_name.c_str(), "w");
+	if (file == nullptr) {
+		CORE_ERROR("Profiler: couldn't open [%s] to write the trace", file_name.c_str());
+		return false;
+	}
+
+	// Chrome traces count in microseconds
+	const f64 elapsed_microseconds = (_end_time - _start_time) * 1000000.0;
+	const f64 ticks_per_microsecond = elapsed_microseconds > 0.0 && _end_ticks > _start_ticks
+		? static_cast<f64>(_end_ticks - _start_ticks) / elapsed_microseconds : 1.0;
+	auto to_microseconds = [ticks_per_microsecond](u64 ticks) {
+		return static_cast<f64>(static_cast<i64>(ticks - _start_ticks)) / ticks_per_microsecond;
+	};
+
+	const u32 capture = _capture.load(std::memory_order_relaxed);
+	u32 zone_count = 0;
+	u32 dropped_count = 0;
+	bool first = true;
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+
+	std::lock_guard<std::mutex> lock(_threads_mutex);
+	for (const auto& buffer : _threads) {
+		if (!buffer->name.empty()) {
+			fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+				first ? "" : ",", buffer->thread_id);
+			write_json_string(file, buffer->name.c_str());
+			fprintf(file, "}}");
+			first = false;
+		}
+		if (buffer->capture.load(std::memory_order_acquire) != capture)
+			continue ;
+
+		const u32 count = buffer->count.load(std::memory_order_acquire);
+		for (u32 i = 0; i < count; i++) {
+			const Event& event = buffer->events[i];
+			fprintf(file, "%s\n{\"name\":", first ? "" : ",");
+			write_json_string(file, event.name);
+			fprintf(file, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", to_microseconds(event.begin),
+				static_cast<f64>(event.end - event.begin) / ticks_per_microsecond, buffer->thread_id);
+			first = false;
+		}
+		zone_count += count;
+		dropped_count += buffer->dropped.load(std::memory_order_relaxed);
+	}
+	fprintf(file, "\n]}\n");
+
+	bool written = !ferror(file);
+	if (fclose(file) != 0 || !written) {
+		CORE_ERROR("Profiler: couldn't write the trace to [%s]", file_name.c_str());
+		return false;
+	}
+	CORE_INFO("Profiler: %u zones over %.3f s written to [%s]", zone_count, elapsed_microseconds / 1000000.0, file_name.c_str());
+	if (dropped_count > 0)
+		CORE_WARN("Profiler: %u zones dropped, threads are limited to %u per capture", dropped_count, EVENTS_PER_THREAD);
+	return true;
+}
+
+} // Vulkan
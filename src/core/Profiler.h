@@ -0,0 +1,124 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "defines.h"
+
+// Zones are only recorded in debug builds and in `make profile`, release builds compile them out entirely
+#if defined DEBUG || defined PROFILE
+# define PROFILING_ENABLED 1
+#else
+# define PROFILING_ENABLED 0
+#endif
+
+#define PROFILE_CONCATENATE_(a, b) a##b
+#define PROFILE_CONCATENATE(a, b) PROFILE_CONCATENATE_(a, b)
+
+#if PROFILING_ENABLED == 1
+// Times the rest of the enclosing scope. name must outlive the capture, a string literal in practice
+# define PROFILE_SCOPE(name) Vulkan::Profiler::Zone PROFILE_CONCATENATE(profile_zone_, __LINE__)(name)
+// Names the calling thread's track in the trace, name isn't even built in release
+# define PROFILE_THREAD_NAME(name) Vulkan::Profiler::set_thread_name(name)
+#else
+# define PROFILE_SCOPE(name)
+# define PROFILE_THREAD_NAME(name)
+#endif
+
+namespace Vulkan {
+
+// CPU instrumentation exported as a Chrome trace, for chrome://tracing or Perfetto.
+// Every thread appends the zones it closes to its own buffer without taking any lock, only the first zone a thread
+// records registers its buffer. Time comes from the TSC on x86, calibrated against CLOCK_MONOTONIC over the capture,
+// and from CLOCK_MONOTONIC elsewhere.
+class Profiler
+{
+public:	// Types
+	class Zone
+	{
+	public:
+		explicit Zone(const char *name);
+		~Zone();
+
+		Zone(const Zone& other) = delete;
+		Zone& operator=(const Zone& other) = delete;
+
+	private:
+		// Null when no capture was running as the zone opened
+		const char	*_name;
+		u64			_begin;
+	};
+
+	// Zones a thread records in a capture, the next ones are dropped
+	static constexpr u32	EVENTS_PER_THREAD = 1 << 16;
+
+public:
+	//----
+	// Capture
+	//----
+	// Drops what the previous capture recorded. Neither must run while the other does
+	static void	begin_capture();
+	// Stops recording and writes the zones closed since begin_capture() to file_name
+	static bool	end_capture(const std::string& file_name);
+	static bool	is_capturing()	{ return _capturing.load(std::memory_order_relaxed); }
+
+	// Shown as the thread's name in the trace, threads are numbered in the order they first record otherwise
+	static void	set_thread_name(const std::string& name);
+
+	//----
+	// Time
+	//----
+	// Only meaningful relative to other ticks of the same capture
+	static u64	ticks();
+
+private:	// Types
+	struct Event
+	{
+		const char	*name;
+		u64			begin;
+		u64			end;
+	};
+
+	// Only its thread writes events, count publishes them to the thread writing the trace.
+	// events is only allocated by the first zone the thread records, naming a thread costs nothing
+	struct ThreadBuffer
+	{
+		std::vector<Event>	events;
+		std::atomic<u32>	count{0};
+		std::atomic<u32>	dropped{0};
+		// The capture the events belong to, a thread resets its buffer when it first records in a new one
+		std::atomic<u32>	capture{0};
+		u32					thread_id	= 0;
+		std::string			name;
+	};
+
+private:	// Methods
+	static void			record(const char *name, u64 begin, u64 end);
+	static ThreadBuffer	*thread_buffer();
+	static bool			write_chrome_trace(const std::string& file_name);
+
+private:	// Members
+	static std::atomic<bool>	_capturing;
+	static std::atomic<u32>		_capture;
+
+	// Both clocks read at the start and the end of the capture, relating ticks to microseconds
+	static u64					_start_ticks;
+	static u64					_end_ticks;
+	static f64					_start_time;
+	static f64					_end_time;
+
+	// Registration and names only, never taken by record()
+	static std::mutex			_threads_mutex;
+	static std::vector<std::unique_ptr<ThreadBuffer>>	_threads;
+};
+
+} // Vulkan
+
+#endif //PROFILER_H
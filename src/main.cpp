@@ -3,19 +3,77 @@
 //
 
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <string>
 
 #include "utils.h"
 #include "Application.h"
 #include "input.h"
 #include "vulkan/VulkanInstance.h"
 #include "Window.h"
+#include "core/Profiler.h"
 
 
-int main()
+static void print_usage(const char *program)
 {
-	Vulkan::Application app("Vulkan app", 50, 50, 200, 200);
+	std::cerr << "Usage: " << program << " [--headless --frames N] [--frames-in-flight N] [--recording-threads N]"
+		<< " [--depth-prepass] [--dense-scene] [--trace FILE]" << std::endl;
+	std::cerr << "  --headless             render offscreen, without a window or a display" << std::endl;
+	std::cerr << "  --frames N             exit after N frames" << std::endl;
+	std::cerr << "  --frames-in-flight N   frames the CPU records while the GPU renders the previous ones, 2 by default" << std::endl;
+	std::cerr << "  --recording-threads N  threads recording the draws, a core each but the main one's by default, 0 for none" << std::endl;
+	std::cerr << "  --depth-prepass        draw the depth first, then shade only the visible fragments" << std::endl;
+	std::cerr << "  --dense-scene          add a 256k triangle sphere drawn by the GPU-driven renderer" << std::endl;
+	std::cerr << "  --trace FILE           write a Chrome trace of the run, with make debug or make profile" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+	Vulkan::Application::Settings settings;
+	u64 frame_limit = 0;
+	std::string trace_file;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--headless") == 0) {
+			settings.headless = true;
+		} else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frame_limit = std::strtoull(argv[++i], nullptr, 10);
+		} else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+			settings.frames_in_flight = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--recording-threads") == 0 && i + 1 < argc) {
+			settings.recording_threads = static_cast<u32>(std::strtoul(argv[++i], nullptr, 10));
+		} else if (std::strcmp(argv[i], "--depth-prepass") == 0) {
+			settings.depth_prepass = true;
+		} else if (std::strcmp(argv[i], "--dense-scene") == 0) {
+			settings.dense_scene = true;
+		} else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+			trace_file = argv[++i];
+		} else {
+			print_usage(argv[0]);
+			return 1;
+		}
+	}
+	// Nothing would ever close a headless run
+	if (settings.headless && frame_limit == 0) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	PROFILE_THREAD_NAME("Main");
+	if (!trace_file.empty()) {
+		if (PROFILING_ENABLED)
+			Vulkan::Profiler::begin_capture();
+		else
+			std::cerr << "--trace needs zones, which release builds compile out: build with make profile" << std::endl;
+	}
+
+	Vulkan::Application app("Vulkan app", 50, 50, 200, 200, settings);
+	if (!app.initialized_properly())
+		return 1;
+	app.set_frame_limit(frame_limit);
 
-	bool limited_framerate = true;
+	// Headless runs measure throughput, frames go as fast as the GPU allows
+	bool limited_framerate = !settings.headless;
 	f64 target_second_per_frame = 1.0 / 60.0;
 
 	f64 last_time = Vulkan::get_absolute_time();
@@ -42,5 +100,8 @@ int main()
 		}
 	}
 
+	// Before the application shuts down, so that only frames are in the trace
+	if (Vulkan::Profiler::is_capturing() && !Vulkan::Profiler::end_capture(trace_file))
+		return 1;
 	return(0);
 }
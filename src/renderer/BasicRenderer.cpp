@@ -2,13 +2,27 @@
 // Created by nathan on 1/19/23.
 //
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
 #include "BasicRenderer.h"
 #include "vulkan/VulkanInstance.h"
 #include "vulkan/vulkan_errors.h"
 #include "vulkan/GraphicsPipeline.h"
 #include "Renderer.h"
 #include "vulkan/SwapchainManager.h"
+#include "vulkan/MemoryAllocator.h"
+#include "vulkan/TransferContext.h"
+#include "vulkan/DeletionQueue.h"
+#include "vulkan/PipelineCache.h"
+#include "vulkan/ShaderBundle.h"
+#include "vulkan/GpuProfiler.h"
+#include "core/Profiler.h"
+#include "GpuDrivenRenderer.h"
+#include "TransformStore.h"
+#include "MeshSimplifier.h"
 #include "Window.h"
+#include "utils.h"
 #include "glm/gtc/matrix_transform.hpp"
 
 namespace Vulkan {
@@ -17,33 +31,76 @@ namespace Vulkan {
 // BasicRenderer::Mesh
 //----
 
+std::atomic<u32> BasicRenderer::Mesh::next_id(0);
+std::atomic<u32> BasicRenderer::Mesh::index_type_counts[3] = {};
+std::atomic<u64> BasicRenderer::Mesh::total_index_bytes(0);
+std::atomic<u64> BasicRenderer::Mesh::total_index_bytes_saved(0);
+std::atomic<u32> BasicRenderer::Mesh::quantized_mesh_count(0);
+std::atomic<u64> BasicRenderer::Mesh::total_vertex_bytes(0);
+std::atomic<u64> BasicRenderer::Mesh::total_vertex_bytes_saved(0);
+
 BasicRenderer::Mesh::Mesh()
-	:vertex_count(0), index_count(0)
+	:vertex_count(0), index_count(0), index_type(VK_INDEX_TYPE_UINT32), vertex_format(VertexFormat::Float), upload_token(0), id(next_id++), bounding_sphere(0.0f)
 {
 }
 
-BasicRenderer::Mesh::Mesh(const std::vector<Vertex> &verticies, const std::vector<u32> &indicies)
-	: vertex_count(verticies.size()), index_count(indicies.size())
+BasicRenderer::Mesh::Mesh(const std::vector<Vertex> &verticies, const std::vector<u32> &indicies, VertexFormat format, u32 lod_count)
+	: vertex_count(verticies.size()), index_count(indicies.size()), index_type(pick_index_type(verticies.size())), vertex_format(format),
+	upload_token(0), id(next_id++), bounding_sphere(0.0f)
 {
-	// Vertex buffer
-	Buffer vertex_staging_buffer = Buffer::create_vertex_buffer(vertex_count * sizeof(Vertex), true);
-	vertex_buffer = Buffer::create_vertex_buffer(vertex_count * sizeof(Vertex), false);
-
-	vertex_staging_buffer.set_data(verticies, 0);
-	vertex_staging_buffer.copy_to(vertex_buffer);
-
-	// Index buffer
-	Buffer index_staging_buffer = Buffer::create_index_buffer(index_count * sizeof(u32), true);
-	index_buffer = Buffer::create_index_buffer(index_count * sizeof(u32), false);
+	// Bounding sphere centered on the bounding box, the radius reaches the farthest vertex
+	if (!verticies.empty()) {
+		glm::vec3 min = verticies[0].pos;
+		glm::vec3 max = verticies[0].pos;
+		for (const auto& vertex : verticies) {
+			min = glm::min(min, vertex.pos);
+			max = glm::max(max, vertex.pos);
+		}
+		bounding_box.min = min;
+		bounding_box.max = max;
+
+		glm::vec3 center = bounding_box.center();
+		f32 radius_squared = 0.0f;
+		for (const auto& vertex : verticies)
+			radius_squared = std::max(radius_squared, glm::dot(vertex.pos - center, vertex.pos - center));
+		bounding_sphere = glm::vec4(center, std::sqrt(radius_squared));
+	}
 
-	index_staging_buffer.set_data(indicies, 0);
-	index_staging_buffer.copy_to(index_buffer);
+	// The copies are only recorded here, they are submitted along with the other pending uploads at the next frame
+	UploadToken vertex_token = upload_vertices(verticies);
+
+	// The full detail level comes first in the index buffer, the meshlets index it as given
+	meshlets = MeshletBuilder::build(verticies, indicies);
+
+	// Every level goes in the same index buffer, one after the other
+	UploadToken index_token;
+	if (lod_count > 1) {
+		auto simplified = MeshSimplifier::build_lods(verticies, indicies, std::min(lod_count, MAX_LODS));
+		std::vector<u32> all_indices;
+		for (const auto& level : simplified) {
+			lods.push_back({static_cast<u32>(all_indices.size()), static_cast<u32>(level.indices.size()), level.error});
+			all_indices.insert(all_indices.end(), level.indices.begin(), level.indices.end());
+		}
+		index_token = upload_indices(all_indices);
+	} else {
+		lods.push_back({0, static_cast<u32>(index_count), 0.0f});
+		index_token = upload_indices(indicies);
+	}
 
+	upload_token = std::max(vertex_token, index_token);
+}
 
+BasicRenderer::Mesh::Mesh(const Vulkan::BasicRenderer::Mesh &other)
+	: vertex_buffer(other.vertex_buffer), index_buffer(other.index_buffer), vertex_count(other.vertex_count), index_count(other.index_count),
+	index_type(other.index_type), lods(other.lods), meshlets(other.meshlets), vertex_format(other.vertex_format), dequantization(other.dequantization),
+	upload_token(other.upload_token), id(next_id++), bounding_sphere(other.bounding_sphere), bounding_box(other.bounding_box)
+{
 }
 
 BasicRenderer::Mesh::Mesh(Vulkan::BasicRenderer::Mesh &&other) noexcept
-	: vertex_buffer(std::move(other.vertex_buffer)), index_buffer(std::move(other.index_buffer)), vertex_count(other.vertex_count), index_count(other.index_count)
+	: vertex_buffer(std::move(other.vertex_buffer)), index_buffer(std::move(other.index_buffer)), vertex_count(other.vertex_count), index_count(other.index_count),
+	index_type(other.index_type), lods(std::move(other.lods)), meshlets(std::move(other.meshlets)), vertex_format(other.vertex_format), dequantization(other.dequantization),
+	upload_token(other.upload_token), id(other.id), bounding_sphere(other.bounding_sphere), bounding_box(other.bounding_box)
 {
 }
 
@@ -54,8 +111,17 @@ BasicRenderer::Mesh &Vulkan::BasicRenderer::Mesh::operator=(const Vulkan::BasicR
 
 	vertex_count = other.vertex_count;
 	index_count = other.index_count;
+	index_type = other.index_type;
+	lods = other.lods;
+	meshlets = other.meshlets;
+	vertex_format = other.vertex_format;
+	dequantization = other.dequantization;
 	vertex_buffer = other.vertex_buffer;
 	index_buffer = other.index_buffer;
+	upload_token = other.upload_token;
+	id = next_id++;
+	bounding_sphere = other.bounding_sphere;
+	bounding_box = other.bounding_box;
 
 	return *this;
 }
@@ -67,36 +133,166 @@ BasicRenderer::Mesh &Vulkan::BasicRenderer::Mesh::operator=(Vulkan::BasicRendere
 
 	vertex_count = other.vertex_count;
 	index_count = other.index_count;
+	index_type = other.index_type;
+	lods = std::move(other.lods);
+	meshlets = std::move(other.meshlets);
+	vertex_format = other.vertex_format;
+	dequantization = other.dequantization;
 	vertex_buffer = std::move(other.vertex_buffer);
 	index_buffer = std::move(other.index_buffer);
+	upload_token = other.upload_token;
+	id = other.id;
+	bounding_sphere = other.bounding_sphere;
+	bounding_box = other.bounding_box;
 
 	return *this;
 }
 
+VkIndexType BasicRenderer::Mesh::pick_index_type(u64 vertex_count)
+{
+	if (vertex_count <= std::numeric_limits<u8>::max() + 1u && VulkanInstance::device_features().index_type_uint8)
+		return VK_INDEX_TYPE_UINT8_EXT;
+	if (vertex_count <= std::numeric_limits<u16>::max() + 1u)
+		return VK_INDEX_TYPE_UINT16;
+	return VK_INDEX_TYPE_UINT32;
+}
+
+UploadToken BasicRenderer::Mesh::upload_vertices(const std::vector<Vertex> &verticies)
+{
+	if (vertex_format == VertexFormat::Float) {
+		total_vertex_bytes += vertex_count * sizeof(Vertex);
+		vertex_buffer = Buffer::create_vertex_buffer(vertex_count * sizeof(Vertex), false);
+		return TransferContext::upload(verticies.data(), vertex_count * sizeof(Vertex), vertex_buffer.buffer());
+	}
+
+	// Quantized into a temporary copy, the upload copies it to staging memory right away
+	dequantization = QuantizedVertex::get_dequantization(bounding_box.min, bounding_box.max);
+	std::vector<QuantizedVertex> quantized_vertices(vertex_count);
+	for (u64 i = 0; i < vertex_count; i++)
+		quantized_vertices[i] = QuantizedVertex::quantize(verticies[i], dequantization);
+
+	quantized_mesh_count++;
+	total_vertex_bytes += vertex_count * sizeof(QuantizedVertex);
+	total_vertex_bytes_saved += vertex_count * (sizeof(Vertex) - sizeof(QuantizedVertex));
+
+	vertex_buffer = Buffer::create_vertex_buffer(vertex_count * sizeof(QuantizedVertex), false);
+	return TransferContext::upload(quantized_vertices.data(), vertex_count * sizeof(QuantizedVertex), vertex_buffer.buffer());
+}
+
+UploadToken BasicRenderer::Mesh::upload_indices(const std::vector<u32> &indicies)
+{
+	// Narrowed into a temporary copy, the upload copies it to staging memory right away
+	const u64 total_index_count = indicies.size();
+	std::vector<u8> narrowed_indices;
+	const void *data = indicies.data();
+	u64 index_size = sizeof(u32);
+	u32 type_slot = 2;
+	if (index_type == VK_INDEX_TYPE_UINT8_EXT) {
+		index_size = sizeof(u8);
+		type_slot = 0;
+		narrowed_indices.assign(indicies.begin(), indicies.end());
+		data = narrowed_indices.data();
+	} else if (index_type == VK_INDEX_TYPE_UINT16) {
+		index_size = sizeof(u16);
+		type_slot = 1;
+		narrowed_indices.resize(total_index_count * sizeof(u16));
+		u16 *indices_16 = reinterpret_cast<u16 *>(narrowed_indices.data());
+		for (u64 i = 0; i < total_index_count; i++)
+			indices_16[i] = static_cast<u16>(indicies[i]);
+		data = narrowed_indices.data();
+	}
+
+	index_type_counts[type_slot]++;
+	total_index_bytes += total_index_count * index_size;
+	total_index_bytes_saved += total_index_count * (sizeof(u32) - index_size);
+
+	index_buffer = Buffer::create_index_buffer(total_index_count * index_size, false);
+	return TransferContext::upload(data, total_index_count * index_size, index_buffer.buffer());
+}
+
+BasicRenderer::Mesh::GeometryStatistics BasicRenderer::Mesh::get_geometry_statistics()
+{
+	GeometryStatistics statistics;
+	statistics.uint8_mesh_count = index_type_counts[0];
+	statistics.uint16_mesh_count = index_type_counts[1];
+	statistics.uint32_mesh_count = index_type_counts[2];
+	statistics.index_bytes = total_index_bytes;
+	statistics.index_bytes_saved = total_index_bytes_saved;
+	statistics.quantized_mesh_count = quantized_mesh_count;
+	statistics.vertex_bytes = total_vertex_bytes;
+	statistics.vertex_bytes_saved = total_vertex_bytes_saved;
+	return statistics;
+}
+
+void BasicRenderer::Mesh::log_geometry_statistics()
+{
+	GeometryStatistics statistics = get_geometry_statistics();
+	u64 unnarrowed_bytes = statistics.index_bytes + statistics.index_bytes_saved;
+	CORE_INFO("Mesh indices: %u u8, %u u16 and %u u32 meshes, %lu bytes instead of %lu (%lu saved, %.1f%%)",
+		statistics.uint8_mesh_count, statistics.uint16_mesh_count, statistics.uint32_mesh_count,
+		statistics.index_bytes, unnarrowed_bytes, statistics.index_bytes_saved,
+		unnarrowed_bytes > 0 ? static_cast<f64>(statistics.index_bytes_saved) / unnarrowed_bytes * 100.0 : 0.0);
+
+	u64 unquantized_bytes = statistics.vertex_bytes + statistics.vertex_bytes_saved;
+	CORE_INFO("Mesh vertices: %u quantized meshes, %lu bytes instead of %lu (%lu saved, %.1f%%)",
+		statistics.quantized_mesh_count, statistics.vertex_bytes, unquantized_bytes, statistics.vertex_bytes_saved,
+		unquantized_bytes > 0 ? static_cast<f64>(statistics.vertex_bytes_saved) / unquantized_bytes * 100.0 : 0.0);
+}
+
 //----
 // Renderer
 //----
-VkSemaphore			BasicRenderer::image_available_semaphore = VK_NULL_HANDLE;
-VkSemaphore			BasicRenderer::render_finished_semaphore = VK_NULL_HANDLE;
-VkFence				BasicRenderer::last_frame_presented_fence = VK_NULL_HANDLE;
+
+// Frame-time and fence-wait averages are logged every FRAME_STATISTICS_PERIOD seconds
+static constexpr f64	FRAME_STATISTICS_PERIOD = 5.0;
+
+// Instances each frame can hold before its instance buffer has to grow
+static constexpr u32	INITIAL_INSTANCE_CAPACITY = 1024;
+
+// The coarsest level of detail whose error projects to at most this many pixels is drawn
+static constexpr f32	LOD_PIXEL_ERROR = 1.0f;
+
+std::vector<BasicRenderer::FrameData>	BasicRenderer::frames;
+u32					BasicRenderer::frames_in_flight_count = 0;
+u32					BasicRenderer::current_frame_index = 0;
+std::vector<VkSemaphore>	BasicRenderer::render_finished_semaphores;
 
 bool				BasicRenderer::frame_started = false;
 u32					BasicRenderer::current_image_index = 0;
+bool				BasicRenderer::swapchain_dirty = false;
+BasicRenderer::FrameStatistics	BasicRenderer::statistics;
+RenderQueue			BasicRenderer::render_queue;
+CameraUBO			BasicRenderer::camera{};
+ParallelRecorder	BasicRenderer::recorder;
+std::vector<glm::mat4>	BasicRenderer::lod_transforms[Mesh::MAX_LODS];
 
-Buffer				BasicRenderer::camera_uniform_buffer;
 VkDescriptorPool	BasicRenderer::descriptor_pool = VK_NULL_HANDLE;
-VkDescriptorSet		BasicRenderer::camera_descriptor_set = VK_NULL_HANDLE;
 
 VkCommandPool		BasicRenderer::command_pool = VK_NULL_HANDLE;
-VkCommandBuffer		BasicRenderer::command_buffer = VK_NULL_HANDLE;
 
-bool Vulkan::BasicRenderer::initialize()
+bool Vulkan::BasicRenderer::initialize(u32 frames_in_flight, u32 recording_threads, bool depth_prepass)
 {
+	if (frames_in_flight == 0) {
+		CORE_WARN("BasicRenderer needs at least one frame in flight, using 1");
+		frames_in_flight = 1;
+	}
+	frames_in_flight_count = frames_in_flight;
+	current_frame_index = 0;
+	frames.resize(frames_in_flight_count);
+
 	if (!VulkanInstance::initialize())
 		return false;
+	if (!MemoryAllocator::initialize())
+		return false;
+	if (!TransferContext::initialize())
+		return false;
 	if (!SwapchainManager::initialize())
 		return false;
-	if (!GraphicsPipeline::initialize())
+	if (!ShaderBundle::initialize())
+		return false;
+	if (!PipelineCache::initialize())
+		return false;
+	if (!GraphicsPipeline::initialize(depth_prepass))
 		return false;
 	if (!SwapchainManager::create_framebuffers())
 		return false;
@@ -105,62 +301,114 @@ bool Vulkan::BasicRenderer::initialize()
 		return false;
 	CORE_TRACE("BasicRenderer's sync objects created");
 
-	create_uniform_buffer();
-	CORE_TRACE("BasicRenderer's uniform buffer created");
+	create_uniform_buffers();
+	CORE_TRACE("BasicRenderer's uniform buffers created");
+
+	create_instance_buffers();
+	CORE_TRACE("BasicRenderer's instance buffers created");
 
 	if (!create_descriptor_pool())
 		return false;
 	CORE_TRACE("BasicRenderer's descriptor pool created");
 
-	if (!create_camera_descriptor_set())
+	if (!create_camera_descriptor_sets())
 		return false;
-	CORE_TRACE("BasicRenderer's descrpitor set created");
+	CORE_TRACE("BasicRenderer's descrpitor sets created");
 
 	if (!create_command_pool())
 		return false;
 	CORE_TRACE("BasicRenderer's command pool created");
 
-	if (!create_command_buffer())
+	if (!create_command_buffers())
+		return false;
+	CORE_TRACE("BasicRenderer's command buffers created");
+
+	if (!create_query_pools())
+		return false;
+	if (!GpuProfiler::initialize(frames_in_flight_count))
+		return false;
+
+	if (!GpuDrivenRenderer::initialize(frames_in_flight_count))
+		return false;
+	// Every pipeline exists by now
+	PipelineCache::log_statistics();
+
+	if (recording_threads > 0 && !recorder.initialize(recording_threads, frames_in_flight_count))
 		return false;
-	CORE_TRACE("BasicRenderer's command buffer created");
 
-	CORE_TRACE("BasicRenderer fully initialized!");
+	CORE_TRACE("BasicRenderer fully initialized with %u frames in flight!", frames_in_flight_count);
 	return true;
 }
 
 void Vulkan::BasicRenderer::shutdown()
 {
+	recorder.shutdown();
+	destroy_query_pools();
 	destroy_command_pool();
 	destroy_descriptor_pool();
 	destroy_sync_objects();
-	camera_uniform_buffer.release_ressources();
+	for (auto& frame : frames) {
+		frame.camera_uniform_buffer.release_ressources();
+		frame.instance_buffer.release_ressources();
+		frame.retired_instance_buffers.clear();
+	}
+	frames.clear();
 
+	// The device is idle, whatever was retired while frames were in flight can go
+	DeletionQueue::flush_all();
+	GpuProfiler::shutdown();
+	GpuDrivenRenderer::shutdown();
 	GraphicsPipeline::shutdown();
+	PipelineCache::shutdown();
 	SwapchainManager::shutdown();
+	TransferContext::shutdown();
+	MemoryAllocator::shutdown();
 	VulkanInstance::shutdown();
 }
 
 void Vulkan::BasicRenderer::begin_frame()
 {
+	PROFILE_SCOPE("BasicRenderer::begin_frame");
 	frame_started = false;
-	wait_for_last_frame_finished();
+	f64 frame_start = get_absolute_time();
+
+	// Send the uploads recorded since the last frame in one submission, and release the batches that are done
+	TransferContext::flush();
+	TransferContext::update();
+
+	// Only waits for the frame that used this slot frames_in_flight_count frames ago, the others keep running on the GPU
+	f64 wait_start = get_absolute_time();
+	wait_for_frame_finished();
+	DeletionQueue::flush(current_frame().submitted_frame);
+	GpuProfiler::begin_frame(current_frame_index);
+	read_statistics_query();
+	update_frame_statistics(frame_start, get_absolute_time() - wait_start);
+
+	// Every resize and out of date result since the last frame ends up in a single recreation, before anything of this
+	// frame references the swapchain
+	if (swapchain_dirty || Window::did_resize())
+		recreate_swapchain();
+
+	// The GPU is done with this frame's instances
+	current_frame().instance_count = 0;
+	current_frame().retired_instance_buffers.clear();
+	GpuDrivenRenderer::prepare_frame(current_frame_index);
 
 	auto image_index = get_swapchain_image();
 	if (!image_index.has_value())
 		return ;
 	current_image_index = image_index.value();
 
-	VkResult result = vkResetCommandBuffer(command_buffer, 0);
+	VkResult result = vkResetCommandBuffer(current_frame().command_buffer, 0);
 	if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't reset command buffer of BasicRenderer: %s", vulkan_error_to_string(result));
 		return;
 	}
 
-	if (!begin_command_buffer())
-		return ;
-	begin_renderpass();
-	setup_viewport();
-	setup_camera_ubo();
+	// Nothing is recorded until end_frame(), draws are only queued
+	render_queue.clear();
+	camera = build_camera_ubo();
+	render_queue.set_view(camera.view);
 
 	frame_started = true;
 }
@@ -182,35 +430,142 @@ void
 Vulkan::BasicRenderer::draw(const Vulkan::BasicRenderer::Mesh &mesh,
 	const glm::vec3 &pos, const glm::vec3 &rotation, const glm::vec3 &scale)
 {
+	// Rotation around z, then y, then x, built directly instead of chaining matrix products
+	draw(mesh, TransformStore::compose(pos, glm::quat(rotation), scale));
+}
+
+void BasicRenderer::draw(const BasicRenderer::Mesh &mesh, const glm::mat4 &transform)
+{
+	draw_instanced(mesh, &transform, 1);
+}
+
+void BasicRenderer::draw_instanced(const BasicRenderer::Mesh &mesh, const std::vector<glm::mat4> &transforms)
+{
+	draw_instanced(mesh, transforms.data(), static_cast<u32>(transforms.size()));
+}
+
+void BasicRenderer::draw_instanced(const BasicRenderer::Mesh &mesh, const glm::mat4 *transforms, u32 count)
+{
+	PROFILE_SCOPE("BasicRenderer::draw");
 	if (!frame_started) {
 		CORE_DEBUG("Trying to draw() with BasicRenderer but the frame wasn't started");
 		return ;
 	}
-	VkDeviceSize offsets[] = {0};
-	vkCmdBindVertexBuffers(command_buffer, 0, 1, &mesh.get_vertex_buffer().buffer(), offsets);
-	vkCmdBindIndexBuffer(command_buffer, mesh.get_index_buffer().buffer(), 0, VK_INDEX_TYPE_UINT32);
+	if (count == 0 || !mesh.is_ready())
+		return ;
 
-	// Push constants for model matrix
-	auto model = glm::translate(glm::mat4(1.0f), pos);
-	model = glm::rotate(model, rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
-	model = glm::rotate(model, rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-	model = glm::rotate(model, rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-	model = glm::scale(model, scale);
-	vkCmdPushConstants(command_buffer, GraphicsPipeline::pipeline_layout(),
-		VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(glm::mat4), &model);
+	const auto& lods = mesh.get_lods();
+	if (lods.empty())
+		return ;
 
-	vkCmdDrawIndexed(command_buffer, mesh.get_index_count(), 1, 0, 0, 0);
+	RenderQueue::MeshBinding binding;
+	binding.vertex_buffer = mesh.get_vertex_buffer().buffer();
+	binding.index_buffer = mesh.get_index_buffer().buffer();
+	binding.index_type = mesh.get_index_type();
+	binding.dequantization = mesh.get_dequantization();
+	binding.bounding_sphere = mesh.get_bounding_sphere();
+	// The vertex format doubles as the pipeline id, the batches end up grouped by format
+	const u32 pipeline = static_cast<u32>(mesh.get_vertex_format());
+
+	if (lods.size() == 1) {
+		binding.index_count = lods[0].index_count;
+		render_queue.push(pipeline, mesh.get_id(), 0, binding, transforms, count);
+		return ;
+	}
+
+	// Each level is queued as a mesh of its own, sharing the buffers
+	for (u32 i = 0; i < count; i++)
+		lod_transforms[select_lod(mesh, transforms[i])].push_back(transforms[i]);
+	for (u32 lod = 0; lod < lods.size(); lod++) {
+		if (lod_transforms[lod].empty())
+			continue ;
+
+		binding.first_index = lods[lod].first_index;
+		binding.index_count = lods[lod].index_count;
+		binding.triangles_saved = (lods[0].index_count - lods[lod].index_count) / 3;
+		render_queue.push(pipeline, mesh.get_id(), lod, binding, lod_transforms[lod].data(),
+			static_cast<u32>(lod_transforms[lod].size()));
+		lod_transforms[lod].clear();
+	}
+}
+
+u32 BasicRenderer::select_lod(const Mesh &mesh, const glm::mat4 &transform)
+{
+	// Errors are in model space, the largest scale of the transform brings them to world space
+	const glm::vec4& sphere = mesh.get_bounding_sphere();
+	f32 scale = std::sqrt(std::max({glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+		glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])), glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))}));
+
+	// Projected at the point of the bounding sphere closest to the camera, from inside it nothing but the full mesh will do
+	glm::vec4 view_center = camera.view * transform * glm::vec4(glm::vec3(sphere), 1.0f);
+	f32 distance = -view_center.z - sphere.w * scale;
+	if (distance <= 0.0f)
+		return 0;
+
+	// proj[1][1] is the cotangent of half the vertical field of view, negated for Vulkan
+	f32 pixels_per_unit = std::abs(camera.proj[1][1]) * 0.5f * SwapchainManager::swapchain_extent().height / distance;
+	const auto& lods = mesh.get_lods();
+	u32 selected = 0;
+	for (u32 lod = 1; lod < lods.size() && lods[lod].error * scale * pixels_per_unit <= LOD_PIXEL_ERROR; lod++)
+		selected = lod;
+	return selected;
 }
 
 void Vulkan::BasicRenderer::end_frame()
 {
-	vkResetFences(VulkanInstance::logical_device(), 1, &last_frame_presented_fence);
-	end_renderpass();
+	PROFILE_SCOPE("BasicRenderer::end_frame");
+	if (!frame_started)
+		return ;
+	frame_started = false;
+
+	if (!begin_command_buffer())
+		return ;
+	VkCommandBuffer command_buffer = current_frame().command_buffer;
+	GpuProfiler::reset_queries(command_buffer);
+	u32 frame_scope = GpuProfiler::begin_scope(command_buffer, "Frame");
+
+	// The render queue is culled against the frustum and written out before anything is recorded, its occlusion culling is
+	// a compute pass too
+	setup_camera_ubo();
+	auto base_instance = prepare_render_queue();
+
+	// Culling is a compute pass, it has to be recorded before the render pass begins
+	{
+		GpuProfiler::Scope scope(command_buffer, "Culling");
+		GpuDrivenRenderer::record_culling(command_buffer, current_frame_index, camera.proj * camera.view,
+			glm::vec3(glm::inverse(camera.view)[3]));
+		if (base_instance.has_value())
+			GpuDrivenRenderer::record_queue_culling(command_buffer, current_frame_index, render_queue, current_frame().instance_buffer,
+				base_instance.value());
+	}
+
+	// Occlusion culling splits the frame in two render passes around the build of the depth pyramid
+	const bool occlusion_culling = GpuDrivenRenderer::occlusion_culling_active(current_frame_index);
+	VkRenderPass render_pass = occlusion_culling ? GraphicsPipeline::early_render_pass() : GraphicsPipeline::render_pass();
+	begin_statistics_query();
+	{
+		// Timestamps stay outside of the render pass, its contents may only be secondary command buffers
+		GpuProfiler::Scope scope(command_buffer, occlusion_culling ? "Early pass" : "Main pass");
+		if (recorder.worker_count() > 0)
+			record_parallel(render_pass, base_instance);
+		else
+			record_inline(render_pass, base_instance);
+		end_renderpass();
+	}
+	if (occlusion_culling)
+		record_late_pass();
+	end_statistics_query();
+	GpuProfiler::end_scope(command_buffer, frame_scope);
 	if (!end_command_buffer())
 		return ;
+
+	// The fence is only reset when something will signal it, otherwise the next wait on it would never return
+	vkResetFences(VulkanInstance::logical_device(), 1, &current_frame().in_flight_fence);
 	if (!submit_command_buffer())
 		return ;
 	present_frame();
+
+	current_frame_index = (current_frame_index + 1) % frames_in_flight_count;
 }
 
 bool Vulkan::BasicRenderer::create_sync_objects()
@@ -222,11 +577,30 @@ bool Vulkan::BasicRenderer::create_sync_objects()
 	fence_infos.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fence_infos.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	if (vkCreateSemaphore(VulkanInstance::logical_device(), &semaphore_infos, nullptr, &image_available_semaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(VulkanInstance::logical_device(), &semaphore_infos, nullptr, &render_finished_semaphore) != VK_SUCCESS ||
-		vkCreateFence(VulkanInstance::logical_device(), &fence_infos, nullptr, &last_frame_presented_fence) != VK_SUCCESS) {
-		CORE_ERROR("Couldn't create BasicRenderer's sync objects!");
-		return false;
+	for (auto& frame : frames) {
+		if (vkCreateSemaphore(VulkanInstance::logical_device(), &semaphore_infos, nullptr, &frame.image_available_semaphore) != VK_SUCCESS ||
+			vkCreateFence(VulkanInstance::logical_device(), &fence_infos, nullptr, &frame.in_flight_fence) != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create BasicRenderer's sync objects!");
+			return false;
+		}
+	}
+	return create_present_semaphores();
+}
+
+bool BasicRenderer::create_present_semaphores()
+{
+	if (Window::is_headless())
+		return true;
+
+	VkSemaphoreCreateInfo semaphore_infos{};
+	semaphore_infos.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	render_finished_semaphores.resize(SwapchainManager::swapchain_images().size(), VK_NULL_HANDLE);
+	for (auto& semaphore : render_finished_semaphores) {
+		if (vkCreateSemaphore(VulkanInstance::logical_device(), &semaphore_infos, nullptr, &semaphore) != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create BasicRenderer's present semaphores!");
+			return false;
+		}
 	}
 	return true;
 }
@@ -235,13 +609,13 @@ bool Vulkan::BasicRenderer::create_descriptor_pool()
 {
 	VkDescriptorPoolSize pool_size{};
 	pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	pool_size.descriptorCount = 1;
+	pool_size.descriptorCount = frames_in_flight_count;
 
 	VkDescriptorPoolCreateInfo create_infos{};
 	create_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	create_infos.poolSizeCount = 1;
 	create_infos.pPoolSizes = &pool_size;
-	create_infos.maxSets = 1;
+	create_infos.maxSets = frames_in_flight_count;
 
 	if (vkCreateDescriptorPool(VulkanInstance::logical_device(), &create_infos, nullptr, &descriptor_pool) != VK_SUCCESS) {
 		CORE_ERROR("Couldn't create BasicRenderer's descriptor pool");
@@ -250,54 +624,89 @@ bool Vulkan::BasicRenderer::create_descriptor_pool()
 	return true;
 }
 
-bool Vulkan::BasicRenderer::create_camera_descriptor_set()
+bool Vulkan::BasicRenderer::create_camera_descriptor_sets()
 {
-	VkDescriptorSetLayout layouts[] = {GraphicsPipeline::descriptor_set_layout()};
+	std::vector<VkDescriptorSetLayout> layouts(frames_in_flight_count, GraphicsPipeline::descriptor_set_layout());
+	std::vector<VkDescriptorSet> descriptor_sets(frames_in_flight_count);
+
 	VkDescriptorSetAllocateInfo alloc_infos{};
 	alloc_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	alloc_infos.descriptorPool = descriptor_pool;
-	alloc_infos.descriptorSetCount = 1;
-	alloc_infos.pSetLayouts = layouts;
+	alloc_infos.descriptorSetCount = frames_in_flight_count;
+	alloc_infos.pSetLayouts = layouts.data();
 
-	VkResult result = vkAllocateDescriptorSets(VulkanInstance::logical_device(), &alloc_infos, &camera_descriptor_set);
+	VkResult result = vkAllocateDescriptorSets(VulkanInstance::logical_device(), &alloc_infos, descriptor_sets.data());
 	if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't create BasicRenderer's descriptor sets: %s", vulkan_error_to_string(result));
 		return false;
 	}
 
-	VkDescriptorBufferInfo buffer_info{};
-	buffer_info.buffer = camera_uniform_buffer.buffer();
-	buffer_info.offset = 0;
-	buffer_info.range = sizeof(CameraUBO);
-
-	VkWriteDescriptorSet desc_write{};
-	desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	desc_write.dstSet = camera_descriptor_set;
-	desc_write.dstBinding = 0;
-	desc_write.dstArrayElement = 0;
-	desc_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	desc_write.descriptorCount = 1;
-	desc_write.pBufferInfo = &buffer_info;
-	desc_write.pImageInfo = nullptr;
-	desc_write.pTexelBufferView = nullptr;
-	vkUpdateDescriptorSets(VulkanInstance::logical_device(), 1, &desc_write, 0, nullptr);
+	for (u32 i = 0; i < frames_in_flight_count; i++) {
+		frames[i].camera_descriptor_set = descriptor_sets[i];
+
+		VkDescriptorBufferInfo buffer_info{};
+		buffer_info.buffer = frames[i].camera_uniform_buffer.buffer();
+		buffer_info.offset = 0;
+		buffer_info.range = sizeof(CameraUBO);
+
+		VkWriteDescriptorSet desc_write{};
+		desc_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		desc_write.dstSet = frames[i].camera_descriptor_set;
+		desc_write.dstBinding = 0;
+		desc_write.dstArrayElement = 0;
+		desc_write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		desc_write.descriptorCount = 1;
+		desc_write.pBufferInfo = &buffer_info;
+		desc_write.pImageInfo = nullptr;
+		desc_write.pTexelBufferView = nullptr;
+		vkUpdateDescriptorSets(VulkanInstance::logical_device(), 1, &desc_write, 0, nullptr);
+	}
 
 	return true;
 }
 
-void Vulkan::BasicRenderer::create_uniform_buffer()
+void Vulkan::BasicRenderer::create_uniform_buffers()
 {
-	camera_uniform_buffer = Buffer::create_uniform_buffer(sizeof(CameraUBO), true);
+	// One per frame, the CPU would otherwise overwrite the camera of a frame the GPU is still drawing
+	for (auto& frame : frames)
+		frame.camera_uniform_buffer = Buffer::create_uniform_buffer(sizeof(CameraUBO), true);
+}
+
+void Vulkan::BasicRenderer::create_instance_buffers()
+{
+	for (auto& frame : frames) {
+		frame.instance_buffer = Buffer(INITIAL_INSTANCE_CAPACITY * sizeof(InstanceData),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		frame.instance_capacity = INITIAL_INSTANCE_CAPACITY;
+		frame.instance_count = 0;
+	}
 }
 
 void BasicRenderer::destroy_sync_objects()
 {
-	if (image_available_semaphore != VK_NULL_HANDLE)
-		vkDestroySemaphore(VulkanInstance::logical_device(), image_available_semaphore, nullptr);
-	if (render_finished_semaphore != VK_NULL_HANDLE)
-		vkDestroySemaphore(VulkanInstance::logical_device(), render_finished_semaphore, nullptr);
-	if (last_frame_presented_fence != VK_NULL_HANDLE)
-		vkDestroyFence(VulkanInstance::logical_device(), last_frame_presented_fence, nullptr);
+	for (auto& frame : frames) {
+		if (frame.image_available_semaphore != VK_NULL_HANDLE)
+			vkDestroySemaphore(VulkanInstance::logical_device(), frame.image_available_semaphore, nullptr);
+		if (frame.in_flight_fence != VK_NULL_HANDLE)
+			vkDestroyFence(VulkanInstance::logical_device(), frame.in_flight_fence, nullptr);
+		frame.image_available_semaphore = VK_NULL_HANDLE;
+		frame.in_flight_fence = VK_NULL_HANDLE;
+	}
+	destroy_present_semaphores();
+}
+
+void BasicRenderer::destroy_present_semaphores(bool deferred)
+{
+	for (VkSemaphore semaphore : render_finished_semaphores) {
+		if (semaphore == VK_NULL_HANDLE)
+			continue ;
+		if (deferred)
+			DeletionQueue::push([semaphore]() { vkDestroySemaphore(VulkanInstance::logical_device(), semaphore, nullptr); });
+		else
+			vkDestroySemaphore(VulkanInstance::logical_device(), semaphore, nullptr);
+	}
+	render_finished_semaphores.clear();
 }
 
 void BasicRenderer::destroy_descriptor_pool()
@@ -305,22 +714,36 @@ void BasicRenderer::destroy_descriptor_pool()
 	// Descriptor sets are implicitly destroyed when the pool is destroyed
 	if (descriptor_pool != VK_NULL_HANDLE)
 		vkDestroyDescriptorPool(VulkanInstance::logical_device(), descriptor_pool, nullptr);
+	descriptor_pool = VK_NULL_HANDLE;
 }
 
-void BasicRenderer::wait_for_last_frame_finished()
+void BasicRenderer::wait_for_frame_finished()
 {
+	PROFILE_SCOPE("Fence wait");
 	// TODO: Add a timeout checking instead of waiting indefinitely
-	vkWaitForFences(VulkanInstance::logical_device(), 1, &last_frame_presented_fence, VK_TRUE, std::numeric_limits<u64>::max());
+	vkWaitForFences(VulkanInstance::logical_device(), 1, &current_frame().in_flight_fence, VK_TRUE, std::numeric_limits<u64>::max());
 }
 
 std::optional<u32> BasicRenderer::get_swapchain_image()
 {
+	PROFILE_SCOPE("Swapchain acquire");
+	// Nothing to wait for, the image_available semaphore is never used
+	if (Window::is_headless())
+		return SwapchainManager::acquire_offscreen_image();
+
+	// The last recreation failed or the window is minimized, the frame is skipped until it succeeds
+	if (SwapchainManager::swapchain() == VK_NULL_HANDLE)
+		return {};
+
 	u32 image_index;
 	VkResult result = vkAcquireNextImageKHR(VulkanInstance::logical_device(), SwapchainManager::swapchain(),
-		std::numeric_limits<u64>::max(), image_available_semaphore, VK_NULL_HANDLE, &image_index);
+		std::numeric_limits<u64>::max(), current_frame().image_available_semaphore, VK_NULL_HANDLE, &image_index);
 
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		SwapchainManager::recreate();
+	// A suboptimal image was still acquired and its semaphore will be signaled, the frame goes on with it
+	if (result == VK_SUBOPTIMAL_KHR) {
+		swapchain_dirty = true;
+	} else if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		swapchain_dirty = true;
 		return {};
 	} else if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't acquire BasicRenderer's next swapchain image for rendering: %s", vulkan_error_to_string(result));
@@ -330,6 +753,20 @@ std::optional<u32> BasicRenderer::get_swapchain_image()
 	return image_index;
 }
 
+void BasicRenderer::recreate_swapchain()
+{
+	// Stays dirty while the window is minimized, recreation is tried again next frame.
+	// The depth pyramid is built from the depth buffer, which is recreated along with the swapchain
+	swapchain_dirty = !SwapchainManager::recreate();
+	if (swapchain_dirty)
+		return ;
+	GpuDrivenRenderer::on_swapchain_recreated();
+
+	// The image count may change, and the old images' semaphores can still be waited on by their presents
+	destroy_present_semaphores(true);
+	swapchain_dirty = !create_present_semaphores();
+}
+
 bool BasicRenderer::create_command_pool()
 {
 	QueueFamilyIndices queue_indices = VulkanInstance::get_queues_for_device(VulkanInstance::physical_device());
@@ -348,19 +785,24 @@ bool BasicRenderer::create_command_pool()
 	return true;
 }
 
-bool BasicRenderer::create_command_buffer()
-{	VkCommandBufferAllocateInfo alloc_infos{};
+bool BasicRenderer::create_command_buffers()
+{
+	std::vector<VkCommandBuffer> command_buffers(frames_in_flight_count);
+
+	VkCommandBufferAllocateInfo alloc_infos{};
 	alloc_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	alloc_infos.commandPool = command_pool;
 	alloc_infos.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	alloc_infos.commandBufferCount = 1;
+	alloc_infos.commandBufferCount = frames_in_flight_count;
 
-	VkResult  result = vkAllocateCommandBuffers(VulkanInstance::logical_device(), &alloc_infos, &command_buffer);
+	VkResult  result = vkAllocateCommandBuffers(VulkanInstance::logical_device(), &alloc_infos, command_buffers.data());
 	if (result != VK_SUCCESS) {
-		CORE_ERROR("Couldn't create BasicRenderer's command buffer: %s", vulkan_error_to_string(result));
+		CORE_ERROR("Couldn't create BasicRenderer's command buffers: %s", vulkan_error_to_string(result));
 		return false;
 	}
 
+	for (u32 i = 0; i < frames_in_flight_count; i++)
+		frames[i].command_buffer = command_buffers[i];
 	return true;
 }
 
@@ -371,7 +813,7 @@ bool BasicRenderer::begin_command_buffer()
 	begin_infos.flags = 0;
 	begin_infos.pInheritanceInfo = nullptr;
 
-	VkResult result = vkBeginCommandBuffer(command_buffer, &begin_infos);
+	VkResult result = vkBeginCommandBuffer(current_frame().command_buffer, &begin_infos);
 	if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't begin BasicRenderer's command buffer: %s", vulkan_error_to_string(result));
 		return false;
@@ -379,24 +821,25 @@ bool BasicRenderer::begin_command_buffer()
 	return true;
 }
 
-void BasicRenderer::begin_renderpass()
+void BasicRenderer::begin_renderpass(VkSubpassContents contents, VkRenderPass render_pass)
 {
 	VkRenderPassBeginInfo render_pass_infos{};
 	render_pass_infos.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	render_pass_infos.renderPass = GraphicsPipeline::render_pass();
+	render_pass_infos.renderPass = render_pass;
 	render_pass_infos.framebuffer = SwapchainManager::swapchain_framebuffers()[current_image_index];
 	render_pass_infos.renderArea.offset = {0, 0};
 	render_pass_infos.renderArea.extent = SwapchainManager::swapchain_extent();
 
-	VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-	render_pass_infos.clearValueCount = 1;
-	render_pass_infos.pClearValues = &clear_color;
+	VkClearValue clear_values[2]{};
+	clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	clear_values[1].depthStencil = {1.0f, 0};
+	render_pass_infos.clearValueCount = 2;
+	render_pass_infos.pClearValues = clear_values;
 
-	vkCmdBeginRenderPass(command_buffer, &render_pass_infos, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline::pipeline());
+	vkCmdBeginRenderPass(current_frame().command_buffer, &render_pass_infos, contents);
 }
 
-void BasicRenderer::setup_viewport()
+void BasicRenderer::setup_viewport(VkCommandBuffer command_buffer)
 {
 	VkViewport viewport{};
 	viewport.x = 0.0f;
@@ -415,12 +858,12 @@ void BasicRenderer::setup_viewport()
 
 void BasicRenderer::end_renderpass()
 {
-	vkCmdEndRenderPass(command_buffer);
+	vkCmdEndRenderPass(current_frame().command_buffer);
 }
 
 bool BasicRenderer::end_command_buffer()
 {
-	VkResult result = vkEndCommandBuffer(command_buffer);
+	VkResult result = vkEndCommandBuffer(current_frame().command_buffer);
 	if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't end BasicRenderer's command buffer: %s", vulkan_error_to_string(result));
 		return false;
@@ -430,41 +873,49 @@ bool BasicRenderer::end_command_buffer()
 
 bool BasicRenderer::submit_command_buffer()
 {
+	// Headless nothing is acquired nor presented, a semaphore signaled and never waited on couldn't be signaled again
+	const u32 semaphore_count = Window::is_headless() ? 0 : 1;
+
 	VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
 	VkSubmitInfo submit_infos{};
 	submit_infos.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submit_infos.waitSemaphoreCount = 1;
-	submit_infos.pWaitSemaphores = &image_available_semaphore;
+	submit_infos.waitSemaphoreCount = semaphore_count;
+	submit_infos.pWaitSemaphores = &current_frame().image_available_semaphore;
 	submit_infos.pWaitDstStageMask = wait_stages;
 	submit_infos.commandBufferCount = 1;
-	submit_infos.pCommandBuffers = &command_buffer;
-	submit_infos.signalSemaphoreCount = 1;
-	submit_infos.pSignalSemaphores = &render_finished_semaphore;
+	submit_infos.pCommandBuffers = &current_frame().command_buffer;
+	submit_infos.signalSemaphoreCount = semaphore_count;
+	submit_infos.pSignalSemaphores = semaphore_count > 0 ? &render_finished_semaphores[current_image_index] : nullptr;
 
-	VkResult result = vkQueueSubmit(VulkanInstance::graphics_queue(), 1, &submit_infos, last_frame_presented_fence);
+	VkResult result = vkQueueSubmit(VulkanInstance::graphics_queue(), 1, &submit_infos, current_frame().in_flight_fence);
 	if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't submit BasicRenderer's draw command buffer: %s", vulkan_error_to_string(result));
 		return false;
 	}
+	current_frame().submitted_frame = DeletionQueue::frame_submitted();
 	return true;
 }
 
 bool BasicRenderer::present_frame()
 {
+	if (Window::is_headless())
+		return true;
+	PROFILE_SCOPE("Present");
+
 	VkSwapchainKHR swapchains[] = {SwapchainManager::swapchain()};
 
 	VkPresentInfoKHR present_infos{};
 	present_infos.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	present_infos.waitSemaphoreCount = 1;
-	present_infos.pWaitSemaphores = &render_finished_semaphore;
+	present_infos.pWaitSemaphores = &render_finished_semaphores[current_image_index];
 	present_infos.swapchainCount = 1;
 	present_infos.pSwapchains = swapchains;
 	present_infos.pImageIndices = &current_image_index;
 	present_infos.pResults = nullptr;
 
 	VkResult result = vkQueuePresentKHR(VulkanInstance::present_queue(), &present_infos);
-	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || Window::did_resize()) {
-		SwapchainManager::recreate();
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+		swapchain_dirty = true;
 	} else if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't present BasicRenderer's swap chain image: %s", vulkan_error_to_string(result));
 		return false;
@@ -472,21 +923,371 @@ bool BasicRenderer::present_frame()
 	return true;
 }
 
-void BasicRenderer::setup_camera_ubo()
+CameraUBO BasicRenderer::build_camera_ubo()
 {
 	CameraUBO ubo{};
 	ubo.view = glm::lookAt(glm::vec3(0.0f, 3.0f, -5.0f), glm::vec3(2.5f, -2.5f, 2.5f), glm::vec3(0.0f, 0.0f, 1.0f));
 	ubo.proj = glm::perspective(glm::radians(45.0f),
 		(float) SwapchainManager::swapchain_extent().width / (float) SwapchainManager::swapchain_extent().height, 0.1f, 10.0f);
 	ubo.proj[1][1] *= -1;
-	camera_uniform_buffer.set_data(&ubo, sizeof(CameraUBO));
+	return ubo;
+}
+
+void BasicRenderer::setup_camera_ubo()
+{
+	current_frame().camera_uniform_buffer.set_data(&camera, sizeof(CameraUBO));
+}
+
+std::optional<u32> BasicRenderer::prepare_render_queue()
+{
+	// Everything outside the camera is dropped before it can cost a draw or an instance
+	f64 cull_start = get_absolute_time();
+	render_queue.cull(Frustum::from_view_projection(camera.proj * camera.view));
+	statistics.cull_time += get_absolute_time() - cull_start;
+
+	render_queue.sort_and_merge();
+	statistics.instances_tested += render_queue.statistics().instances_tested;
+	statistics.instances_culled += render_queue.statistics().instances_culled;
+	statistics.draws_eliminated += render_queue.statistics().draws_eliminated;
+	statistics.binds_eliminated += render_queue.statistics().binds_eliminated;
+	for (const auto& batch : render_queue.batches()) {
+		const RenderQueue::MeshBinding& mesh = render_queue.mesh(batch.mesh_slot);
+		statistics.triangles_drawn += static_cast<u64>(mesh.index_count / 3) * batch.instance_count;
+		statistics.triangles_saved_by_lod += static_cast<u64>(mesh.triangles_saved) * batch.instance_count;
+	}
+	if (render_queue.batches().empty())
+		return {};
+
+	// The instances of the whole frame are written at once, in the order of the batches
+	const auto& transforms = render_queue.sorted_transforms();
+	return write_instances(transforms.data(), static_cast<u32>(transforms.size()));
+}
+
+void BasicRenderer::bind_frame_state(VkCommandBuffer command_buffer)
+{
+	// Secondary command buffers inherit none of this, each one binds it again. The pipelines are bound by each pass
+	setup_viewport(command_buffer);
 	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
-		GraphicsPipeline::pipeline_layout(), 0, 1, &camera_descriptor_set, 0, nullptr);
+		GraphicsPipeline::pipeline_layout(), 0, 1, &current_frame().camera_descriptor_set, 0, nullptr);
+
+	// The occlusion culling copies the visible instances of each batch to the start of its range
+	VkBuffer instance_buffer = current_frame().instance_buffer.buffer();
+	if (GpuDrivenRenderer::queue_culling_active(current_frame_index))
+		instance_buffer = GpuDrivenRenderer::queue_instance_buffer(current_frame_index);
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(command_buffer, 1, 1, &instance_buffer, &offset);
+}
+
+void BasicRenderer::record_batches(VkCommandBuffer command_buffer, u32 base_instance, u32 first, u32 count, bool depth_prepass,
+	bool late_pass)
+{
+	const auto& batches = render_queue.batches();
+	const bool culled = GpuDrivenRenderer::queue_culling_active(current_frame_index);
+	VkDeviceSize offset = 0;
+	// The levels of detail of a mesh share its buffers, switching between them only changes the draw
+	VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+	VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+	u32 bound_pipeline = std::numeric_limits<u32>::max();
+	for (u32 i = first; i < first + count; i++) {
+		const RenderQueue::DrawBatch& batch = batches[i];
+		const RenderQueue::MeshBinding& mesh = render_queue.mesh(batch.mesh_slot);
+		if (batch.pipeline != bound_pipeline) {
+			bool quantized = static_cast<VertexFormat>(batch.pipeline) == VertexFormat::Quantized;
+			if (depth_prepass)
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					quantized ? GraphicsPipeline::quantized_depth_pipeline() : GraphicsPipeline::depth_pipeline());
+			else
+				vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+					quantized ? GraphicsPipeline::quantized_pipeline() : GraphicsPipeline::pipeline());
+			bound_pipeline = batch.pipeline;
+		}
+		if (mesh.vertex_buffer != bound_vertex_buffer || mesh.index_buffer != bound_index_buffer) {
+			vkCmdBindVertexBuffers(command_buffer, 0, 1, &mesh.vertex_buffer, &offset);
+			vkCmdBindIndexBuffer(command_buffer, mesh.index_buffer, 0, mesh.index_type);
+			if (static_cast<VertexFormat>(batch.pipeline) == VertexFormat::Quantized)
+				vkCmdPushConstants(command_buffer, GraphicsPipeline::pipeline_layout(), VK_SHADER_STAGE_VERTEX_BIT,
+					0, sizeof(VertexDequantization), &mesh.dequantization);
+			bound_vertex_buffer = mesh.vertex_buffer;
+			bound_index_buffer = mesh.index_buffer;
+		}
+		if (culled)
+			GpuDrivenRenderer::record_queue_draw(command_buffer, current_frame_index, i, late_pass);
+		else
+			vkCmdDrawIndexed(command_buffer, mesh.index_count, batch.instance_count, mesh.first_index, 0, base_instance + batch.first_instance);
+	}
+}
+
+void BasicRenderer::record_slice(VkCommandBuffer command_buffer, u32 base_instance, u32 first, u32 count, bool last_slice,
+	bool depth_prepass, bool late_pass)
+{
+	// Bound again for every pass, the GPU-driven draws of the previous one leave their own layout's sets behind
+	bind_frame_state(command_buffer);
+	if (count > 0)
+		record_batches(command_buffer, base_instance, first, count, depth_prepass, late_pass);
+
+	// The GPU-driven draws close the frame, in the last slice
+	if (last_slice)
+		GpuDrivenRenderer::record_draws(command_buffer, current_frame_index, current_frame().camera_descriptor_set, depth_prepass);
+}
+
+void BasicRenderer::record_inline(VkRenderPass render_pass, std::optional<u32> base_instance)
+{
+	VkCommandBuffer command_buffer = current_frame().command_buffer;
+	begin_renderpass(VK_SUBPASS_CONTENTS_INLINE, render_pass);
+	const u32 batch_count = base_instance.has_value() ? static_cast<u32>(render_queue.batches().size()) : 0;
+
+	// The depth of the whole frame is laid down first, then each pixel is shaded once
+	if (GraphicsPipeline::depth_prepass_enabled())
+		record_slice(command_buffer, base_instance.value_or(0), 0, batch_count, true, true);
+	record_slice(command_buffer, base_instance.value_or(0), 0, batch_count, true, false);
+}
+
+void BasicRenderer::record_parallel(VkRenderPass render_pass, std::optional<u32> base_instance)
+{
+	// Once the render pass begins with secondary contents, the primary command buffer can only execute them
+	begin_renderpass(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, render_pass);
+
+	// Culling, sorting and the instance upload stayed on this thread, the workers only record
+	const u32 batch_count = base_instance.has_value() ? static_cast<u32>(render_queue.batches().size()) : 0;
+
+	VkCommandBufferInheritanceInfo inheritance{};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = render_pass;
+	inheritance.subpass = 0;
+	inheritance.framebuffer = SwapchainManager::swapchain_framebuffers()[current_image_index];
+	if (current_frame().statistics_query_pending)
+		inheritance.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	// Each slice only has its own depth before shading, the later slices can still cover what it shaded
+	auto command_buffers = recorder.record(current_frame_index, inheritance, batch_count,
+		[&base_instance, batch_count](VkCommandBuffer command_buffer, u32 first, u32 count) {
+			bool last_slice = first + count == batch_count;
+			if (GraphicsPipeline::depth_prepass_enabled())
+				record_slice(command_buffer, base_instance.value_or(0), first, count, last_slice, true);
+			record_slice(command_buffer, base_instance.value_or(0), first, count, last_slice, false);
+		});
+
+	if (!command_buffers.empty())
+		vkCmdExecuteCommands(current_frame().command_buffer, static_cast<u32>(command_buffers.size()), command_buffers.data());
+}
+
+void BasicRenderer::record_late_pass()
+{
+	// Everything drawn so far is an occluder, the objects and instances it hid never get a draw command
+	VkCommandBuffer command_buffer = current_frame().command_buffer;
+	{
+		GpuProfiler::Scope scope(command_buffer, "Occlusion culling");
+		GpuDrivenRenderer::record_occlusion_culling(command_buffer, current_frame_index);
+	}
+
+	// Only what came into view is left, on top of the early pass's color and depth: the render queue's instances the last
+	// pyramid hid but this one doesn't, then the GPU-driven objects
+	GpuProfiler::Scope scope(command_buffer, "Late pass");
+	begin_renderpass(VK_SUBPASS_CONTENTS_INLINE, GraphicsPipeline::late_render_pass());
+	const u32 batch_count = GpuDrivenRenderer::queue_culling_active(current_frame_index)
+		? static_cast<u32>(render_queue.batches().size()) : 0;
+	if (GraphicsPipeline::depth_prepass_enabled())
+		record_slice(command_buffer, 0, 0, batch_count, true, true, true);
+	record_slice(command_buffer, 0, 0, batch_count, true, false, true);
+	end_renderpass();
+}
+
+std::optional<u32> BasicRenderer::write_instances(const glm::mat4 *transforms, u32 count)
+{
+	FrameData& frame = current_frame();
+	if (frame.instance_count + count > frame.instance_capacity && !grow_instance_buffer(count))
+		return {};
+
+	// InstanceData only holds the model matrix, so the transforms can be copied as is
+	static_assert(sizeof(InstanceData) == sizeof(glm::mat4));
+	u32 first_instance = frame.instance_count;
+	frame.instance_buffer.set_data(transforms, count * sizeof(InstanceData), first_instance * sizeof(InstanceData));
+	frame.instance_count += count;
+	return first_instance;
+}
+
+bool BasicRenderer::grow_instance_buffer(u32 required_capacity)
+{
+	FrameData& frame = current_frame();
+	u32 new_capacity = std::max(frame.instance_capacity * 2, required_capacity);
+
+	Buffer new_buffer(new_capacity * sizeof(InstanceData), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (new_buffer.buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't grow BasicRenderer's instance buffer to %u instances", new_capacity);
+		return false;
+	}
+
+	// Draws recorded earlier in the frame keep reading from the old buffer, the new one starts empty
+	frame.retired_instance_buffers.push_back(std::move(frame.instance_buffer));
+	frame.instance_buffer = std::move(new_buffer);
+	frame.instance_capacity = new_capacity;
+	frame.instance_count = 0;
+	CORE_DEBUG("BasicRenderer's instance buffer grew to %u instances", new_capacity);
+	return true;
+}
+
+void BasicRenderer::update_frame_statistics(f64 frame_start, f64 fence_wait)
+{
+	if (statistics.last_frame_start > 0.0) {
+		statistics.frame_time += frame_start - statistics.last_frame_start;
+		statistics.fence_wait_time += fence_wait;
+		statistics.frame_count++;
+	} else {
+		statistics.last_report = frame_start;
+	}
+	statistics.last_frame_start = frame_start;
+
+	if (frame_start - statistics.last_report < FRAME_STATISTICS_PERIOD || statistics.frame_count == 0)
+		return ;
+
+	// The fence wait is the part of the frame where the CPU sits idle waiting for the GPU, it shrinks as frames overlap
+	f64 average_frame = statistics.frame_time / statistics.frame_count;
+	f64 average_wait = statistics.fence_wait_time / statistics.frame_count;
+	CORE_INFO("BasicRenderer: %u frames in flight, %.3f ms per frame (%.1f fps), %.3f ms waiting on fences (%.1f%%)",
+		frames_in_flight_count, average_frame * 1000.0, 1.0 / average_frame, average_wait * 1000.0,
+		average_frame > 0.0 ? average_wait / average_frame * 100.0 : 0.0);
+	CORE_INFO("BasicRenderer: the render queue eliminated %.1f draws and %.1f binds per frame",
+		static_cast<f64>(statistics.draws_eliminated) / statistics.frame_count,
+		static_cast<f64>(statistics.binds_eliminated) / statistics.frame_count);
+	CORE_INFO("BasicRenderer: culled %.1f of %.1f instances per frame in %.3f ms",
+		static_cast<f64>(statistics.instances_culled) / statistics.frame_count,
+		static_cast<f64>(statistics.instances_tested) / statistics.frame_count,
+		statistics.cull_time / statistics.frame_count * 1000.0);
+	u64 full_detail_triangles = statistics.triangles_drawn + statistics.triangles_saved_by_lod;
+	CORE_INFO("BasicRenderer: drew %.1f triangles per frame, levels of detail saved %.1f (%.1f%%)",
+		static_cast<f64>(statistics.triangles_drawn) / statistics.frame_count,
+		static_cast<f64>(statistics.triangles_saved_by_lod) / statistics.frame_count,
+		full_detail_triangles > 0 ? static_cast<f64>(statistics.triangles_saved_by_lod) / full_detail_triangles * 100.0 : 0.0);
+
+	// Overdraw: every fragment shaded more than once per pixel was wasted work
+	if (statistics.fragment_query_count > 0) {
+		f64 invocations = static_cast<f64>(statistics.fragment_invocations) / statistics.fragment_query_count;
+		f64 pixels = static_cast<f64>(SwapchainManager::swapchain_extent().width) * SwapchainManager::swapchain_extent().height;
+		CORE_INFO("BasicRenderer: %.0f fragment shader invocations per frame, %.2f per pixel, depth prepass %s",
+			invocations, pixels > 0.0 ? invocations / pixels : 0.0, GraphicsPipeline::depth_prepass_enabled() ? "on" : "off");
+	}
+
+	// The GPU-driven counts lag by the frames in flight, they are averaged over the frames read back so far
+	const GpuDrivenRenderer::Statistics& gpu_statistics = GpuDrivenRenderer::get_statistics();
+	if (GpuDrivenRenderer::is_enabled() && gpu_statistics.frame_count > 0) {
+		CORE_INFO("BasicRenderer: cluster culling rejected %.1f frustum + %.1f backface of %.1f meshlets per frame",
+			static_cast<f64>(gpu_statistics.clusters_frustum_culled) / gpu_statistics.frame_count,
+			static_cast<f64>(gpu_statistics.clusters_backface_culled) / gpu_statistics.frame_count,
+			static_cast<f64>(gpu_statistics.clusters_tested) / gpu_statistics.frame_count);
+		CORE_INFO("BasicRenderer: cluster culling rejected %.1f frustum + %.1f backface of %.1f triangles per frame (%.1f%%)",
+			static_cast<f64>(gpu_statistics.triangles_frustum_culled) / gpu_statistics.frame_count,
+			static_cast<f64>(gpu_statistics.triangles_backface_culled) / gpu_statistics.frame_count,
+			static_cast<f64>(gpu_statistics.triangles_tested) / gpu_statistics.frame_count,
+			gpu_statistics.triangles_tested > 0 ? static_cast<f64>(gpu_statistics.triangles_frustum_culled
+				+ gpu_statistics.triangles_backface_culled) / gpu_statistics.triangles_tested * 100.0 : 0.0);
+		// The time spent building the pyramid is GpuProfiler's "Depth pyramid" pass
+		if (gpu_statistics.objects_occlusion_tested > 0) {
+			CORE_INFO("BasicRenderer: occlusion culling hid %.1f of %.1f objects per frame, %.1f came into view",
+				static_cast<f64>(gpu_statistics.objects_occluded) / gpu_statistics.frame_count,
+				static_cast<f64>(gpu_statistics.objects_occlusion_tested) / gpu_statistics.frame_count,
+				static_cast<f64>(gpu_statistics.objects_disoccluded) / gpu_statistics.frame_count);
+		}
+	}
+	if (gpu_statistics.queue_frame_count > 0) {
+		CORE_INFO("BasicRenderer: occlusion culling hid %.1f of %.1f render queue instances per frame, %.1f came into view",
+			static_cast<f64>(gpu_statistics.queue_instances_occluded) / gpu_statistics.queue_frame_count,
+			static_cast<f64>(gpu_statistics.queue_instances_tested) / gpu_statistics.queue_frame_count,
+			static_cast<f64>(gpu_statistics.queue_instances_disoccluded) / gpu_statistics.queue_frame_count);
+	}
+	GpuDrivenRenderer::reset_statistics();
+	GpuProfiler::log_statistics();
+
+	statistics.frame_count = 0;
+	statistics.frame_time = 0.0;
+	statistics.fence_wait_time = 0.0;
+	statistics.draws_eliminated = 0;
+	statistics.binds_eliminated = 0;
+	statistics.instances_tested = 0;
+	statistics.instances_culled = 0;
+	statistics.cull_time = 0.0;
+	statistics.triangles_drawn = 0;
+	statistics.triangles_saved_by_lod = 0;
+	statistics.fragment_invocations = 0;
+	statistics.fragment_query_count = 0;
+	statistics.last_report = frame_start;
+}
+
+bool BasicRenderer::create_query_pools()
+{
+	if (!VulkanInstance::device_features().pipeline_statistics_query) {
+		CORE_DEBUG("BasicRenderer: the device lacks pipeline statistics queries, fragment invocations won't be counted");
+		return true;
+	}
+
+	VkQueryPoolCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	create_infos.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	create_infos.queryCount = 1;
+	create_infos.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+	for (auto& frame : frames) {
+		VkResult result = vkCreateQueryPool(VulkanInstance::logical_device(), &create_infos, nullptr, &frame.statistics_query_pool);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create BasicRenderer's query pool: %s", vulkan_error_to_string(result));
+			return false;
+		}
+	}
+	return true;
+}
+
+void BasicRenderer::destroy_query_pools()
+{
+	for (auto& frame : frames) {
+		if (frame.statistics_query_pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(VulkanInstance::logical_device(), frame.statistics_query_pool, nullptr);
+		frame.statistics_query_pool = VK_NULL_HANDLE;
+		frame.statistics_query_pending = false;
+	}
+}
+
+void BasicRenderer::begin_statistics_query()
+{
+	// Secondary command buffers can only run inside an active query with inherited queries
+	FrameData& frame = current_frame();
+	if (frame.statistics_query_pool == VK_NULL_HANDLE
+		|| (recorder.worker_count() > 0 && !VulkanInstance::device_features().inherited_queries))
+		return ;
+
+	// Outside of the render pass, the query then spans all of it
+	vkCmdResetQueryPool(frame.command_buffer, frame.statistics_query_pool, 0, 1);
+	vkCmdBeginQuery(frame.command_buffer, frame.statistics_query_pool, 0, 0);
+	frame.statistics_query_pending = true;
+}
+
+void BasicRenderer::end_statistics_query()
+{
+	if (current_frame().statistics_query_pending)
+		vkCmdEndQuery(current_frame().command_buffer, current_frame().statistics_query_pool, 0);
+}
+
+void BasicRenderer::read_statistics_query()
+{
+	FrameData& frame = current_frame();
+	if (!frame.statistics_query_pending)
+		return ;
+	frame.statistics_query_pending = false;
+
+	// The fence was waited on, a frame that never got submitted is simply not ready
+	u64 invocations = 0;
+	VkResult result = vkGetQueryPoolResults(VulkanInstance::logical_device(), frame.statistics_query_pool, 0, 1, sizeof(u64),
+		&invocations, sizeof(u64), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+		return ;
+	statistics.fragment_invocations += invocations;
+	statistics.fragment_query_count++;
 }
 
 void BasicRenderer::destroy_command_pool()
 {
+	// Command buffers are implicitly freed with their pool
 	if (command_pool != VK_NULL_HANDLE)
 		vkDestroyCommandPool(VulkanInstance::logical_device(), command_pool, nullptr);
+	command_pool = VK_NULL_HANDLE;
 }
 }
@@ -6,9 +6,16 @@
 #define BASICRENDERER_H
 
 #include <vector>
+#include <atomic>
 #include "Vertex.h"
 #include "defines.h"
 #include "vulkan/Buffer.h"
+#include "vulkan/TransferContext.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+#include "Meshlet.h"
+#include "ParallelRecorder.h"
+#include "Renderer.h"
 
 namespace Vulkan
 {
@@ -19,11 +26,40 @@ public:	// Types
 
 	class Mesh
 	{
+	public:		// Types
+		// Buffers of every mesh created so far, compared to storing all the indices as u32 and all the vertices as Vertex
+		struct GeometryStatistics
+		{
+			u32	uint8_mesh_count		= 0;
+			u32	uint16_mesh_count		= 0;
+			u32	uint32_mesh_count		= 0;
+			u64	index_bytes				= 0;
+			u64	index_bytes_saved		= 0;
+
+			u32	quantized_mesh_count	= 0;
+			u64	vertex_bytes			= 0;
+			u64	vertex_bytes_saved		= 0;
+		};
+
+		// A level of detail, a range of the index buffer shared by every level
+		struct Lod
+		{
+			u32	first_index	= 0;
+			u32	index_count	= 0;
+			// Distance to the full mesh in model space, see MeshSimplifier
+			f32	error		= 0.0f;
+		};
+
+		static constexpr u32	MAX_LODS = 8;
+
 	public:		// Methods
 		Mesh();
 		~Mesh() = default;
-		Mesh(const std::vector<Vertex>& verticies, const std::vector<u32>& indicies);
-		Mesh(const Mesh& other) = default;
+		// Quantized meshes store their positions relative to their bounding box, at half the size.
+		// With lod_count > 1, simplified levels each with about half the triangles of the previous one are built too
+		Mesh(const std::vector<Vertex>& verticies, const std::vector<u32>& indicies, VertexFormat format = VertexFormat::Float,
+			u32 lod_count = 1);
+		Mesh(const Mesh& other);
 		Mesh(Mesh&& other) noexcept;
 
 		Mesh& operator=(const Mesh& other);
@@ -35,9 +71,36 @@ public:	// Types
 		const Buffer&			get_index_buffer()		const	{ return index_buffer; }
 
 		u64						get_vertex_count()		const	{ return vertex_count; }
+		// Of the full detail level
 		u64						get_index_count()		const	{ return index_count; }
+		// From the most detailed to the least, empty for a default constructed mesh
+		const std::vector<Lod>&	get_lods()				const	{ return lods; }
+		// Clusters of the full detail level, culled one by one by GpuDrivenRenderer
+		const std::vector<Meshlet>&	get_meshlets()		const	{ return meshlets; }
+		// The smallest type able to address every vertex, picked when the mesh is created
+		VkIndexType				get_index_type()		const	{ return index_type; }
+		VertexFormat			get_vertex_format()		const	{ return vertex_format; }
+		// Identity for Float meshes
+		const VertexDequantization&	get_dequantization()	const	{ return dequantization; }
+
+		// The buffers are uploaded asynchronously, the mesh can only be drawn once they landed
+		bool					is_ready()				const	{ return TransferContext::is_complete(upload_token); }
+		UploadToken				get_upload_token()		const	{ return upload_token; }
+
+		// Identifies the buffers of the mesh for draw sorting, a copy gets its own id
+		u32						get_id()				const	{ return id; }
+
+		// Center in model space in xyz, radius in w
+		const glm::vec4&		get_bounding_sphere()	const	{ return bounding_sphere; }
+		const BoundingBox&		get_bounding_box()		const	{ return bounding_box; }
+
+		static GeometryStatistics	get_geometry_statistics();
+		static void					log_geometry_statistics();
 
 	private:	// Methods
+		static VkIndexType		pick_index_type(u64 vertex_count);
+		UploadToken				upload_vertices(const std::vector<Vertex>& verticies);
+		UploadToken				upload_indices(const std::vector<u32>& indicies);
 
 	private:	// Members
 		Buffer	vertex_buffer;
@@ -45,10 +108,81 @@ public:	// Types
 
 		u64		vertex_count;
 		u64		index_count;
+		VkIndexType	index_type;
+		std::vector<Lod>	lods;
+		std::vector<Meshlet>	meshlets;
+
+		VertexFormat			vertex_format;
+		VertexDequantization	dequantization;
+
+		UploadToken	upload_token;
+		u32			id;
+
+		glm::vec4	bounding_sphere;
+		BoundingBox	bounding_box;
+
+		static std::atomic<u32>	next_id;
+
+		static std::atomic<u32>	index_type_counts[3];
+		static std::atomic<u64>	total_index_bytes;
+		static std::atomic<u64>	total_index_bytes_saved;
+		static std::atomic<u32>	quantized_mesh_count;
+		static std::atomic<u64>	total_vertex_bytes;
+		static std::atomic<u64>	total_vertex_bytes_saved;
 	}; // Mesh
 
+private:	// Types
+	// Everything a frame needs while it is being recorded and executed, one per frame in flight
+	struct FrameData
+	{
+		VkCommandBuffer	command_buffer				= VK_NULL_HANDLE;
+		VkSemaphore		image_available_semaphore	= VK_NULL_HANDLE;
+		VkFence			in_flight_fence				= VK_NULL_HANDLE;
+		// DeletionQueue's frame count when this frame was last submitted, flushed up to once the fence is waited on
+		u64				submitted_frame				= 0;
+
+		Buffer			camera_uniform_buffer;
+		VkDescriptorSet	camera_descriptor_set		= VK_NULL_HANDLE;
+
+		// Instances written this frame, bound at vertex binding 1 unless GpuDrivenRenderer culls them, which reads them as storage
+		Buffer				instance_buffer;
+		u32					instance_capacity	= 0;
+		u32					instance_count		= 0;
+
+		// Instance buffers outgrown during the frame, kept alive until the GPU is done with it
+		std::vector<Buffer>	retired_instance_buffers;
+
+		// Fragment shader invocations of the render pass, read back once the fence is waited on
+		VkQueryPool		statistics_query_pool		= VK_NULL_HANDLE;
+		bool			statistics_query_pending	= false;
+	};
+
+	// Accumulated between two reports, all times in seconds
+	struct FrameStatistics
+	{
+		u32	frame_count			= 0;
+		f64	frame_time			= 0.0;
+		f64	fence_wait_time		= 0.0;
+		f64	last_frame_start	= 0.0;
+		f64	last_report			= 0.0;
+
+		// Summed over the frames since the last report
+		u64	draws_eliminated	= 0;
+		u64	binds_eliminated	= 0;
+		u64	instances_tested	= 0;
+		u64	instances_culled	= 0;
+		f64	cull_time			= 0.0;
+		u64	triangles_drawn			= 0;
+		u64	triangles_saved_by_lod	= 0;
+		// Only over the frames whose query could be read
+		u64	fragment_invocations	= 0;
+		u32	fragment_query_count	= 0;
+	};
+
 public:		// Methods
-	static bool	initialize();
+	// With recording_threads > 0, the draws are recorded into secondary command buffers by that many worker threads.
+	// With depth_prepass, every frame is drawn twice: depth only, then color for the visible surfaces only
+	static bool	initialize(u32 frames_in_flight = 2, u32 recording_threads = 0, bool depth_prepass = false);
 	static void	shutdown();
 
 	//----
@@ -58,68 +192,125 @@ public:		// Methods
 	static void	draw(const Mesh& mesh, const glm::vec3& pos);
 	static void	draw(const Mesh& mesh, const glm::vec3& pos, const glm::vec3& rotation);
 	static void	draw(const Mesh& mesh, const glm::vec3& pos, const glm::vec3& rotation, const glm::vec3& scale);
+	// For transforms computed ahead, by a TransformStore for instance
+	static void	draw(const Mesh& mesh, const glm::mat4& transform);
+	static void	draw_instanced(const Mesh& mesh, const std::vector<glm::mat4>& transforms);
+	static void	draw_instanced(const Mesh& mesh, const glm::mat4 *transforms, u32 count);
 	static void	end_frame();
 
+	//----
+	// Getters
+	//----
+	static u32	get_frames_in_flight_count()	{ return frames_in_flight_count; }
+	static u32	get_recording_thread_count()	{ return recorder.worker_count(); }
+
 private:	// Methods
 
 	//----
 	// Initialization
 	//----
 	static bool	create_sync_objects();
+	static bool	create_present_semaphores();
 	static bool	create_descriptor_pool();
-	static bool	create_camera_descriptor_set();
-	static void create_uniform_buffer();
+	static bool	create_camera_descriptor_sets();
+	static void create_uniform_buffers();
+	static void	create_instance_buffers();
 	static bool	create_command_pool();
-	static bool	create_command_buffer();
+	static bool	create_command_buffers();
+	static bool	create_query_pools();
 
 	//----
 	// Shutdown
 	//----
 	static void	destroy_sync_objects();
+	// Deferred, a present of the old swapchain may still wait on them
+	static void	destroy_present_semaphores(bool deferred = false);
 	static void	destroy_descriptor_pool();
 	static void	destroy_command_pool();
+	static void	destroy_query_pools();
 
 	//----
 	// Drawing
 	//----
-	static void					wait_for_last_frame_finished();
+	static void					wait_for_frame_finished();
 	static std::optional<u32>	get_swapchain_image();
+	static void					recreate_swapchain();
 	static bool					begin_command_buffer();
-	static void					begin_renderpass();
-	static void					setup_viewport();
+	static void					begin_renderpass(VkSubpassContents contents, VkRenderPass render_pass);
+	static void					setup_viewport(VkCommandBuffer command_buffer);
+	static CameraUBO			build_camera_ubo();
 	static void					setup_camera_ubo();
+	static u32					select_lod(const Mesh& mesh, const glm::mat4& transform);
+	static std::optional<u32>	prepare_render_queue();
+	static void					bind_frame_state(VkCommandBuffer command_buffer);
+	// Once GpuDrivenRenderer culled the queue, the batches are drawn from its commands of the early or the late pass
+	static void					record_batches(VkCommandBuffer command_buffer, u32 base_instance, u32 first, u32 count, bool depth_prepass,
+									bool late_pass);
+	static void					record_slice(VkCommandBuffer command_buffer, u32 base_instance, u32 first, u32 count, bool last_slice,
+									bool depth_prepass, bool late_pass = false);
+	static void					record_inline(VkRenderPass render_pass, std::optional<u32> base_instance);
+	static void					record_parallel(VkRenderPass render_pass, std::optional<u32> base_instance);
+	static void					record_late_pass();
+	static std::optional<u32>	write_instances(const glm::mat4 *transforms, u32 count);
+	static bool					grow_instance_buffer(u32 required_capacity);
 
 	static void					end_renderpass();
 	static bool					end_command_buffer();
 	static bool					submit_command_buffer();
 	static bool					present_frame();
 
+	//----
+	// Statistics
+	//----
+	static void					update_frame_statistics(f64 frame_start, f64 fence_wait);
+	static void					begin_statistics_query();
+	static void					end_statistics_query();
+	static void					read_statistics_query();
+
+	//----
+	// Getters
+	//----
+	static FrameData&			current_frame()	{ return frames[current_frame_index]; }
+
 private:	// Members
 	//----
-	// Synchronization
+	// Frames in flight
 	//----
-	static VkSemaphore	image_available_semaphore;
-	static VkSemaphore	render_finished_semaphore;
-	static VkFence		last_frame_presented_fence;
+	static std::vector<FrameData>	frames;
+	static u32						frames_in_flight_count;
+	static u32						current_frame_index;
+	// One per swapchain image rather than per frame: a semaphore can only be signaled again once the present waiting on
+	// it is done, and that's only known when its image is acquired again. Empty headless
+	static std::vector<VkSemaphore>	render_finished_semaphores;
 
 	//----
 	// State
 	//----
-	static bool			frame_started;
-	static u32			current_image_index;
+	static bool				frame_started;
+	static u32				current_image_index;
+	// Set by resizes and out of date or suboptimal results, the swapchain is recreated at the start of the next frame
+	static bool				swapchain_dirty;
+	static FrameStatistics	statistics;
+
+	// Draws of the current frame, recorded in end_frame()
+	static RenderQueue		render_queue;
+	static CameraUBO		camera;
+
+	// Only started with recording threads, otherwise everything is recorded inline in the primary command buffer
+	static ParallelRecorder	recorder;
+
+	// Transforms of a draw_instanced() call split by level of detail, kept to reuse their memory
+	static std::vector<glm::mat4>	lod_transforms[Mesh::MAX_LODS];
 
 	//----
 	// Uniform variables
 	//----
-	static Buffer			camera_uniform_buffer;
 	static VkDescriptorPool	descriptor_pool;
-	static VkDescriptorSet	camera_descriptor_set;
 
 	//----
 	// Command buffers
 	//----
 	static VkCommandPool	command_pool;
-	static VkCommandBuffer	command_buffer;
 };
 
 }
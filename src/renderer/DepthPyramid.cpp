@@ -0,0 +1,358 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include "DepthPyramid.h"
+#include "vulkan/VulkanInstance.h"
+#include "vulkan/SwapchainManager.h"
+#include "vulkan/DeletionQueue.h"
+#include "vulkan/vulkan_errors.h"
+#include "log.h"
+
+namespace Vulkan {
+
+// Must match local_size_x in depth_reduce.comp.glsl
+static constexpr u32	REDUCE_GROUP_SIZE = 64;
+
+// Mirrors ReduceData in depth_reduce.comp.glsl
+struct ReduceConstants
+{
+	u32	source_size[2];
+	u32	destination_size[2];
+};
+
+static u32 previous_power_of_two(u32 value)
+{
+	u32 result = 1;
+	while (result <= value / 2)
+		result *= 2;
+	return result;
+}
+
+DepthPyramid::~DepthPyramid()
+{
+	shutdown();
+}
+
+bool DepthPyramid::initialize()
+{
+	if (!SwapchainManager::depth_sampleable()) {
+		CORE_WARN("DepthPyramid: the depth format can't be sampled, there is nothing to build the pyramid from");
+		return false;
+	}
+
+	// The level above, sampled, and the level written
+	std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[0].pImmutableSamplers = nullptr;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].pImmutableSamplers = nullptr;
+	if (!_reduce_pipeline.initialize("depth_reduce.comp", bindings, sizeof(ReduceConstants)))
+		return false;
+
+	if (!create_sampler())
+		return false;
+	return recreate();
+}
+
+bool DepthPyramid::initialize_placeholder()
+{
+	// Neither the reduction nor the depth buffer are needed, only something to bind
+	_placeholder = true;
+	if (!create_sampler() || !create_image()) {
+		shutdown();
+		return false;
+	}
+	CORE_TRACE("DepthPyramid placeholder created");
+	return true;
+}
+
+void DepthPyramid::shutdown()
+{
+	destroy_resources();
+	_placeholder = false;
+	if (_sampler != VK_NULL_HANDLE)
+		vkDestroySampler(VulkanInstance::logical_device(), _sampler, nullptr);
+	_sampler = VK_NULL_HANDLE;
+	_reduce_pipeline.shutdown();
+}
+
+bool DepthPyramid::recreate()
+{
+	if (_placeholder)
+		return true;
+
+	// The frames in flight may still build or test against the old pyramid
+	destroy_resources(true);
+	if (!create_image() || !create_descriptor_sets()) {
+		destroy_resources();
+		return false;
+	}
+	CORE_TRACE("DepthPyramid created: %ux%u, %u levels", _width, _height, level_count());
+	return true;
+}
+
+void DepthPyramid::record_build(VkCommandBuffer command_buffer)
+{
+	if (!is_valid() || _placeholder)
+		return ;
+
+	// Shared by the frames in flight, the previous frame's tests against the pyramid have to be done before it is overwritten
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.oldLayout = _layout_initialized ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _image;
+	barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count(), 0, 1};
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+	_layout_initialized = true;
+	_built = true;
+
+	ReduceConstants constants{};
+	constants.source_size[0] = SwapchainManager::swapchain_extent().width;
+	constants.source_size[1] = SwapchainManager::swapchain_extent().height;
+	for (u32 level = 0; level < level_count(); level++) {
+		constants.destination_size[0] = std::max(_width >> level, 1u);
+		constants.destination_size[1] = std::max(_height >> level, 1u);
+
+		// A row of workgroups per row of texels
+		_reduce_pipeline.bind(command_buffer, _descriptor_sets[level]);
+		_reduce_pipeline.push_constants(command_buffer, &constants, sizeof(ReduceConstants));
+		_reduce_pipeline.dispatch(command_buffer, constants.destination_size[0], REDUCE_GROUP_SIZE, constants.destination_size[1]);
+
+		// The next level reads this one, and the culling shader all of them
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		constants.source_size[0] = constants.destination_size[0];
+		constants.source_size[1] = constants.destination_size[1];
+	}
+}
+
+void DepthPyramid::record_initial_layout(VkCommandBuffer command_buffer)
+{
+	if (!is_valid() || _layout_initialized)
+		return ;
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _image;
+	barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count(), 0, 1};
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+	_layout_initialized = true;
+}
+
+//----
+// Resources
+//----
+
+bool DepthPyramid::create_sampler()
+{
+	// The shaders only use texelFetch, the sampler is just required by the descriptor type
+	VkSamplerCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	create_infos.magFilter = VK_FILTER_NEAREST;
+	create_infos.minFilter = VK_FILTER_NEAREST;
+	create_infos.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	create_infos.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	create_infos.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	create_infos.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	create_infos.minLod = 0.0f;
+	create_infos.maxLod = VK_LOD_CLAMP_NONE;
+
+	VkResult result = vkCreateSampler(VulkanInstance::logical_device(), &create_infos, nullptr, &_sampler);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create DepthPyramid's sampler: %s", vulkan_error_to_string(result));
+		return false;
+	}
+	return true;
+}
+
+bool DepthPyramid::create_image()
+{
+	// Rounded down, each texel of level 0 then covers less than 2x2 pixels and the levels halve exactly
+	_width = _placeholder ? 1 : previous_power_of_two(SwapchainManager::swapchain_extent().width);
+	_height = _placeholder ? 1 : previous_power_of_two(SwapchainManager::swapchain_extent().height);
+	u32 level_count = 1;
+	while ((std::max(_width, _height) >> level_count) > 0)
+		level_count++;
+
+	VkImageCreateInfo image_infos{};
+	image_infos.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_infos.imageType = VK_IMAGE_TYPE_2D;
+	image_infos.format = VK_FORMAT_R32_SFLOAT;
+	image_infos.extent = {_width, _height, 1};
+	image_infos.mipLevels = level_count;
+	image_infos.arrayLayers = 1;
+	image_infos.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_infos.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_infos.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_infos.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_infos.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkResult result = vkCreateImage(VulkanInstance::logical_device(), &image_infos, nullptr, &_image);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create DepthPyramid's image: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(VulkanInstance::logical_device(), _image, &requirements);
+	auto allocation = MemoryAllocator::allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryAllocator::ResourceKind::Optimal);
+	if (!allocation.has_value()) {
+		CORE_ERROR("Couldn't allocate DepthPyramid's memory!");
+		return false;
+	}
+	_allocation = allocation.value();
+	result = vkBindImageMemory(VulkanInstance::logical_device(), _image, _allocation.memory, _allocation.offset);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't bind DepthPyramid's memory: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	// A view of the whole pyramid for the tests, and one per level for the reduction
+	VkImageViewCreateInfo view_infos{};
+	view_infos.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_infos.image = _image;
+	view_infos.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_infos.format = VK_FORMAT_R32_SFLOAT;
+	view_infos.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, level_count, 0, 1};
+	result = vkCreateImageView(VulkanInstance::logical_device(), &view_infos, nullptr, &_image_view);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create DepthPyramid's image view: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	_level_views.resize(level_count, VK_NULL_HANDLE);
+	for (u32 level = 0; level < level_count; level++) {
+		view_infos.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+		result = vkCreateImageView(VulkanInstance::logical_device(), &view_infos, nullptr, &_level_views[level]);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create the view of DepthPyramid's level %u: %s", level, vulkan_error_to_string(result));
+			return false;
+		}
+	}
+	_layout_initialized = false;
+	_built = false;
+	return true;
+}
+
+bool DepthPyramid::create_descriptor_sets()
+{
+	VkDescriptorPoolSize pool_sizes[2]{};
+	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pool_sizes[0].descriptorCount = level_count();
+	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	pool_sizes[1].descriptorCount = level_count();
+
+	VkDescriptorPoolCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	create_infos.poolSizeCount = 2;
+	create_infos.pPoolSizes = pool_sizes;
+	create_infos.maxSets = level_count();
+
+	VkResult result = vkCreateDescriptorPool(VulkanInstance::logical_device(), &create_infos, nullptr, &_descriptor_pool);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create DepthPyramid's descriptor pool: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(level_count(), _reduce_pipeline.descriptor_set_layout());
+	_descriptor_sets.resize(level_count());
+
+	VkDescriptorSetAllocateInfo alloc_infos{};
+	alloc_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_infos.descriptorPool = _descriptor_pool;
+	alloc_infos.descriptorSetCount = level_count();
+	alloc_infos.pSetLayouts = layouts.data();
+
+	result = vkAllocateDescriptorSets(VulkanInstance::logical_device(), &alloc_infos, _descriptor_sets.data());
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't allocate DepthPyramid's descriptor sets: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	for (u32 level = 0; level < level_count(); level++) {
+		VkDescriptorImageInfo image_infos[2]{};
+		image_infos[0].sampler = _sampler;
+		image_infos[0].imageView = level == 0 ? SwapchainManager::depth_image_view() : _level_views[level - 1];
+		image_infos[0].imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		image_infos[1].imageView = _level_views[level];
+		image_infos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		VkWriteDescriptorSet desc_writes[2]{};
+		for (u32 i = 0; i < 2; i++) {
+			desc_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			desc_writes[i].dstSet = _descriptor_sets[level];
+			desc_writes[i].dstBinding = i;
+			desc_writes[i].dstArrayElement = 0;
+			desc_writes[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			desc_writes[i].descriptorCount = 1;
+			desc_writes[i].pImageInfo = &image_infos[i];
+		}
+		vkUpdateDescriptorSets(VulkanInstance::logical_device(), 2, desc_writes, 0, nullptr);
+	}
+	return true;
+}
+
+void DepthPyramid::destroy_resources(bool deferred)
+{
+	VkDescriptorPool descriptor_pool = _descriptor_pool;
+	std::vector<VkImageView> level_views = std::move(_level_views);
+	VkImageView image_view = _image_view;
+	VkImage image = _image;
+	MemoryAllocator::Allocation allocation = _allocation;
+	auto destroy = [=]() mutable {
+		// Descriptor sets are implicitly destroyed when the pool is destroyed
+		if (descriptor_pool != VK_NULL_HANDLE)
+			vkDestroyDescriptorPool(VulkanInstance::logical_device(), descriptor_pool, nullptr);
+		for (VkImageView view : level_views) {
+			if (view != VK_NULL_HANDLE)
+				vkDestroyImageView(VulkanInstance::logical_device(), view, nullptr);
+		}
+		if (image_view != VK_NULL_HANDLE)
+			vkDestroyImageView(VulkanInstance::logical_device(), image_view, nullptr);
+		if (image != VK_NULL_HANDLE)
+			vkDestroyImage(VulkanInstance::logical_device(), image, nullptr);
+		if (allocation.is_valid())
+			MemoryAllocator::free(allocation);
+	};
+	if (deferred)
+		DeletionQueue::push(std::move(destroy));
+	else
+		destroy();
+
+	_descriptor_pool = VK_NULL_HANDLE;
+	_descriptor_sets.clear();
+	_level_views.clear();
+	_image_view = VK_NULL_HANDLE;
+	_image = VK_NULL_HANDLE;
+	_allocation = MemoryAllocator::Allocation{};
+	_width = 0;
+	_height = 0;
+}
+
+} // Vulkan
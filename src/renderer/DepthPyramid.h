@@ -0,0 +1,92 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef DEPTHPYRAMID_H
+#define DEPTHPYRAMID_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "defines.h"
+#include "vulkan/ComputePipeline.h"
+#include "vulkan/MemoryAllocator.h"
+
+namespace Vulkan {
+
+// Hierarchical-Z of the swapchain's depth buffer. Level 0 is the depth buffer reduced to the power of two below its size,
+// every next level keeps the farthest depth of 2x2 texels of the previous one: any rectangle of the screen is covered by
+// at most 2x2 texels of the level where its largest side fits in a texel.
+class DepthPyramid
+{
+public:
+	DepthPyramid() = default;
+	DepthPyramid(const DepthPyramid& other) = delete;
+	~DepthPyramid();
+
+	DepthPyramid& operator=(const DepthPyramid& other) = delete;
+
+	//----
+	// Initialization
+	//----
+	// Fails when the depth buffer can't be sampled, nothing can be built from it then
+	bool	initialize();
+	// A 1x1 pyramid that is never built, bound in place of a real one by the shaders that reference one without reading it
+	bool	initialize_placeholder();
+	void	shutdown();
+	// The depth buffer is recreated along with the swapchain. The old pyramid goes to the DeletionQueue, descriptor sets
+	// referencing it elsewhere have to be rewritten before they are used again. A placeholder is kept as it is
+	bool	recreate();
+
+	//----
+	// Recording
+	//----
+	// Outside of any render pass, after one that left the depth buffer in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+	// The pyramid stays in the GENERAL layout, its levels are readable by compute shaders once this returns
+	void	record_build(VkCommandBuffer command_buffer);
+	// Moves the image to GENERAL if no build did yet, before anything binds it. Does nothing afterwards
+	void	record_initial_layout(VkCommandBuffer command_buffer);
+
+	//----
+	// Getters
+	//----
+	// Every level, for the shaders testing bounds against it
+	VkImageView	image_view()	const	{ return _image_view; }
+	VkSampler	sampler()		const	{ return _sampler; }
+	u32			width()			const	{ return _width; }
+	u32			height()		const	{ return _height; }
+	u32			level_count()	const	{ return static_cast<u32>(_level_views.size()); }
+	bool		is_valid()		const	{ return _image_view != VK_NULL_HANDLE; }
+	bool		is_placeholder()	const	{ return _placeholder; }
+	// A build was recorded since the image was created, before that its contents are undefined
+	bool		is_built()		const	{ return _built; }
+
+private:	// Methods
+	bool	create_sampler();
+	bool	create_image();
+	bool	create_descriptor_sets();
+	// Deferred, the resources are only deleted once the frames submitted so far are done
+	void	destroy_resources(bool deferred = false);
+
+private:	// Members
+	ComputePipeline				_reduce_pipeline;
+	VkSampler					_sampler			= VK_NULL_HANDLE;
+
+	// Recreated with the swapchain
+	VkImage						_image				= VK_NULL_HANDLE;
+	MemoryAllocator::Allocation	_allocation;
+	VkImageView					_image_view			= VK_NULL_HANDLE;
+	std::vector<VkImageView>	_level_views;
+	VkDescriptorPool			_descriptor_pool	= VK_NULL_HANDLE;
+	// One per level, reading the level above it, or the depth buffer for level 0
+	std::vector<VkDescriptorSet>	_descriptor_sets;
+	u32							_width				= 0;
+	u32							_height				= 0;
+	// The image starts UNDEFINED, its first build moves it to GENERAL for good
+	bool						_layout_initialized	= false;
+	bool						_built				= false;
+	bool						_placeholder		= false;
+};
+
+} // Vulkan
+
+#endif //DEPTHPYRAMID_H
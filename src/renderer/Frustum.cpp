@@ -0,0 +1,38 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "Frustum.h"
+
+namespace Vulkan {
+
+Frustum Frustum::from_view_projection(const glm::mat4 &view_projection)
+{
+	// glm matrices are column major, row i is made of the i-th component of each column
+	auto row = [&view_projection](u32 i) {
+		return glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+	};
+
+	Frustum frustum{};
+	frustum.planes[Left] = row(3) + row(0);
+	frustum.planes[Right] = row(3) - row(0);
+	frustum.planes[Bottom] = row(3) + row(1);
+	frustum.planes[Top] = row(3) - row(1);
+	frustum.planes[Near] = row(2);
+	frustum.planes[Far] = row(3) - row(2);
+
+	for (auto& plane : frustum.planes)
+		plane /= glm::length(glm::vec3(plane));
+	return frustum;
+}
+
+bool Frustum::intersects_sphere(const glm::vec3 &center, f32 radius) const
+{
+	for (const auto& plane : planes) {
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+} // Vulkan
@@ -0,0 +1,39 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <array>
+#include "defines.h"
+#include "glm/glm.hpp"
+
+namespace Vulkan {
+
+// Axis aligned, in the space of whatever it bounds
+struct BoundingBox
+{
+	glm::vec3	min = glm::vec3(0.0f);
+	glm::vec3	max = glm::vec3(0.0f);
+
+	glm::vec3	center()	const	{ return (min + max) * 0.5f; }
+	glm::vec3	extents()	const	{ return (max - min) * 0.5f; }
+};
+
+struct Frustum
+{
+	enum Plane { Left, Right, Bottom, Top, Near, Far, Count };
+
+	// (normal, distance) with normals pointing inside, normalized so that dot(plane.xyz, p) + plane.w is a distance
+	std::array<glm::vec4, Plane::Count>	planes;
+
+	// Expects a Vulkan projection, with depth going from 0 to 1
+	static Frustum	from_view_projection(const glm::mat4& view_projection);
+
+	bool	intersects_sphere(const glm::vec3& center, f32 radius) const;
+};
+
+} // Vulkan
+
+#endif //FRUSTUM_H
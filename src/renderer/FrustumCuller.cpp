@@ -0,0 +1,173 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include "FrustumCuller.h"
+#include "core/JobSystem.h"
+
+// The binary targets plain x86-64, AVX is only compiled into cull_avx() and chosen at run time on the CPUs that have it
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+# define FRUSTUM_CULLER_AVX
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace Vulkan {
+
+// Spheres per job when culling on several threads
+static constexpr u32	CULL_GRAIN_SIZE = 16384;
+
+// Also checks that the OS saves the AVX registers. Initialized on first use, other constructors may run before libgcc's
+static bool has_avx()
+{
+#if defined(FRUSTUM_CULLER_AVX)
+	static const bool has = (__builtin_cpu_init(), __builtin_cpu_supports("avx"));
+	return has;
+#else
+	return false;
+#endif
+}
+
+void FrustumCuller::clear()
+{
+	_center_x.clear();
+	_center_y.clear();
+	_center_z.clear();
+	_radius.clear();
+	_visibility.clear();
+}
+
+void FrustumCuller::reserve(u32 count)
+{
+	_center_x.reserve(count);
+	_center_y.reserve(count);
+	_center_z.reserve(count);
+	_radius.reserve(count);
+}
+
+void FrustumCuller::add(const glm::vec3 &center, f32 radius)
+{
+	_center_x.push_back(center.x);
+	_center_y.push_back(center.y);
+	_center_z.push_back(center.z);
+	_radius.push_back(radius);
+}
+
+void FrustumCuller::add(const glm::vec4 &bounding_sphere, const glm::mat4 &transform)
+{
+	glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(bounding_sphere), 1.0f));
+	f32 scale_squared = std::max({glm::dot(transform[0], transform[0]), glm::dot(transform[1], transform[1]),
+		glm::dot(transform[2], transform[2])});
+	add(center, bounding_sphere.w * std::sqrt(scale_squared));
+}
+
+u32 FrustumCuller::cull(const Frustum &frustum)
+{
+	const u32 count = size();
+	_visibility.resize(count);
+
+	// Chunks are independent, and large enough that each one keeps the SIMD loops busy
+	std::atomic<u32> visible_count(0);
+	JobSystem::parallel_for(count, CULL_GRAIN_SIZE, [this, &frustum, &visible_count](u32 first, u32 last) {
+		// The widest path available handles the bulk, the scalar one the few spheres left
+		u32 sse_first = has_avx() ? cull_avx(frustum, first, last) : first;
+		u32 scalar_first = cull_sse(frustum, sse_first, last);
+		cull_scalar(frustum, scalar_first, last);
+
+		u32 chunk_visible = 0;
+		for (u32 i = first; i < last; i++)
+			chunk_visible += _visibility[i];
+		visible_count.fetch_add(chunk_visible, std::memory_order_relaxed);
+	});
+	return visible_count.load();
+}
+
+#if defined(FRUSTUM_CULLER_AVX)
+__attribute__((target("avx")))
+u32 FrustumCuller::cull_avx(const Frustum &frustum, u32 first, u32 last)
+{
+	__m256 plane_x[Frustum::Count], plane_y[Frustum::Count], plane_z[Frustum::Count], plane_w[Frustum::Count];
+	for (u32 p = 0; p < Frustum::Count; p++) {
+		plane_x[p] = _mm256_set1_ps(frustum.planes[p].x);
+		plane_y[p] = _mm256_set1_ps(frustum.planes[p].y);
+		plane_z[p] = _mm256_set1_ps(frustum.planes[p].z);
+		plane_w[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+
+	u32 i = first;
+	for (; i + 8 <= last; i += 8) {
+		__m256 x = _mm256_loadu_ps(&_center_x[i]);
+		__m256 y = _mm256_loadu_ps(&_center_y[i]);
+		__m256 z = _mm256_loadu_ps(&_center_z[i]);
+		__m256 radius = _mm256_loadu_ps(&_radius[i]);
+
+		// Inside as long as the signed distance to every plane is at least -radius
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (u32 p = 0; p < Frustum::Count; p++) {
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[p], x), _mm256_mul_ps(plane_y[p], y)),
+				_mm256_add_ps(_mm256_mul_ps(plane_z[p], z), plane_w[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+
+		u32 mask = static_cast<u32>(_mm256_movemask_ps(inside));
+		for (u32 lane = 0; lane < 8; lane++)
+			_visibility[i + lane] = (mask >> lane) & 1;
+	}
+	return i;
+}
+#else
+u32 FrustumCuller::cull_avx(const Frustum &, u32 first, u32)
+{
+	return first;
+}
+#endif
+
+#if defined(__SSE2__)
+u32 FrustumCuller::cull_sse(const Frustum &frustum, u32 first, u32 last)
+{
+	__m128 plane_x[Frustum::Count], plane_y[Frustum::Count], plane_z[Frustum::Count], plane_w[Frustum::Count];
+	for (u32 p = 0; p < Frustum::Count; p++) {
+		plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+		plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+		plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+		plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	u32 i = first;
+	for (; i + 4 <= last; i += 4) {
+		__m128 x = _mm_loadu_ps(&_center_x[i]);
+		__m128 y = _mm_loadu_ps(&_center_y[i]);
+		__m128 z = _mm_loadu_ps(&_center_z[i]);
+		__m128 radius = _mm_loadu_ps(&_radius[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (u32 p = 0; p < Frustum::Count; p++) {
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)),
+				_mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		}
+
+		u32 mask = static_cast<u32>(_mm_movemask_ps(inside));
+		for (u32 lane = 0; lane < 4; lane++)
+			_visibility[i + lane] = (mask >> lane) & 1;
+	}
+	return i;
+}
+#else
+u32 FrustumCuller::cull_sse(const Frustum &, u32 first, u32)
+{
+	return first;
+}
+#endif
+
+void FrustumCuller::cull_scalar(const Frustum &frustum, u32 first, u32 last)
+{
+	for (u32 i = first; i < last; i++)
+		_visibility[i] = frustum.intersects_sphere(glm::vec3(_center_x[i], _center_y[i], _center_z[i]), _radius[i]) ? 1 : 0;
+}
+
+} // Vulkan
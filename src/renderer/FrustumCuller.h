@@ -0,0 +1,56 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef FRUSTUMCULLER_H
+#define FRUSTUMCULLER_H
+
+#include <vector>
+#include "defines.h"
+#include "glm/glm.hpp"
+#include "Frustum.h"
+
+namespace Vulkan {
+
+// Tests many world-space bounding spheres against a frustum at once.
+// The spheres are kept as separate arrays of x, y, z and radius so that 4 (SSE2) or 8 (AVX, when the CPU running it has it)
+// of them are tested per instruction.
+class FrustumCuller
+{
+public:
+	FrustumCuller() = default;
+
+	void	clear();
+	void	reserve(u32 count);
+	void	add(const glm::vec3& center, f32 radius);
+	// Transforms a model space sphere, the radius is scaled by the largest axis scale of the transform
+	void	add(const glm::vec4& bounding_sphere, const glm::mat4& transform);
+
+	// Fills visibility(), returns how many spheres intersect the frustum. Spread over the JobSystem when it is running.
+	u32		cull(const Frustum& frustum);
+
+	//----
+	// Getters
+	//----
+	u32						size()			const	{ return static_cast<u32>(_radius.size()); }
+	// 1 when the sphere at the same index intersects the frustum, 0 otherwise
+	const std::vector<u8>&	visibility()	const	{ return _visibility; }
+
+private:	// Methods
+	// Each tests [first, last) and returns the index of the first sphere it didn't test, left to the next narrower one
+	u32		cull_avx(const Frustum& frustum, u32 first, u32 last);
+	u32		cull_sse(const Frustum& frustum, u32 first, u32 last);
+	void	cull_scalar(const Frustum& frustum, u32 first, u32 last);
+
+private:	// Members
+	std::vector<f32>	_center_x;
+	std::vector<f32>	_center_y;
+	std::vector<f32>	_center_z;
+	std::vector<f32>	_radius;
+
+	std::vector<u8>		_visibility;
+};
+
+} // Vulkan
+
+#endif //FRUSTUMCULLER_H
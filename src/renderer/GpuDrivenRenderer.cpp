@@ -0,0 +1,844 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include <cstddef>
+#include "GpuDrivenRenderer.h"
+#include "Frustum.h"
+#include "vulkan/VulkanInstance.h"
+#include "vulkan/GraphicsPipeline.h"
+#include "vulkan/GpuProfiler.h"
+#include "vulkan/vulkan_errors.h"
+#include "log.h"
+
+namespace Vulkan {
+
+// Capacities of each frame's buffers before they have to grow
+static constexpr u32	INITIAL_OBJECT_CAPACITY = 1024;
+static constexpr u32	INITIAL_MESH_CAPACITY = 64;
+static constexpr u32	INITIAL_COMMAND_CAPACITY = 4096;
+static constexpr u32	INITIAL_MESHLET_CAPACITY = 1024;
+
+// Guaranteed minimum of maxComputeWorkGroupCount[1], more objects are culled over several dispatches
+static constexpr u32	MAX_DISPATCH_OBJECTS = 65535;
+
+// Must match local_size_x in cull.comp.glsl and queue_cull.comp.glsl
+static constexpr u32	CULL_GROUP_SIZE = 64;
+
+// Capacities of each frame's render queue buffers when the queue is first culled
+static constexpr u32	INITIAL_QUEUE_BATCH_CAPACITY = 256;
+static constexpr u32	INITIAL_QUEUE_INSTANCE_CAPACITY = 1024;
+
+// A thread per instance in a single row of workgroups, past that the queue is drawn without occlusion culling
+static constexpr u32	MAX_QUEUE_INSTANCES = 65535 * CULL_GROUP_SIZE;
+
+// Must match the phases in cull.comp.glsl, queue_cull.comp.glsl only has the last two
+static constexpr u32	PHASE_ALL = 0;
+static constexpr u32	PHASE_EARLY = 1;
+static constexpr u32	PHASE_LATE = 2;
+
+bool										GpuDrivenRenderer::enabled = false;
+ComputePipeline								GpuDrivenRenderer::cull_pipeline;
+ComputePipeline								GpuDrivenRenderer::queue_cull_pipeline;
+DepthPyramid								GpuDrivenRenderer::depth_pyramid;
+glm::mat4									GpuDrivenRenderer::pyramid_view_projection(1.0f);
+bool										GpuDrivenRenderer::occlusion_culling = true;
+VkDescriptorPool							GpuDrivenRenderer::descriptor_pool = VK_NULL_HANDLE;
+std::vector<GpuDrivenRenderer::FrameResources>	GpuDrivenRenderer::frames;
+
+std::vector<GpuDrivenRenderer::GpuObject>	GpuDrivenRenderer::objects;
+std::vector<GpuDrivenRenderer::MeshEntry>	GpuDrivenRenderer::meshes;
+std::vector<Meshlet>						GpuDrivenRenderer::meshlets;
+u32											GpuDrivenRenderer::command_count = 0;
+std::unordered_map<u32, u32>				GpuDrivenRenderer::mesh_indices;
+bool										GpuDrivenRenderer::command_offsets_dirty = false;
+GpuDrivenRenderer::Statistics				GpuDrivenRenderer::statistics;
+std::vector<GpuDrivenRenderer::GpuQueueBatch>	GpuDrivenRenderer::queue_batches;
+std::vector<u32>							GpuDrivenRenderer::queue_instance_batches;
+
+bool GpuDrivenRenderer::initialize(u32 frames_in_flight)
+{
+	static_assert(sizeof(GpuObject) == 96, "GpuObject must match ObjectData's std430 layout");
+	static_assert(sizeof(GpuMesh) == 32, "GpuMesh must match MeshData's std430 layout");
+	static_assert(sizeof(Meshlet) == 48, "Meshlet must match MeshletData's std430 layout");
+	static_assert(sizeof(CullConstants) <= 128, "CullConstants must fit in the guaranteed push constant range");
+	static_assert(sizeof(GpuStatistics) == 9 * sizeof(u32), "GpuStatistics must match the statistics in cull.comp.glsl");
+	static_assert(sizeof(GpuQueueBatch) == 64, "GpuQueueBatch must match BatchData's std430 layout");
+	static_assert(sizeof(QueueCullConstants) <= 128, "QueueCullConstants must fit in the guaranteed push constant range");
+	static_assert(sizeof(GpuQueueStatistics) == 3 * sizeof(u32), "GpuQueueStatistics must match the statistics in queue_cull.comp.glsl");
+
+	enabled = false;
+	if (!VulkanInstance::device_features().supports_gpu_driven_rendering()) {
+		CORE_WARN("GpuDrivenRenderer: the device lacks multi draw indirect or draw indirect count, GPU-driven rendering is disabled");
+		return true;
+	}
+
+	// The late phase can't run without a pyramid, and the culling set always references one. Without it, a placeholder is
+	// bound and everything is culled in a single phase, against the frustum and the normal cones only
+	if (!depth_pyramid.initialize()) {
+		depth_pyramid.shutdown();
+		if (!depth_pyramid.initialize_placeholder()) {
+			CORE_WARN("GpuDrivenRenderer: no depth pyramid, GPU-driven rendering is disabled");
+			return true;
+		}
+		CORE_WARN("GpuDrivenRenderer: no depth pyramid, occlusion culling is disabled");
+		occlusion_culling = false;
+	}
+
+	// Objects, meshes, commands, counts, meshlets, statistics, both visibility buffers, then the depth pyramid
+	std::vector<VkDescriptorSetLayoutBinding> bindings(9);
+	for (u32 i = 0; i < bindings.size(); i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = i < 8 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+	if (!cull_pipeline.initialize("cull.comp", bindings, sizeof(CullConstants)))
+		return false;
+	CORE_TRACE("GpuDrivenRenderer's culling pipeline created");
+
+	// Instances, batches, their batch indices, occlusion flags, culled instances, statistics, then the depth pyramid
+	bindings.resize(7);
+	for (u32 i = 0; i < bindings.size(); i++)
+		bindings[i].descriptorType = i < 6 ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	if (!queue_cull_pipeline.initialize("queue_cull.comp", bindings, sizeof(QueueCullConstants)))
+		return false;
+	CORE_TRACE("GpuDrivenRenderer's render queue culling pipeline created");
+
+	if (!create_descriptor_pool(frames_in_flight))
+		return false;
+
+	frames.resize(frames_in_flight);
+	if (!allocate_descriptor_sets())
+		return false;
+
+	for (auto& frame : frames) {
+		frame.statistics_buffer = Buffer(sizeof(GpuStatistics), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (frame.statistics_buffer.buffer() == VK_NULL_HANDLE) {
+			CORE_ERROR("Couldn't create GpuDrivenRenderer's statistics buffer");
+			return false;
+		}
+		if (!grow_object_buffers(frame, INITIAL_OBJECT_CAPACITY) || !grow_mesh_buffers(frame, INITIAL_MESH_CAPACITY)
+			|| !grow_command_buffer(frame, INITIAL_COMMAND_CAPACITY) || !grow_meshlet_buffer(frame, INITIAL_MESHLET_CAPACITY))
+			return false;
+	}
+
+	enabled = true;
+	CORE_TRACE("GpuDrivenRenderer fully initialized!");
+	return true;
+}
+
+void GpuDrivenRenderer::shutdown()
+{
+	frames.clear();
+	objects.clear();
+	meshes.clear();
+	meshlets.clear();
+	mesh_indices.clear();
+	command_count = 0;
+	statistics = Statistics{};
+	queue_batches.clear();
+	queue_instance_batches.clear();
+
+	// Descriptor sets are implicitly destroyed when the pool is destroyed
+	if (descriptor_pool != VK_NULL_HANDLE)
+		vkDestroyDescriptorPool(VulkanInstance::logical_device(), descriptor_pool, nullptr);
+	descriptor_pool = VK_NULL_HANDLE;
+
+	cull_pipeline.shutdown();
+	queue_cull_pipeline.shutdown();
+	depth_pyramid.shutdown();
+	enabled = false;
+}
+
+//----
+// Scene
+//----
+
+GpuDrivenRenderer::ObjectHandle GpuDrivenRenderer::add_object(const BasicRenderer::Mesh &mesh, const glm::mat4 &transform)
+{
+	if (mesh.get_vertex_format() != VertexFormat::Float) {
+		CORE_ERROR("GpuDrivenRenderer::add_object(): only meshes with Float vertices can be drawn indirectly");
+		return INVALID_OBJECT;
+	}
+
+	u32 mesh_index = get_mesh_index(mesh);
+	meshes[mesh_index].object_count++;
+	command_offsets_dirty = true;
+
+	GpuObject object{};
+	object.model = transform;
+	object.bounding_sphere = mesh.get_bounding_sphere();
+	object.mesh_index = mesh_index;
+	objects.push_back(object);
+
+	ObjectHandle handle = static_cast<ObjectHandle>(objects.size() - 1);
+	for (auto& frame : frames)
+		frame.pending_objects.push_back(handle);
+	return handle;
+}
+
+void GpuDrivenRenderer::update_object(ObjectHandle object, const glm::mat4 &transform)
+{
+	if (object >= objects.size()) {
+		CORE_ERROR("GpuDrivenRenderer::update_object(): invalid object handle %u", object);
+		return ;
+	}
+
+	objects[object].model = transform;
+	for (auto& frame : frames) {
+		// Past a point, rewriting the whole buffer is cheaper than scattering small writes
+		if (!frame.upload_all_objects && frame.pending_objects.size() >= objects.size() / 2)
+			frame.upload_all_objects = true;
+		if (!frame.upload_all_objects)
+			frame.pending_objects.push_back(object);
+	}
+}
+
+u32 GpuDrivenRenderer::get_mesh_index(const BasicRenderer::Mesh &mesh)
+{
+	auto it = mesh_indices.find(mesh.get_id());
+	if (it != mesh_indices.end())
+		return it->second;
+
+	MeshEntry entry;
+	entry.vertex_buffer = mesh.get_vertex_buffer().buffer();
+	entry.index_buffer = mesh.get_index_buffer().buffer();
+	entry.index_count = static_cast<u32>(mesh.get_index_count());
+	entry.index_type = mesh.get_index_type();
+	entry.upload_token = mesh.get_upload_token();
+	entry.first_meshlet = static_cast<u32>(meshlets.size());
+	entry.meshlet_count = static_cast<u32>(mesh.get_meshlets().size());
+	meshes.push_back(entry);
+	meshlets.insert(meshlets.end(), mesh.get_meshlets().begin(), mesh.get_meshlets().end());
+
+	u32 mesh_index = static_cast<u32>(meshes.size() - 1);
+	mesh_indices[mesh.get_id()] = mesh_index;
+	return mesh_index;
+}
+
+void GpuDrivenRenderer::update_command_offsets()
+{
+	// Each mesh gets room for a draw per meshlet of each object using it, in the order of the mesh table
+	u32 offset = 0;
+	for (auto& mesh : meshes) {
+		mesh.command_offset = offset;
+		offset += mesh.object_count * mesh.meshlet_count;
+	}
+	command_count = offset;
+	for (auto& frame : frames)
+		frame.upload_meshes = true;
+	command_offsets_dirty = false;
+}
+
+//----
+// Frame
+//----
+
+void GpuDrivenRenderer::prepare_frame(u32 frame_index)
+{
+	if (!enabled)
+		return ;
+	if (command_offsets_dirty)
+		update_command_offsets();
+
+	// The frame's fence was waited on, its buffers can be read back, replaced and their descriptor sets rewritten
+	FrameResources& frame = frames[frame_index];
+	read_statistics(frame);
+	frame.queue_culling = false;
+	if (frame.rewrite_descriptors) {
+		write_descriptor_sets(frame);
+		frame.rewrite_queue_descriptors = true;
+		frame.rewrite_descriptors = false;
+	}
+	if (objects.size() > frame.object_capacity && !grow_object_buffers(frame, static_cast<u32>(objects.size())))
+		return ;
+	if (meshes.size() > frame.mesh_capacity && !grow_mesh_buffers(frame, static_cast<u32>(meshes.size())))
+		return ;
+	if (command_count > frame.command_capacity && !grow_command_buffer(frame, command_count))
+		return ;
+	if (meshlets.size() > frame.meshlet_capacity && !grow_meshlet_buffer(frame, static_cast<u32>(meshlets.size())))
+		return ;
+
+	if (frame.upload_all_objects) {
+		frame.object_buffer.set_data(objects.data(), objects.size() * sizeof(GpuObject));
+	} else {
+		for (ObjectHandle object : frame.pending_objects)
+			frame.object_buffer.set_data(&objects[object], sizeof(GpuObject), object * sizeof(GpuObject));
+	}
+	frame.pending_objects.clear();
+	frame.upload_all_objects = false;
+	frame.object_count = static_cast<u32>(objects.size());
+
+	if (frame.upload_meshes) {
+		std::vector<GpuMesh> gpu_meshes(meshes.size());
+		for (u32 i = 0; i < meshes.size(); i++) {
+			// Every mesh owns its buffers, so its indices and vertices always start at 0
+			gpu_meshes[i].index_count = meshes[i].index_count;
+			gpu_meshes[i].first_index = 0;
+			gpu_meshes[i].vertex_offset = 0;
+			gpu_meshes[i].command_offset = meshes[i].command_offset;
+			gpu_meshes[i].first_meshlet = meshes[i].first_meshlet;
+			gpu_meshes[i].meshlet_count = meshes[i].meshlet_count;
+		}
+		frame.mesh_buffer.set_data(gpu_meshes.data(), gpu_meshes.size() * sizeof(GpuMesh));
+		frame.meshlet_buffer.set_data(meshlets.data(), meshlets.size() * sizeof(Meshlet));
+		frame.meshes = meshes;
+		frame.max_meshlet_count = 0;
+		for (const auto& mesh : meshes)
+			frame.max_meshlet_count = std::max(frame.max_meshlet_count, mesh.meshlet_count);
+		frame.upload_meshes = false;
+	}
+}
+
+void GpuDrivenRenderer::read_statistics(FrameResources &frame)
+{
+	if (frame.queue_statistics_pending) {
+		GpuQueueStatistics results{};
+		frame.queue_statistics_buffer.get_data(&results, sizeof(GpuQueueStatistics));
+		statistics.queue_frame_count++;
+		statistics.queue_instances_tested += results.instances_tested;
+		statistics.queue_instances_occluded += results.instances_occluded;
+		statistics.queue_instances_disoccluded += results.instances_disoccluded;
+		frame.queue_statistics_pending = false;
+	}
+	if (!frame.statistics_pending)
+		return ;
+
+	GpuStatistics results{};
+	frame.statistics_buffer.get_data(&results, sizeof(GpuStatistics));
+	statistics.frame_count++;
+	statistics.clusters_tested += results.clusters_tested;
+	statistics.clusters_frustum_culled += results.clusters_frustum_culled;
+	statistics.clusters_backface_culled += results.clusters_backface_culled;
+	statistics.triangles_tested += results.triangles_tested;
+	statistics.triangles_frustum_culled += results.triangles_frustum_culled;
+	statistics.triangles_backface_culled += results.triangles_backface_culled;
+	statistics.objects_occlusion_tested += results.objects_occlusion_tested;
+	statistics.objects_occluded += results.objects_occluded;
+	statistics.objects_disoccluded += results.objects_disoccluded;
+	frame.statistics_pending = false;
+}
+
+void GpuDrivenRenderer::record_culling(VkCommandBuffer command_buffer, u32 frame_index, const glm::mat4 &view_projection,
+	const glm::vec3 &camera_position)
+{
+	if (!enabled)
+		return ;
+	FrameResources& frame = frames[frame_index];
+	frame.view_projection = view_projection;
+	if (frame.object_count == 0)
+		return ;
+
+	vkCmdFillBuffer(command_buffer, frame.count_buffer.buffer(), 0, frame.meshes.size() * sizeof(u32), 0);
+	vkCmdFillBuffer(command_buffer, frame.statistics_buffer.buffer(), 0, sizeof(GpuStatistics), 0);
+	if (frame.clear_visibility) {
+		for (const auto& buffer : frame.visibility_buffers)
+			vkCmdFillBuffer(command_buffer, buffer.buffer(), 0, VK_WHOLE_SIZE, 0);
+		frame.clear_visibility = false;
+	}
+
+	VkMemoryBarrier clear_barrier{};
+	clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clear_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+
+	frame.constants = CullConstants{};
+	frame.constants.view_projection = view_projection;
+	frame.constants.camera_position = glm::vec4(camera_position, 1.0f);
+	frame.constants.pyramid_size = glm::vec2(depth_pyramid.width(), depth_pyramid.height());
+	frame.constants.pyramid_level_count = depth_pyramid.level_count();
+	frame.constants.object_count = frame.object_count;
+	frame.constants.phase = occlusion_culling ? PHASE_EARLY : PHASE_ALL;
+	frame.constants.visibility_parity = frame.visibility_parity;
+	depth_pyramid.record_initial_layout(command_buffer);
+	dispatch_culling(command_buffer, frame);
+	frame.statistics_pending = true;
+
+	// The commands and counts are read as indirect arguments, the objects again by the vertex shader, the statistics by the host
+	VkMemoryBarrier cull_barrier{};
+	cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cull_barrier,
+		0, nullptr, 0, nullptr);
+}
+
+bool GpuDrivenRenderer::objects_split(u32 frame_index)
+{
+	return frames[frame_index].object_count > 0 && frames[frame_index].constants.phase == PHASE_EARLY;
+}
+
+bool GpuDrivenRenderer::occlusion_culling_active(u32 frame_index)
+{
+	return enabled && (objects_split(frame_index) || frames[frame_index].queue_culling);
+}
+
+void GpuDrivenRenderer::record_occlusion_culling(VkCommandBuffer command_buffer, u32 frame_index)
+{
+	if (!occlusion_culling_active(frame_index))
+		return ;
+	FrameResources& frame = frames[frame_index];
+
+	{
+		// Measured on its own, the rest of the occlusion culling is the late phase
+		GpuProfiler::Scope scope(command_buffer, "Depth pyramid");
+		depth_pyramid.record_build(command_buffer);
+		pyramid_view_projection = frame.view_projection;
+	}
+
+	if (frame.queue_culling) {
+		// The early pass is done drawing the instances the late phase overwrites, and the late phase reads the early flags
+		VkMemoryBarrier early_barrier{};
+		early_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		early_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		early_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT
+			| VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &early_barrier, 0, nullptr, 0, nullptr);
+
+		frame.queue_constants.view_projection = frame.view_projection;
+		frame.queue_constants.phase = PHASE_LATE;
+		queue_cull_pipeline.bind(command_buffer, frame.queue_descriptor_set);
+		queue_cull_pipeline.push_constants(command_buffer, &frame.queue_constants, sizeof(QueueCullConstants));
+		queue_cull_pipeline.dispatch(command_buffer, frame.queue_constants.instance_count, CULL_GROUP_SIZE);
+
+		VkMemoryBarrier cull_barrier{};
+		cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cull_barrier,
+			0, nullptr, 0, nullptr);
+	}
+	if (!objects_split(frame_index))
+		return ;
+
+	// The early pass is done reading the commands and counts, the late phase starts them over
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 0, nullptr);
+	vkCmdFillBuffer(command_buffer, frame.count_buffer.buffer(), 0, frame.meshes.size() * sizeof(u32), 0);
+
+	VkMemoryBarrier clear_barrier{};
+	clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clear_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+
+	frame.constants.phase = PHASE_LATE;
+	dispatch_culling(command_buffer, frame);
+	// What the late phase wrote is what the next early phase of the frame reads
+	frame.visibility_parity ^= 1;
+
+	VkMemoryBarrier cull_barrier{};
+	cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cull_barrier,
+		0, nullptr, 0, nullptr);
+}
+
+void GpuDrivenRenderer::dispatch_culling(VkCommandBuffer command_buffer, FrameResources &frame)
+{
+	// A row of workgroups per object, wide enough for the mesh with the most meshlets
+	cull_pipeline.bind(command_buffer, frame.cull_descriptor_set);
+	for (u32 first_object = 0; first_object < frame.object_count; first_object += MAX_DISPATCH_OBJECTS) {
+		frame.constants.first_object = first_object;
+		cull_pipeline.push_constants(command_buffer, &frame.constants, sizeof(CullConstants));
+		cull_pipeline.dispatch(command_buffer, frame.max_meshlet_count, CULL_GROUP_SIZE,
+			std::min(frame.object_count - first_object, MAX_DISPATCH_OBJECTS));
+	}
+}
+
+bool GpuDrivenRenderer::record_queue_culling(VkCommandBuffer command_buffer, u32 frame_index, const RenderQueue &queue,
+	const Buffer &instance_buffer, u32 base_instance)
+{
+	if (!enabled || !occlusion_culling)
+		return false;
+	FrameResources& frame = frames[frame_index];
+	const auto& batches = queue.batches();
+	const u32 instance_count = static_cast<u32>(queue.sorted_transforms().size());
+	if (batches.empty() || instance_count == 0 || instance_count > MAX_QUEUE_INSTANCES)
+		return false;
+	if ((batches.size() > frame.queue_batch_capacity || instance_count > frame.queue_instance_capacity)
+		&& !grow_queue_buffers(frame, static_cast<u32>(batches.size()), instance_count))
+		return false;
+	if (frame.rewrite_queue_descriptors || frame.queue_instance_source != instance_buffer.buffer())
+		write_queue_descriptor_set(frame, instance_buffer.buffer());
+
+	// Each phase counts its visible instances from 0, compacted at the start of the batch's range
+	queue_batches.resize(batches.size());
+	queue_instance_batches.resize(instance_count);
+	for (u32 i = 0; i < batches.size(); i++) {
+		const RenderQueue::DrawBatch& batch = batches[i];
+		const RenderQueue::MeshBinding& mesh = queue.mesh(batch.mesh_slot);
+		GpuQueueBatch& gpu_batch = queue_batches[i];
+		gpu_batch = GpuQueueBatch{};
+		gpu_batch.early_command.indexCount = mesh.index_count;
+		gpu_batch.early_command.firstIndex = mesh.first_index;
+		gpu_batch.early_command.firstInstance = batch.first_instance;
+		gpu_batch.late_command = gpu_batch.early_command;
+		gpu_batch.bounding_sphere = mesh.bounding_sphere;
+		std::fill_n(queue_instance_batches.begin() + batch.first_instance, batch.instance_count, i);
+	}
+	frame.queue_batch_buffer.set_data(queue_batches.data(), queue_batches.size() * sizeof(GpuQueueBatch));
+	frame.queue_instance_batch_buffer.set_data(queue_instance_batches.data(), instance_count * sizeof(u32));
+
+	vkCmdFillBuffer(command_buffer, frame.queue_statistics_buffer.buffer(), 0, sizeof(GpuQueueStatistics), 0);
+	VkMemoryBarrier clear_barrier{};
+	clear_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	clear_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	clear_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 1, &clear_barrier, 0, nullptr, 0, nullptr);
+
+	// Until a pyramid was built everything is drawn in the early phase, this frame builds the first one
+	frame.queue_constants = QueueCullConstants{};
+	frame.queue_constants.view_projection = pyramid_view_projection;
+	frame.queue_constants.pyramid_size = glm::vec2(depth_pyramid.width(), depth_pyramid.height());
+	frame.queue_constants.pyramid_level_count = depth_pyramid.level_count();
+	frame.queue_constants.instance_count = instance_count;
+	frame.queue_constants.base_instance = base_instance;
+	frame.queue_constants.phase = PHASE_EARLY;
+	frame.queue_constants.test_pyramid = depth_pyramid.is_built() ? 1 : 0;
+	depth_pyramid.record_initial_layout(command_buffer);
+	queue_cull_pipeline.bind(command_buffer, frame.queue_descriptor_set);
+	queue_cull_pipeline.push_constants(command_buffer, &frame.queue_constants, sizeof(QueueCullConstants));
+	queue_cull_pipeline.dispatch(command_buffer, instance_count, CULL_GROUP_SIZE);
+	frame.queue_culling = true;
+	frame.queue_statistics_pending = true;
+
+	// The commands are read as indirect arguments, the culled instances as vertex attributes
+	VkMemoryBarrier cull_barrier{};
+	cull_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cull_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cull_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &cull_barrier, 0, nullptr, 0, nullptr);
+	return true;
+}
+
+void GpuDrivenRenderer::record_queue_draw(VkCommandBuffer command_buffer, u32 frame_index, u32 batch, bool late_phase)
+{
+	// A single command, its instance count is only known to the GPU
+	VkDeviceSize offset = batch * sizeof(GpuQueueBatch)
+		+ (late_phase ? offsetof(GpuQueueBatch, late_command) : offsetof(GpuQueueBatch, early_command));
+	vkCmdDrawIndexedIndirect(command_buffer, frames[frame_index].queue_batch_buffer.buffer(), offset, 1,
+		sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void GpuDrivenRenderer::on_swapchain_recreated()
+{
+	if (!enabled)
+		return ;
+
+	if (!depth_pyramid.recreate()) {
+		CORE_ERROR("GpuDrivenRenderer: couldn't recreate the depth pyramid, GPU-driven rendering is disabled");
+		enabled = false;
+		return ;
+	}
+	// The culling sets of the frames in flight are in use, they can only be rewritten once their fence was waited on
+	for (auto& frame : frames)
+		frame.rewrite_descriptors = true;
+}
+
+void GpuDrivenRenderer::record_draws(VkCommandBuffer command_buffer, u32 frame_index, VkDescriptorSet camera_descriptor_set,
+	bool depth_prepass)
+{
+	if (!enabled || frames[frame_index].object_count == 0)
+		return ;
+	FrameResources& frame = frames[frame_index];
+
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+		depth_prepass ? GraphicsPipeline::indirect_depth_pipeline() : GraphicsPipeline::indirect_pipeline());
+	VkDescriptorSet descriptor_sets[] = {camera_descriptor_set, frame.object_descriptor_set};
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline::indirect_pipeline_layout(),
+		0, 2, descriptor_sets, 0, nullptr);
+
+	// One bind and one indirect draw per mesh, the GPU decides how many of its commands are executed
+	VkDeviceSize offset = 0;
+	for (u32 i = 0; i < frame.meshes.size(); i++) {
+		const MeshEntry& mesh = frame.meshes[i];
+		if (mesh.object_count == 0 || mesh.meshlet_count == 0 || !TransferContext::is_complete(mesh.upload_token))
+			continue;
+
+		vkCmdBindVertexBuffers(command_buffer, 0, 1, &mesh.vertex_buffer, &offset);
+		vkCmdBindIndexBuffer(command_buffer, mesh.index_buffer, 0, mesh.index_type);
+		vkCmdDrawIndexedIndirectCount(command_buffer,
+			frame.command_buffer.buffer(), mesh.command_offset * sizeof(VkDrawIndexedIndirectCommand),
+			frame.count_buffer.buffer(), i * sizeof(u32),
+			mesh.object_count * mesh.meshlet_count, sizeof(VkDrawIndexedIndirectCommand));
+	}
+}
+
+//----
+// Resources
+//----
+
+bool GpuDrivenRenderer::create_descriptor_pool(u32 frames_in_flight)
+{
+	// Per frame, the culling set has 8 storage buffers and the depth pyramid, the object set 1 storage buffer, and the render
+	// queue set 6 storage buffers and the depth pyramid
+	VkDescriptorPoolSize pool_sizes[2]{};
+	pool_sizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	pool_sizes[0].descriptorCount = frames_in_flight * 15;
+	pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	pool_sizes[1].descriptorCount = frames_in_flight * 2;
+
+	VkDescriptorPoolCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	create_infos.poolSizeCount = 2;
+	create_infos.pPoolSizes = pool_sizes;
+	create_infos.maxSets = frames_in_flight * 3;
+
+	VkResult result = vkCreateDescriptorPool(VulkanInstance::logical_device(), &create_infos, nullptr, &descriptor_pool);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create GpuDrivenRenderer's descriptor pool: %s", vulkan_error_to_string(result));
+		return false;
+	}
+	return true;
+}
+
+bool GpuDrivenRenderer::allocate_descriptor_sets()
+{
+	std::vector<VkDescriptorSetLayout> layouts;
+	for (u32 i = 0; i < frames.size(); i++) {
+		layouts.push_back(cull_pipeline.descriptor_set_layout());
+		layouts.push_back(GraphicsPipeline::object_descriptor_set_layout());
+		layouts.push_back(queue_cull_pipeline.descriptor_set_layout());
+	}
+	std::vector<VkDescriptorSet> descriptor_sets(layouts.size());
+
+	VkDescriptorSetAllocateInfo alloc_infos{};
+	alloc_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	alloc_infos.descriptorPool = descriptor_pool;
+	alloc_infos.descriptorSetCount = static_cast<u32>(layouts.size());
+	alloc_infos.pSetLayouts = layouts.data();
+
+	VkResult result = vkAllocateDescriptorSets(VulkanInstance::logical_device(), &alloc_infos, descriptor_sets.data());
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't allocate GpuDrivenRenderer's descriptor sets: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	for (u32 i = 0; i < frames.size(); i++) {
+		frames[i].cull_descriptor_set = descriptor_sets[i * 3];
+		frames[i].object_descriptor_set = descriptor_sets[i * 3 + 1];
+		frames[i].queue_descriptor_set = descriptor_sets[i * 3 + 2];
+	}
+	return true;
+}
+
+bool GpuDrivenRenderer::grow_object_buffers(FrameResources &frame, u32 required_capacity)
+{
+	u32 new_capacity = std::max({frame.object_capacity * 2, required_capacity, INITIAL_OBJECT_CAPACITY});
+
+	// The objects are written by the CPU, their visibility only ever by the culling shader
+	Buffer object_buffer(new_capacity * sizeof(GpuObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Buffer visibility_buffers[2];
+	for (auto& buffer : visibility_buffers)
+		buffer = Buffer(new_capacity * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (object_buffer.buffer() == VK_NULL_HANDLE || visibility_buffers[0].buffer() == VK_NULL_HANDLE
+		|| visibility_buffers[1].buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't grow GpuDrivenRenderer's object buffers to %u objects", new_capacity);
+		return false;
+	}
+
+	frame.object_buffer = std::move(object_buffer);
+	for (u32 i = 0; i < 2; i++)
+		frame.visibility_buffers[i] = std::move(visibility_buffers[i]);
+	frame.clear_visibility = true;
+	frame.object_capacity = new_capacity;
+	frame.pending_objects.clear();
+	frame.upload_all_objects = true;
+	write_descriptor_sets(frame);
+	return true;
+}
+
+bool GpuDrivenRenderer::grow_mesh_buffers(FrameResources &frame, u32 required_capacity)
+{
+	u32 new_capacity = std::max({frame.mesh_capacity * 2, required_capacity, INITIAL_MESH_CAPACITY});
+
+	Buffer mesh_buffer(new_capacity * sizeof(GpuMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Buffer count_buffer(new_capacity * sizeof(u32),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (mesh_buffer.buffer() == VK_NULL_HANDLE || count_buffer.buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't grow GpuDrivenRenderer's mesh buffers to %u meshes", new_capacity);
+		return false;
+	}
+
+	frame.mesh_buffer = std::move(mesh_buffer);
+	frame.count_buffer = std::move(count_buffer);
+	frame.mesh_capacity = new_capacity;
+	frame.upload_meshes = true;
+	write_descriptor_sets(frame);
+	return true;
+}
+
+bool GpuDrivenRenderer::grow_command_buffer(FrameResources &frame, u32 required_capacity)
+{
+	u32 new_capacity = std::max({frame.command_capacity * 2, required_capacity, INITIAL_COMMAND_CAPACITY});
+
+	// Only ever written by the culling shader
+	Buffer command_buffer(new_capacity * sizeof(VkDrawIndexedIndirectCommand),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (command_buffer.buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't grow GpuDrivenRenderer's command buffer to %u commands", new_capacity);
+		return false;
+	}
+
+	frame.command_buffer = std::move(command_buffer);
+	frame.command_capacity = new_capacity;
+	write_descriptor_sets(frame);
+	return true;
+}
+
+bool GpuDrivenRenderer::grow_meshlet_buffer(FrameResources &frame, u32 required_capacity)
+{
+	u32 new_capacity = std::max({frame.meshlet_capacity * 2, required_capacity, INITIAL_MESHLET_CAPACITY});
+
+	Buffer meshlet_buffer(new_capacity * sizeof(Meshlet), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (meshlet_buffer.buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't grow GpuDrivenRenderer's meshlet buffer to %u meshlets", new_capacity);
+		return false;
+	}
+
+	frame.meshlet_buffer = std::move(meshlet_buffer);
+	frame.meshlet_capacity = new_capacity;
+	frame.upload_meshes = true;
+	write_descriptor_sets(frame);
+	return true;
+}
+
+bool GpuDrivenRenderer::grow_queue_buffers(FrameResources &frame, u32 required_batches, u32 required_instances)
+{
+	u32 batch_capacity = std::max({frame.queue_batch_capacity * 2, required_batches, INITIAL_QUEUE_BATCH_CAPACITY});
+	u32 instance_capacity = std::max({frame.queue_instance_capacity * 2, required_instances, INITIAL_QUEUE_INSTANCE_CAPACITY});
+
+	// The batches are written by the CPU every frame, their instance counts by the culling shader
+	Buffer batch_buffer(batch_capacity * sizeof(GpuQueueBatch), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Buffer instance_batch_buffer(instance_capacity * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	Buffer occluded_buffer(instance_capacity * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Buffer culled_buffer(instance_capacity * sizeof(glm::mat4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	if (batch_buffer.buffer() == VK_NULL_HANDLE || instance_batch_buffer.buffer() == VK_NULL_HANDLE
+		|| occluded_buffer.buffer() == VK_NULL_HANDLE || culled_buffer.buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't grow GpuDrivenRenderer's render queue buffers to %u batches and %u instances", batch_capacity,
+			instance_capacity);
+		return false;
+	}
+	if (frame.queue_statistics_buffer.buffer() == VK_NULL_HANDLE) {
+		frame.queue_statistics_buffer = Buffer(sizeof(GpuQueueStatistics), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+			| VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (frame.queue_statistics_buffer.buffer() == VK_NULL_HANDLE) {
+			CORE_ERROR("Couldn't create GpuDrivenRenderer's render queue statistics buffer");
+			return false;
+		}
+	}
+
+	frame.queue_batch_buffer = std::move(batch_buffer);
+	frame.queue_instance_batch_buffer = std::move(instance_batch_buffer);
+	frame.queue_occluded_buffer = std::move(occluded_buffer);
+	frame.queue_culled_buffer = std::move(culled_buffer);
+	frame.queue_batch_capacity = batch_capacity;
+	frame.queue_instance_capacity = instance_capacity;
+	frame.rewrite_queue_descriptors = true;
+	return true;
+}
+
+void GpuDrivenRenderer::write_descriptor_sets(FrameResources &frame)
+{
+	// Until every buffer exists there is nothing complete to write
+	const Buffer *cull_buffers[] = {&frame.object_buffer, &frame.mesh_buffer, &frame.command_buffer, &frame.count_buffer,
+		&frame.meshlet_buffer, &frame.statistics_buffer, &frame.visibility_buffers[0], &frame.visibility_buffers[1]};
+	for (const Buffer *buffer : cull_buffers) {
+		if (buffer->buffer() == VK_NULL_HANDLE)
+			return ;
+	}
+
+	VkDescriptorBufferInfo buffer_infos[9]{};
+	VkWriteDescriptorSet desc_writes[10]{};
+	for (u32 i = 0; i < 9; i++) {
+		// The last buffer write is the object buffer again, for the vertex shader's set
+		const Buffer *buffer = i < 8 ? cull_buffers[i] : &frame.object_buffer;
+		buffer_infos[i].buffer = buffer->buffer();
+		buffer_infos[i].offset = 0;
+		buffer_infos[i].range = VK_WHOLE_SIZE;
+
+		desc_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		desc_writes[i].dstSet = i < 8 ? frame.cull_descriptor_set : frame.object_descriptor_set;
+		desc_writes[i].dstBinding = i < 8 ? i : 0;
+		desc_writes[i].dstArrayElement = 0;
+		desc_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		desc_writes[i].descriptorCount = 1;
+		desc_writes[i].pBufferInfo = &buffer_infos[i];
+	}
+
+	VkDescriptorImageInfo pyramid_infos{};
+	pyramid_infos.sampler = depth_pyramid.sampler();
+	pyramid_infos.imageView = depth_pyramid.image_view();
+	pyramid_infos.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	desc_writes[9].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	desc_writes[9].dstSet = frame.cull_descriptor_set;
+	desc_writes[9].dstBinding = 8;
+	desc_writes[9].dstArrayElement = 0;
+	desc_writes[9].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	desc_writes[9].descriptorCount = 1;
+	desc_writes[9].pImageInfo = &pyramid_infos;
+	vkUpdateDescriptorSets(VulkanInstance::logical_device(), 10, desc_writes, 0, nullptr);
+}
+
+void GpuDrivenRenderer::write_queue_descriptor_set(FrameResources &frame, VkBuffer instance_buffer)
+{
+	VkBuffer buffers[] = {instance_buffer, frame.queue_batch_buffer.buffer(), frame.queue_instance_batch_buffer.buffer(),
+		frame.queue_occluded_buffer.buffer(), frame.queue_culled_buffer.buffer(), frame.queue_statistics_buffer.buffer()};
+	VkDescriptorBufferInfo buffer_infos[6]{};
+	VkWriteDescriptorSet desc_writes[7]{};
+	for (u32 i = 0; i < 6; i++) {
+		buffer_infos[i].buffer = buffers[i];
+		buffer_infos[i].offset = 0;
+		buffer_infos[i].range = VK_WHOLE_SIZE;
+
+		desc_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		desc_writes[i].dstSet = frame.queue_descriptor_set;
+		desc_writes[i].dstBinding = i;
+		desc_writes[i].dstArrayElement = 0;
+		desc_writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		desc_writes[i].descriptorCount = 1;
+		desc_writes[i].pBufferInfo = &buffer_infos[i];
+	}
+
+	VkDescriptorImageInfo pyramid_infos{};
+	pyramid_infos.sampler = depth_pyramid.sampler();
+	pyramid_infos.imageView = depth_pyramid.image_view();
+	pyramid_infos.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	desc_writes[6].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	desc_writes[6].dstSet = frame.queue_descriptor_set;
+	desc_writes[6].dstBinding = 6;
+	desc_writes[6].dstArrayElement = 0;
+	desc_writes[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	desc_writes[6].descriptorCount = 1;
+	desc_writes[6].pImageInfo = &pyramid_infos;
+	vkUpdateDescriptorSets(VulkanInstance::logical_device(), 7, desc_writes, 0, nullptr);
+
+	frame.queue_instance_source = instance_buffer;
+	frame.rewrite_queue_descriptors = false;
+}
+
+} // Vulkan
@@ -0,0 +1,323 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef GPUDRIVENRENDERER_H
+#define GPUDRIVENRENDERER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include <limits>
+#include "defines.h"
+#include "glm/glm.hpp"
+#include "BasicRenderer.h"
+#include "vulkan/Buffer.h"
+#include "vulkan/ComputePipeline.h"
+#include "DepthPyramid.h"
+
+namespace Vulkan {
+
+// Persistent objects culled and turned into indirect draws by a compute shader, drawn by BasicRenderer at the end of each frame.
+// Meshes are referenced, not copied: a mesh must outlive the objects using it.
+// With occlusion culling the objects are culled in two phases around a depth pyramid: the early phase draws the objects that
+// were visible the last time the frame was drawn, the late phase tests all the others against the pyramid built from that.
+// The instances of BasicRenderer's render queue go through the same two phases, see record_queue_culling().
+class GpuDrivenRenderer
+{
+public:		// Types
+	using ObjectHandle = u32;
+	static constexpr ObjectHandle	INVALID_OBJECT = std::numeric_limits<u32>::max();
+
+	// Read back from the culling pass once each frame's fence is waited on, summed until reset_statistics()
+	struct Statistics
+	{
+		u32	frame_count					= 0;
+		u64	clusters_tested				= 0;
+		u64	clusters_frustum_culled		= 0;
+		u64	clusters_backface_culled	= 0;
+		u64	triangles_tested			= 0;
+		u64	triangles_frustum_culled	= 0;
+		u64	triangles_backface_culled	= 0;
+
+		// Objects of the late phase inside the frustum, those the depth pyramid hid, and those drawn because they became visible
+		u64	objects_occlusion_tested	= 0;
+		u64	objects_occluded			= 0;
+		u64	objects_disoccluded			= 0;
+
+		// Render queue instances tested, those still occluded after the late phase, and those the late phase drew
+		u32	queue_frame_count			= 0;
+		u64	queue_instances_tested		= 0;
+		u64	queue_instances_occluded	= 0;
+		u64	queue_instances_disoccluded	= 0;
+	};
+
+public:		// Methods
+	//----
+	// Initialization
+	//----
+	// Does nothing and stays disabled if the device lacks multi draw indirect or draw indirect count. When the depth buffer
+	// can't be sampled to build the depth pyramid, only occlusion culling is off
+	static bool	initialize(u32 frames_in_flight);
+	static void	shutdown();
+
+	//----
+	// Scene
+	//----
+	// The indirect pipeline only reads Vertex, quantized meshes are refused with INVALID_OBJECT
+	static ObjectHandle	add_object(const BasicRenderer::Mesh& mesh, const glm::mat4& transform);
+	static void			update_object(ObjectHandle object, const glm::mat4& transform);
+
+	//----
+	// Frame, driven by BasicRenderer
+	//----
+	// Applies the updates the frame missed, its fence must have been waited on
+	static void	prepare_frame(u32 frame_index);
+	// Outside of any render pass. Every meshlet of every object is tested against the frustum and its normal cone.
+	// With occlusion culling, this is the early phase
+	static void	record_culling(VkCommandBuffer command_buffer, u32 frame_index, const glm::mat4& view_projection,
+					const glm::vec3& camera_position);
+	// When true, the frame is split around the depth pyramid: the early phase is drawn in GraphicsPipeline::early_render_pass(),
+	// then record_occlusion_culling() runs and the late phase is drawn in GraphicsPipeline::late_render_pass(). Valid once
+	// record_queue_culling() was recorded
+	static bool	occlusion_culling_active(u32 frame_index);
+	// Between the two render passes: builds the pyramid from the early pass's depth and runs the late phase of the objects and
+	// of the render queue. Its commands replace those of the early phase, record_draws() then only draws the objects that came
+	// into view
+	static void	record_occlusion_culling(VkCommandBuffer command_buffer, u32 frame_index);
+	// Inside the render pass, camera_descriptor_set is bound as set 0. The depth prepass replays the same commands
+	static void	record_draws(VkCommandBuffer command_buffer, u32 frame_index, VkDescriptorSet camera_descriptor_set,
+					bool depth_prepass = false);
+
+	// After record_culling(), outside of any render pass. The queue's instances start at base_instance in instance_buffer,
+	// which needs the storage usage. The early phase tests them against the last pyramid built, from where it was built,
+	// and the late phase tests those it left out against this frame's pyramid. Returns false when they can't be culled,
+	// the batches are then drawn directly
+	static bool	record_queue_culling(VkCommandBuffer command_buffer, u32 frame_index, const RenderQueue& queue,
+					const Buffer& instance_buffer, u32 base_instance);
+	static bool	queue_culling_active(u32 frame_index)	{ return enabled && frames[frame_index].queue_culling; }
+	// Replaces the frame's instance buffer at vertex binding 1 while the queue is culled
+	static VkBuffer	queue_instance_buffer(u32 frame_index)	{ return frames[frame_index].queue_culled_buffer.buffer(); }
+	// Inside the render pass, the queue batch's instances visible in the early or the late phase
+	static void	record_queue_draw(VkCommandBuffer command_buffer, u32 frame_index, u32 batch, bool late_phase);
+
+	// The depth buffer was recreated with the swapchain. The frames in flight keep the old pyramid, each culling set is
+	// rewritten when its frame is prepared again
+	static void	on_swapchain_recreated();
+
+	//----
+	// Settings
+	//----
+	// On by default when there is a depth pyramid, takes effect at the next frame. Without it everything in the frustum is drawn
+	// in a single pass
+	static void	set_occlusion_culling(bool enable)	{ occlusion_culling = enable && !depth_pyramid.is_placeholder(); }
+
+	//----
+	// Getters
+	//----
+	static bool	is_enabled()	{ return enabled; }
+	static u32	object_count()	{ return static_cast<u32>(objects.size()); }
+
+	static const Statistics&	get_statistics()	{ return statistics; }
+	static void					reset_statistics()	{ statistics = Statistics{}; }
+
+private:	// Types
+	// Mirrors ObjectData in cull.comp.glsl and indirect.vert.glsl, std430 layout
+	struct GpuObject
+	{
+		glm::mat4	model;
+		glm::vec4	bounding_sphere;
+		u32			mesh_index;
+		u32			padding[3];
+	};
+
+	// Mirrors MeshData in cull.comp.glsl
+	struct GpuMesh
+	{
+		u32	index_count;
+		u32	first_index;
+		i32	vertex_offset;
+		u32	command_offset;
+		u32	first_meshlet;
+		u32	meshlet_count;
+		u32	padding[2];
+	};
+
+	// Mirrors CullData in cull.comp.glsl, the frustum planes are extracted from view_projection there
+	struct CullConstants
+	{
+		glm::mat4	view_projection;
+		glm::vec4	camera_position;
+		glm::vec2	pyramid_size;
+		u32			pyramid_level_count;
+		u32			object_count;
+		u32			first_object;
+		u32			phase;
+		u32			visibility_parity;
+		u32			padding;
+	};
+
+	// Mirrors BatchData in queue_cull.comp.glsl, std430 layout
+	struct GpuQueueBatch
+	{
+		VkDrawIndexedIndirectCommand	early_command;
+		VkDrawIndexedIndirectCommand	late_command;
+		u32								padding[2];
+		glm::vec4						bounding_sphere;
+	};
+
+	// Mirrors QueueCullData in queue_cull.comp.glsl
+	struct QueueCullConstants
+	{
+		glm::mat4	view_projection;
+		glm::vec2	pyramid_size;
+		u32			pyramid_level_count;
+		u32			instance_count;
+		u32			base_instance;
+		u32			phase;
+		u32			test_pyramid;
+		u32			padding;
+	};
+
+	// Mirrors Statistics in queue_cull.comp.glsl
+	struct GpuQueueStatistics
+	{
+		u32	instances_tested;
+		u32	instances_occluded;
+		u32	instances_disoccluded;
+	};
+
+	// Mirrors Statistics in cull.comp.glsl
+	struct GpuStatistics
+	{
+		u32	clusters_tested;
+		u32	clusters_frustum_culled;
+		u32	clusters_backface_culled;
+		u32	triangles_tested;
+		u32	triangles_frustum_culled;
+		u32	triangles_backface_culled;
+		u32	objects_occlusion_tested;
+		u32	objects_occluded;
+		u32	objects_disoccluded;
+	};
+
+	struct MeshEntry
+	{
+		VkBuffer	vertex_buffer	= VK_NULL_HANDLE;
+		VkBuffer	index_buffer	= VK_NULL_HANDLE;
+		u32			index_count		= 0;
+		VkIndexType	index_type		= VK_INDEX_TYPE_UINT32;
+		UploadToken	upload_token	= 0;
+		u32			first_meshlet	= 0;
+		u32			meshlet_count	= 0;
+
+		// Objects using the mesh, and where its region starts in the command buffer, a command per meshlet of each object
+		u32			object_count	= 0;
+		u32			command_offset	= 0;
+	};
+
+	struct FrameResources
+	{
+		Buffer			object_buffer;
+		Buffer			mesh_buffer;
+		Buffer			command_buffer;
+		Buffer			count_buffer;
+		Buffer			meshlet_buffer;
+		Buffer			statistics_buffer;
+		// Whether each object passed the last late phase: one is read while the other is written, they swap every frame
+		Buffer			visibility_buffers[2];
+		u32				object_capacity		= 0;
+		u32				mesh_capacity		= 0;
+		u32				command_capacity	= 0;
+		u32				meshlet_capacity	= 0;
+
+		VkDescriptorSet	cull_descriptor_set		= VK_NULL_HANDLE;
+		VkDescriptorSet	object_descriptor_set	= VK_NULL_HANDLE;
+
+		// What the buffers held when the frame was prepared, objects added later wait for the next one
+		u32						object_count		= 0;
+		u32						max_meshlet_count	= 0;
+		std::vector<MeshEntry>	meshes;
+
+		// Kept from the early phase for the late one
+		CullConstants			constants{};
+		u32						visibility_parity	= 0;
+		// The visibility buffers are new, everything starts hidden so the late phase tests it all
+		bool					clear_visibility	= false;
+
+		// The statistics buffer holds the results of the last culling pass recorded for the frame
+		bool					statistics_pending	= false;
+
+		// Updates made while the frame was in flight, applied when it comes back
+		std::vector<ObjectHandle>	pending_objects;
+		bool						upload_all_objects	= false;
+		bool						upload_meshes		= false;
+		bool						rewrite_descriptors	= false;
+
+		// Camera of the frame, the pyramid it builds is tested against from the same point of view
+		glm::mat4				view_projection	= glm::mat4(1.0f);
+
+		// Render queue culling, its buffers are created the first time the queue is culled
+		Buffer					queue_batch_buffer;
+		Buffer					queue_instance_batch_buffer;
+		Buffer					queue_occluded_buffer;
+		Buffer					queue_culled_buffer;
+		Buffer					queue_statistics_buffer;
+		u32						queue_batch_capacity	= 0;
+		u32						queue_instance_capacity	= 0;
+		VkDescriptorSet			queue_descriptor_set	= VK_NULL_HANDLE;
+		// The instance buffer the set was written with, BasicRenderer replaces it when it grows
+		VkBuffer				queue_instance_source	= VK_NULL_HANDLE;
+		bool					rewrite_queue_descriptors	= false;
+		bool					queue_culling			= false;
+		QueueCullConstants		queue_constants{};
+		bool					queue_statistics_pending	= false;
+	};
+
+private:	// Methods
+	static bool	create_descriptor_pool(u32 frames_in_flight);
+	static bool	allocate_descriptor_sets();
+	static u32	get_mesh_index(const BasicRenderer::Mesh& mesh);
+	static void	update_command_offsets();
+
+	static bool	grow_object_buffers(FrameResources& frame, u32 required_capacity);
+	static bool	grow_mesh_buffers(FrameResources& frame, u32 required_capacity);
+	static bool	grow_command_buffer(FrameResources& frame, u32 required_capacity);
+	static bool	grow_meshlet_buffer(FrameResources& frame, u32 required_capacity);
+	static bool	grow_queue_buffers(FrameResources& frame, u32 required_batches, u32 required_instances);
+	static void	read_statistics(FrameResources& frame);
+	static void	dispatch_culling(VkCommandBuffer command_buffer, FrameResources& frame);
+	static void	write_descriptor_sets(FrameResources& frame);
+	static void	write_queue_descriptor_set(FrameResources& frame, VkBuffer instance_buffer);
+	// The objects were culled in the early phase this frame, the late phase has to test the others
+	static bool	objects_split(u32 frame_index);
+
+private:	// Members
+	static bool								enabled;
+	static ComputePipeline					cull_pipeline;
+	static ComputePipeline					queue_cull_pipeline;
+	static DepthPyramid						depth_pyramid;
+	// Camera of the frame that last built the pyramid
+	static glm::mat4						pyramid_view_projection;
+	static bool								occlusion_culling;
+	static VkDescriptorPool					descriptor_pool;
+	static std::vector<FrameResources>		frames;
+
+	static std::vector<GpuObject>			objects;
+	static std::vector<MeshEntry>			meshes;
+	// The meshlets of every mesh one after the other, a mesh's start at its first_meshlet
+	static std::vector<Meshlet>				meshlets;
+	// Commands needed by every object, recomputed with the command offsets
+	static u32								command_count;
+	static std::unordered_map<u32, u32>		mesh_indices;
+	static bool								command_offsets_dirty;
+	static Statistics						statistics;
+
+	// Written to each frame's queue buffers, kept to reuse their memory
+	static std::vector<GpuQueueBatch>		queue_batches;
+	static std::vector<u32>					queue_instance_batches;
+};
+
+} // Vulkan
+
+#endif //GPUDRIVENRENDERER_H
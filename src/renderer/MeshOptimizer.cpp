@@ -0,0 +1,299 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <limits>
+#include "log.h"
+#include "utils.h"
+
+namespace Vulkan {
+
+// Marks a vertex the algorithms have no use for, or the end of the fanning
+static constexpr u32	INVALID_VERTEX = std::numeric_limits<u32>::max();
+
+//----
+// Vertex cache
+//----
+
+// Tipsify's fallback when the candidates are exhausted, the most recent vertex with triangles left, or the next one in index order
+static u32 skip_dead_end(const std::vector<u32>& live_triangles, std::vector<u32>& dead_ends, u32& cursor)
+{
+	while (!dead_ends.empty()) {
+		u32 vertex = dead_ends.back();
+		dead_ends.pop_back();
+		if (live_triangles[vertex] > 0)
+			return vertex;
+	}
+	for (; cursor < live_triangles.size(); cursor++) {
+		if (live_triangles[cursor] > 0)
+			return cursor;
+	}
+	return INVALID_VERTEX;
+}
+
+void MeshOptimizer::optimize_vertex_cache(std::vector<u32> &indices, u32 vertex_count, u32 cache_size, std::vector<u32> *cluster_starts)
+{
+	const u32 triangle_count = static_cast<u32>(indices.size() / 3);
+	if (cluster_starts)
+		cluster_starts->clear();
+	if (triangle_count == 0)
+		return ;
+
+	// Triangles of every vertex, packed in a single array
+	std::vector<u32> live_triangles(vertex_count, 0);
+	for (u32 index : indices)
+		live_triangles[index]++;
+
+	std::vector<u32> adjacency_offsets(vertex_count + 1, 0);
+	for (u32 vertex = 0; vertex < vertex_count; vertex++)
+		adjacency_offsets[vertex + 1] = adjacency_offsets[vertex] + live_triangles[vertex];
+
+	std::vector<u32> adjacency(indices.size());
+	std::vector<u32> adjacency_cursors(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+	for (u32 triangle = 0; triangle < triangle_count; triangle++) {
+		for (u32 corner = 0; corner < 3; corner++)
+			adjacency[adjacency_cursors[indices[triangle * 3 + corner]]++] = triangle;
+	}
+
+	// A vertex is in the cache while fewer than cache_size vertices entered it after it
+	std::vector<u32> timestamps(vertex_count, 0);
+	u32 time = cache_size + 1;
+
+	std::vector<u8> emitted(triangle_count, 0);
+	std::vector<u32> dead_ends;
+	std::vector<u32> candidates;
+	std::vector<u32> output;
+	output.reserve(indices.size());
+	dead_ends.reserve(indices.size());
+
+	u32 cursor = 0;
+	u32 fanning = skip_dead_end(live_triangles, dead_ends, cursor);
+	if (cluster_starts)
+		cluster_starts->push_back(0);
+
+	while (fanning != INVALID_VERTEX) {
+		// Every triangle left around the fanning vertex, their vertices become the candidates for the next one
+		candidates.clear();
+		for (u32 i = adjacency_offsets[fanning]; i < adjacency_offsets[fanning + 1]; i++) {
+			u32 triangle = adjacency[i];
+			if (emitted[triangle])
+				continue ;
+
+			for (u32 corner = 0; corner < 3; corner++) {
+				u32 vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+				dead_ends.push_back(vertex);
+				candidates.push_back(vertex);
+				live_triangles[vertex]--;
+				if (time - timestamps[vertex] > cache_size)
+					timestamps[vertex] = time++;
+			}
+			emitted[triangle] = 1;
+		}
+
+		// The oldest candidate that will still be in the cache once its own triangles are emitted, any live one otherwise
+		u32 next = INVALID_VERTEX;
+		i64 best_priority = -1;
+		for (u32 vertex : candidates) {
+			if (live_triangles[vertex] == 0)
+				continue ;
+
+			i64 priority = 0;
+			if (time - timestamps[vertex] + 2 * live_triangles[vertex] <= cache_size)
+				priority = time - timestamps[vertex];
+			if (priority > best_priority) {
+				best_priority = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == INVALID_VERTEX) {
+			next = skip_dead_end(live_triangles, dead_ends, cursor);
+			if (next != INVALID_VERTEX && cluster_starts)
+				cluster_starts->push_back(static_cast<u32>(output.size() / 3));
+		}
+		fanning = next;
+	}
+
+	indices.swap(output);
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::analyze_vertex_cache(const std::vector<u32> &indices, u32 vertex_count, u32 cache_size)
+{
+	CacheStatistics statistics;
+	if (indices.empty())
+		return statistics;
+
+	std::vector<u32> timestamps(vertex_count, 0);
+	std::vector<u8> referenced(vertex_count, 0);
+	u32 time = cache_size + 1;
+	u64 misses = 0;
+	u32 referenced_count = 0;
+	for (u32 index : indices) {
+		if (time - timestamps[index] > cache_size) {
+			timestamps[index] = time++;
+			misses++;
+		}
+		if (!referenced[index]) {
+			referenced[index] = 1;
+			referenced_count++;
+		}
+	}
+
+	statistics.acmr = static_cast<f32>(static_cast<f64>(misses) / (indices.size() / 3));
+	statistics.atvr = static_cast<f32>(static_cast<f64>(misses) / referenced_count);
+	return statistics;
+}
+
+//----
+// Overdraw
+//----
+
+u32 MeshOptimizer::optimize_overdraw(std::vector<u32> &indices, const std::vector<Vertex> &vertices, const std::vector<u32> &cluster_starts,
+	u32 cache_size, f32 threshold)
+{
+	const u32 triangle_count = static_cast<u32>(indices.size() / 3);
+	if (triangle_count == 0)
+		return 0;
+
+	// Soft boundaries: once a cluster warmed the cache up to the ACMR of the whole mesh, it can end without raising it much
+	const f32 target_acmr = analyze_vertex_cache(indices, static_cast<u32>(vertices.size()), cache_size).acmr * threshold;
+	std::vector<u32> timestamps(vertices.size(), 0);
+	u32 time = cache_size + 1;
+
+	std::vector<u32> clusters;
+	for (u32 hard = 0; hard < cluster_starts.size(); hard++) {
+		u32 end = hard + 1 < cluster_starts.size() ? cluster_starts[hard + 1] : triangle_count;
+		u32 misses = 0;
+		u32 cluster_triangles = 0;
+		clusters.push_back(cluster_starts[hard]);
+		time += cache_size + 1;
+		for (u32 triangle = cluster_starts[hard]; triangle < end; triangle++) {
+			if (cluster_triangles > 0 && static_cast<f32>(misses) / cluster_triangles <= target_acmr) {
+				clusters.push_back(triangle);
+				misses = 0;
+				cluster_triangles = 0;
+				time += cache_size + 1;
+			}
+			for (u32 corner = 0; corner < 3; corner++) {
+				u32 vertex = indices[triangle * 3 + corner];
+				if (time - timestamps[vertex] > cache_size) {
+					timestamps[vertex] = time++;
+					misses++;
+				}
+			}
+			cluster_triangles++;
+		}
+	}
+
+	// Area-weighted centroid and normal of every cluster, the cross products are twice the areas
+	struct ClusterInfo
+	{
+		glm::vec3	centroid	= glm::vec3(0.0f);
+		glm::vec3	normal		= glm::vec3(0.0f);
+		f32			area		= 0.0f;
+		f32			sort_key	= 0.0f;
+	};
+
+	std::vector<ClusterInfo> infos(clusters.size());
+	glm::vec3 mesh_centroid(0.0f);
+	f32 mesh_area = 0.0f;
+	for (u32 cluster = 0; cluster < clusters.size(); cluster++) {
+		u32 end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+		ClusterInfo& info = infos[cluster];
+		for (u32 triangle = clusters[cluster]; triangle < end; triangle++) {
+			const glm::vec3& a = vertices[indices[triangle * 3 + 0]].pos;
+			const glm::vec3& b = vertices[indices[triangle * 3 + 1]].pos;
+			const glm::vec3& c = vertices[indices[triangle * 3 + 2]].pos;
+			glm::vec3 normal = glm::cross(b - a, c - a);
+			f32 area = glm::length(normal);
+			info.centroid += (a + b + c) * (area / 3.0f);
+			info.normal += normal;
+			info.area += area;
+		}
+		mesh_centroid += info.centroid;
+		mesh_area += info.area;
+	}
+	if (mesh_area > 0.0f)
+		mesh_centroid /= mesh_area;
+
+	// Clusters facing away from the center are the likeliest to hide the others, they go first
+	for (auto& info : infos) {
+		if (info.area > 0.0f)
+			info.centroid /= info.area;
+		f32 normal_length = glm::length(info.normal);
+		info.sort_key = normal_length > 0.0f ? glm::dot(info.centroid - mesh_centroid, info.normal / normal_length) : 0.0f;
+	}
+
+	std::vector<u32> order(clusters.size());
+	for (u32 i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&infos](u32 a, u32 b) { return infos[a].sort_key > infos[b].sort_key; });
+
+	std::vector<u32> output;
+	output.reserve(indices.size());
+	for (u32 cluster : order) {
+		u32 end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangle_count;
+		output.insert(output.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + end * 3);
+	}
+	indices.swap(output);
+	return static_cast<u32>(clusters.size());
+}
+
+//----
+// Vertex fetch
+//----
+
+u32 MeshOptimizer::optimize_vertex_fetch(std::vector<Vertex> &vertices, std::vector<u32> &indices)
+{
+	// Vertices are renumbered by first use, so the fetches walk the vertex buffer forward
+	std::vector<u32> remap(vertices.size(), INVALID_VERTEX);
+	std::vector<u32> order;
+	order.reserve(vertices.size());
+	for (u32& index : indices) {
+		if (remap[index] == INVALID_VERTEX) {
+			remap[index] = static_cast<u32>(order.size());
+			order.push_back(index);
+		}
+		index = remap[index];
+	}
+
+	std::vector<Vertex> reordered;
+	reordered.reserve(order.size());
+	for (u32 vertex : order)
+		reordered.push_back(vertices[vertex]);
+	vertices.swap(reordered);
+	return static_cast<u32>(vertices.size());
+}
+
+//----
+// Whole pipeline
+//----
+
+MeshOptimizer::Report MeshOptimizer::optimize(std::vector<Vertex> &vertices, std::vector<u32> &indices, u32 cache_size, bool reduce_overdraw)
+{
+	Report report;
+	f64 start = get_absolute_time();
+	const u32 vertex_count = static_cast<u32>(vertices.size());
+	report.triangle_count = static_cast<u32>(indices.size() / 3);
+	report.before = analyze_vertex_cache(indices, vertex_count, cache_size);
+
+	std::vector<u32> cluster_starts;
+	optimize_vertex_cache(indices, vertex_count, cache_size, &cluster_starts);
+	report.cluster_count = static_cast<u32>(cluster_starts.size());
+	if (reduce_overdraw)
+		report.cluster_count = optimize_overdraw(indices, vertices, cluster_starts, cache_size);
+
+	report.vertices_removed = vertex_count - optimize_vertex_fetch(vertices, indices);
+	report.time = get_absolute_time() - start;
+	report.after = analyze_vertex_cache(indices, static_cast<u32>(vertices.size()), cache_size);
+
+	CORE_DEBUG("Mesh optimized in %.2f ms: %u triangles, %u clusters, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u unused vertices removed",
+		report.time * 1000.0, report.triangle_count, report.cluster_count, report.before.acmr, report.after.acmr,
+		report.before.atvr, report.after.atvr, report.vertices_removed);
+	return report;
+}
+
+} // Vulkan
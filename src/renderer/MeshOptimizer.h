@@ -0,0 +1,63 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <vector>
+#include "defines.h"
+#include "Vertex.h"
+
+namespace Vulkan {
+
+// Reorders the triangles and vertices of a mesh before it is uploaded, the rendered result stays the same.
+// Triangles are reordered for the post-transform vertex cache with Tipsify, then by clusters against overdraw,
+// and vertices last, in the order the triangles first use them.
+class MeshOptimizer
+{
+public:		// Types
+	// Measured with a FIFO cache, lower is better for both
+	struct CacheStatistics
+	{
+		f32	acmr	= 0.0f;		// Average cache miss ratio, vertex shader invocations per triangle, between 0.5 and 3
+		f32	atvr	= 0.0f;		// Average transformed vertex ratio, vertex shader invocations per vertex, 1 at best
+	};
+
+	struct Report
+	{
+		CacheStatistics	before;
+		CacheStatistics	after;
+		u32				triangle_count		= 0;
+		u32				cluster_count		= 0;
+		u32				vertices_removed	= 0;
+		f64				time				= 0.0;	// In seconds
+	};
+
+	// Smallest post-transform cache among the GPUs we target
+	static constexpr u32	DEFAULT_CACHE_SIZE			= 16;
+	// A cluster may be split while its ACMR stays within this factor of the ACMR of the whole mesh
+	static constexpr f32	DEFAULT_OVERDRAW_THRESHOLD	= 1.05f;
+
+public:		// Methods
+	// Runs every stage, unreferenced vertices are dropped along the way
+	static Report			optimize(std::vector<Vertex>& vertices, std::vector<u32>& indices, u32 cache_size = DEFAULT_CACHE_SIZE,
+								bool reduce_overdraw = true);
+
+	// Tipsify, linear in the number of triangles. cluster_starts receives the first triangle of each run that
+	// begins with a cold cache, which optimize_overdraw() may move around without costing any vertex cache miss
+	static void				optimize_vertex_cache(std::vector<u32>& indices, u32 vertex_count, u32 cache_size = DEFAULT_CACHE_SIZE,
+								std::vector<u32> *cluster_starts = nullptr);
+	// Splits the clusters further while their ACMR stays under threshold times the one of the whole mesh, then sorts them
+	// so the ones facing away from the center of the mesh come first. Returns the number of clusters
+	static u32				optimize_overdraw(std::vector<u32>& indices, const std::vector<Vertex>& vertices, const std::vector<u32>& cluster_starts,
+								u32 cache_size = DEFAULT_CACHE_SIZE, f32 threshold = DEFAULT_OVERDRAW_THRESHOLD);
+	// Returns the number of vertices left
+	static u32				optimize_vertex_fetch(std::vector<Vertex>& vertices, std::vector<u32>& indices);
+
+	static CacheStatistics	analyze_vertex_cache(const std::vector<u32>& indices, u32 vertex_count, u32 cache_size = DEFAULT_CACHE_SIZE);
+};
+
+} // Vulkan
+
+#endif //MESHOPTIMIZER_H
@@ -0,0 +1,327 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "core/JobSystem.h"
+
+namespace Vulkan {
+
+// Passes over the edges before giving up on reaching the target
+static constexpr u32	MAX_PASSES = 64;
+// Share of the candidate collapses sorted each pass, the rest waits for the next one
+static constexpr u32	SORTED_FRACTION = 3;
+
+//----
+// Quadrics
+//----
+
+// Sum of squared distances to a set of planes, weighted by the area of the triangles they came from
+struct Quadric
+{
+	f64	a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+	f64	b0 = 0.0, b1 = 0.0, b2 = 0.0;
+	f64	c = 0.0;
+	f64	weight = 0.0;
+
+	void	add_plane(const glm::vec3& normal, f32 distance, f32 plane_weight)
+	{
+		a00 += plane_weight * normal.x * normal.x;
+		a01 += plane_weight * normal.x * normal.y;
+		a02 += plane_weight * normal.x * normal.z;
+		a11 += plane_weight * normal.y * normal.y;
+		a12 += plane_weight * normal.y * normal.z;
+		a22 += plane_weight * normal.z * normal.z;
+		b0 += plane_weight * normal.x * distance;
+		b1 += plane_weight * normal.y * distance;
+		b2 += plane_weight * normal.z * distance;
+		c += plane_weight * static_cast<f64>(distance) * distance;
+		weight += plane_weight;
+	}
+
+	void	add(const Quadric& other)
+	{
+		a00 += other.a00; a01 += other.a01; a02 += other.a02;
+		a11 += other.a11; a12 += other.a12; a22 += other.a22;
+		b0 += other.b0; b1 += other.b1; b2 += other.b2;
+		c += other.c;
+		weight += other.weight;
+	}
+
+	f64		evaluate(const glm::vec3& p) const
+	{
+		f64 x = p.x, y = p.y, z = p.z;
+		f64 result = a00 * x * x + a11 * y * y + a22 * z * z + 2.0 * (a01 * x * y + a02 * x * z + a12 * y * z)
+			+ 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		return std::max(result, 0.0);
+	}
+};
+
+// Mean squared distance if from is collapsed onto to
+static f64 collapse_cost(const std::vector<Quadric>& quadrics, const std::vector<Vertex>& vertices, u32 from, u32 to)
+{
+	const glm::vec3& position = vertices[to].pos;
+	f64 weight = quadrics[from].weight + quadrics[to].weight;
+	f64 error = quadrics[from].evaluate(position) + quadrics[to].evaluate(position);
+	return weight > 0.0 ? error / weight : error;
+}
+
+static u64 edge_key(u32 a, u32 b)
+{
+	return a < b ? (static_cast<u64>(a) << 32) | b : (static_cast<u64>(b) << 32) | a;
+}
+
+//----
+// Locked vertices
+//----
+
+static void lock_seams(const std::vector<Vertex>& vertices, std::vector<u8>& locked)
+{
+	// Sorted by position, vertices that share one end up next to each other
+	std::vector<u32> order(vertices.size());
+	for (u32 i = 0; i < order.size(); i++)
+		order[i] = i;
+	auto less = [&vertices](u32 a, u32 b) {
+		const glm::vec3& pa = vertices[a].pos;
+		const glm::vec3& pb = vertices[b].pos;
+		if (pa.x != pb.x)
+			return pa.x < pb.x;
+		if (pa.y != pb.y)
+			return pa.y < pb.y;
+		return pa.z < pb.z;
+	};
+	std::sort(order.begin(), order.end(), less);
+
+	for (u32 i = 1; i < order.size(); i++) {
+		if (vertices[order[i]].pos == vertices[order[i - 1]].pos) {
+			locked[order[i]] = 1;
+			locked[order[i - 1]] = 1;
+		}
+	}
+}
+
+static void lock_borders(const std::vector<u32>& indices, std::vector<u8>& locked)
+{
+	// An edge used by a single triangle is a border, by more than two a non-manifold edge, neither can be collapsed safely
+	std::vector<u64> edges;
+	edges.reserve(indices.size());
+	for (u32 triangle = 0; triangle < indices.size() / 3; triangle++) {
+		for (u32 corner = 0; corner < 3; corner++)
+			edges.push_back(edge_key(indices[triangle * 3 + corner], indices[triangle * 3 + (corner + 1) % 3]));
+	}
+	std::sort(edges.begin(), edges.end());
+
+	for (u32 i = 0; i < edges.size();) {
+		u32 run = 1;
+		while (i + run < edges.size() && edges[i + run] == edges[i])
+			run++;
+		if (run != 2) {
+			locked[edges[i] >> 32] = 1;
+			locked[edges[i] & 0xFFFFFFFF] = 1;
+		}
+		i += run;
+	}
+}
+
+//----
+// Simplification
+//----
+
+std::vector<u32> MeshSimplifier::simplify(const std::vector<Vertex> &vertices, const std::vector<u32> &indices, u32 target_index_count,
+	f32 max_error, f32 *result_error)
+{
+	const u32 vertex_count = static_cast<u32>(vertices.size());
+	std::vector<u32> result(indices);
+	if (result_error)
+		*result_error = 0.0f;
+	if (result.size() <= target_index_count)
+		return result;
+
+	std::vector<u8> locked(vertex_count, 0);
+	lock_seams(vertices, locked);
+	lock_borders(indices, locked);
+
+	std::vector<Quadric> quadrics(vertex_count);
+	for (u32 triangle = 0; triangle < indices.size() / 3; triangle++) {
+		const glm::vec3& a = vertices[indices[triangle * 3 + 0]].pos;
+		const glm::vec3& b = vertices[indices[triangle * 3 + 1]].pos;
+		const glm::vec3& c = vertices[indices[triangle * 3 + 2]].pos;
+		glm::vec3 normal = glm::cross(b - a, c - a);
+		f32 double_area = glm::length(normal);
+		if (double_area <= 0.0f)
+			continue ;
+
+		normal /= double_area;
+		for (u32 corner = 0; corner < 3; corner++)
+			quadrics[indices[triangle * 3 + corner]].add_plane(normal, -glm::dot(normal, a), double_area * 0.5f);
+	}
+
+	struct Collapse
+	{
+		u32	from;
+		u32	to;
+		f64	cost;
+	};
+
+	const f64 max_cost = static_cast<f64>(max_error) * max_error;
+	f64 applied_cost = 0.0;
+	std::vector<u32> collapse_target(vertex_count);
+	for (u32 i = 0; i < vertex_count; i++)
+		collapse_target[i] = i;
+	std::vector<u8> touched(vertex_count, 0);
+	std::vector<u32> adjacency_offsets(vertex_count + 1);
+	std::vector<u32> adjacency;
+	// Last lower vertex an edge was found from, so edges shared by two triangles are only seen once
+	std::vector<u32> edge_stamps(vertex_count);
+	std::vector<Collapse> collapses;
+
+	for (u32 pass = 0; pass < MAX_PASSES && result.size() > target_index_count; pass++) {
+		const u32 triangle_count = static_cast<u32>(result.size() / 3);
+
+		// Triangles around every vertex, rebuilt each pass since the previous one changed them
+		std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+		for (u32 index : result)
+			adjacency_offsets[index + 1]++;
+		for (u32 vertex = 0; vertex < vertex_count; vertex++)
+			adjacency_offsets[vertex + 1] += adjacency_offsets[vertex];
+		adjacency.resize(result.size());
+		{
+			std::vector<u32> cursors(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (u32 triangle = 0; triangle < triangle_count; triangle++) {
+				for (u32 corner = 0; corner < 3; corner++)
+					adjacency[cursors[result[triangle * 3 + corner]]++] = triangle;
+			}
+		}
+
+		// Every edge once, found around its lower vertex and collapsed in the cheaper of its two directions
+		collapses.clear();
+		std::fill(edge_stamps.begin(), edge_stamps.end(), 0);
+		for (u32 a = 0; a < vertex_count; a++) {
+			for (u32 i = adjacency_offsets[a]; i < adjacency_offsets[a + 1]; i++) {
+				for (u32 corner = 0; corner < 3; corner++) {
+					u32 b = result[adjacency[i] * 3 + corner];
+					if (b <= a || edge_stamps[b] == a + 1 || (locked[a] && locked[b]))
+						continue ;
+					edge_stamps[b] = a + 1;
+
+					f64 cost_ab = locked[a] ? std::numeric_limits<f64>::max() : collapse_cost(quadrics, vertices, a, b);
+					f64 cost_ba = locked[b] ? std::numeric_limits<f64>::max() : collapse_cost(quadrics, vertices, b, a);
+					if (cost_ab <= cost_ba)
+						collapses.push_back({a, b, cost_ab});
+					else
+						collapses.push_back({b, a, cost_ba});
+				}
+			}
+		}
+
+		// A collapse freezes about seven vertices, so a pass can't use more than a third of the candidates: only those get sorted
+		auto cheaper = [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; };
+		auto sorted_end = collapses.begin() + std::min<size_t>(collapses.size(), collapses.size() / SORTED_FRACTION + 1);
+		std::nth_element(collapses.begin(), sorted_end - 1, collapses.end(), cheaper);
+		std::sort(collapses.begin(), sorted_end, cheaper);
+		collapses.erase(sorted_end, collapses.end());
+
+		// Cheapest first. It freezes every vertex around it until the next pass, so the triangles it checked stay valid
+		const u32 triangles_to_remove = triangle_count - target_index_count / 3;
+		u32 triangles_removed = 0;
+		u32 collapse_count = 0;
+		std::fill(touched.begin(), touched.end(), 0);
+		for (const Collapse& collapse : collapses) {
+			if (collapse.cost > max_cost || triangles_removed >= triangles_to_remove)
+				break ;
+			if (touched[collapse.from] || touched[collapse.to])
+				continue ;
+
+			// Triangles that would flip once the vertex moves are a fold in the surface, the collapse is skipped
+			const glm::vec3& destination = vertices[collapse.to].pos;
+			u32 removed = 0;
+			bool flips = false;
+			for (u32 i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1] && !flips; i++) {
+				const u32 *triangle = &result[adjacency[i] * 3];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) {
+					removed++;
+					continue ;
+				}
+
+				glm::vec3 p[3];
+				glm::vec3 q[3];
+				for (u32 corner = 0; corner < 3; corner++) {
+					p[corner] = vertices[triangle[corner]].pos;
+					q[corner] = triangle[corner] == collapse.from ? destination : p[corner];
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				flips = glm::dot(before, after) <= 0.0f;
+			}
+			if (flips)
+				continue ;
+
+			collapse_target[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			for (u32 i = adjacency_offsets[collapse.from]; i < adjacency_offsets[collapse.from + 1]; i++) {
+				for (u32 corner = 0; corner < 3; corner++)
+					touched[result[adjacency[i] * 3 + corner]] = 1;
+			}
+			touched[collapse.to] = 1;
+
+			applied_cost = std::max(applied_cost, collapse.cost);
+			triangles_removed += removed;
+			collapse_count++;
+		}
+		if (collapse_count == 0)
+			break ;
+
+		// A target is never collapsed in the same pass, one lookup is enough
+		u32 kept = 0;
+		for (u32 triangle = 0; triangle < triangle_count; triangle++) {
+			u32 a = collapse_target[result[triangle * 3 + 0]];
+			u32 b = collapse_target[result[triangle * 3 + 1]];
+			u32 c = collapse_target[result[triangle * 3 + 2]];
+			if (a == b || b == c || a == c)
+				continue ;
+			result[kept * 3 + 0] = a;
+			result[kept * 3 + 1] = b;
+			result[kept * 3 + 2] = c;
+			kept++;
+		}
+		result.resize(kept * 3);
+		for (u32 i = 0; i < vertex_count; i++)
+			collapse_target[i] = i;
+	}
+
+	if (result_error)
+		*result_error = static_cast<f32>(std::sqrt(applied_cost));
+	return result;
+}
+
+std::vector<MeshSimplifier::LodIndices> MeshSimplifier::build_lods(const std::vector<Vertex> &vertices, const std::vector<u32> &indices,
+	u32 lod_count, f32 reduction)
+{
+	std::vector<LodIndices> lods(std::max(lod_count, 1u));
+	lods[0].indices = indices;
+
+	// Every level starts from the full mesh, they don't depend on each other
+	JobSystem::parallel_for(static_cast<u32>(lods.size()) - 1, 1, [&](u32 first, u32 last) {
+		for (u32 level = first + 1; level <= last; level++) {
+			u32 target_triangles = static_cast<u32>(indices.size() / 3 * std::pow(reduction, static_cast<f32>(level)));
+			lods[level].indices = simplify(vertices, indices, target_triangles * 3, std::numeric_limits<f32>::max(), &lods[level].error);
+		}
+	});
+
+	// A level stuck at the size of the previous one would only cost memory
+	std::vector<LodIndices> kept;
+	kept.push_back(std::move(lods[0]));
+	for (u32 level = 1; level < lods.size(); level++) {
+		const LodIndices& previous = kept.back();
+		if (lods[level].indices.empty() || lods[level].indices.size() >= previous.indices.size())
+			continue ;
+		lods[level].error = std::max(lods[level].error, previous.error);
+		kept.push_back(std::move(lods[level]));
+	}
+	return kept;
+}
+
+} // Vulkan
@@ -0,0 +1,40 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <vector>
+#include "defines.h"
+#include "Vertex.h"
+
+namespace Vulkan {
+
+// Quadric error metric simplification by edge collapse. Vertices are collapsed onto one of their neighbours and never
+// moved or created, so every level of detail indexes the vertex buffer of the original mesh.
+class MeshSimplifier
+{
+public:		// Types
+	struct LodIndices
+	{
+		std::vector<u32>	indices;
+		// Root mean squared distance to the planes of the original surface, in model space
+		f32					error	= 0.0f;
+	};
+
+public:		// Methods
+	// Stops at target_index_count or before the first collapse above max_error. Border vertices, and vertices sharing
+	// their position with another one, are never collapsed: the silhouette of open meshes and color seams stay intact.
+	static std::vector<u32>			simplify(const std::vector<Vertex>& vertices, const std::vector<u32>& indices, u32 target_index_count,
+										f32 max_error, f32 *result_error = nullptr);
+
+	// Level 0 is indices itself, every next level targets reduction times the triangles of the previous one.
+	// The levels are built from the full mesh in parallel on the JobSystem, those that don't get any smaller are dropped.
+	static std::vector<LodIndices>	build_lods(const std::vector<Vertex>& vertices, const std::vector<u32>& indices, u32 lod_count,
+										f32 reduction = 0.5f);
+};
+
+} // Vulkan
+
+#endif //MESHSIMPLIFIER_H
@@ -0,0 +1,114 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "Meshlet.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Vulkan {
+
+// Below this, the normals of a meshlet spread over more than a half-space minus a margin and its cone can't cull anything
+static constexpr f32	MIN_CONE_SPREAD = 0.1f;
+
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex> &vertices, const std::vector<u32> &indices, u32 max_vertices,
+	u32 max_triangles)
+{
+	std::vector<Meshlet> meshlets;
+	if (indices.empty())
+		return meshlets;
+
+	// Meshlet that last used each vertex, plus one, so nothing needs clearing between meshlets
+	std::vector<u32> stamps(vertices.size(), 0);
+	u32 stamp = 1;
+
+	Meshlet current;
+	for (u32 triangle = 0; triangle < indices.size() / 3; triangle++) {
+		const u32 *corners = &indices[triangle * 3];
+		u32 new_vertices = 0;
+		for (u32 corner = 0; corner < 3; corner++) {
+			bool repeated = corner > 0 && corners[corner] == corners[0];
+			repeated |= corner > 1 && corners[corner] == corners[1];
+			if (stamps[corners[corner]] != stamp && !repeated)
+				new_vertices++;
+		}
+
+		if (current.vertex_count + new_vertices > max_vertices || current.triangle_count + 1 > max_triangles) {
+			compute_bounds(current, vertices, indices);
+			meshlets.push_back(current);
+			current = Meshlet{};
+			current.first_index = triangle * 3;
+			stamp++;
+			new_vertices = 0;
+			for (u32 corner = 0; corner < 3; corner++) {
+				if (stamps[corners[corner]] != stamp) {
+					stamps[corners[corner]] = stamp;
+					new_vertices++;
+				}
+			}
+		} else {
+			for (u32 corner = 0; corner < 3; corner++)
+				stamps[corners[corner]] = stamp;
+		}
+		current.vertex_count += new_vertices;
+		current.triangle_count++;
+	}
+	compute_bounds(current, vertices, indices);
+	meshlets.push_back(current);
+	return meshlets;
+}
+
+void MeshletBuilder::compute_bounds(Meshlet &meshlet, const std::vector<Vertex> &vertices, const std::vector<u32> &indices)
+{
+	const u32 first = meshlet.first_index;
+	const u32 last = meshlet.first_index + meshlet.triangle_count * 3;
+
+	// Sphere centered on the bounding box, like the one of the whole mesh
+	glm::vec3 min = vertices[indices[first]].pos;
+	glm::vec3 max = min;
+	for (u32 i = first; i < last; i++) {
+		min = glm::min(min, vertices[indices[i]].pos);
+		max = glm::max(max, vertices[indices[i]].pos);
+	}
+	glm::vec3 center = (min + max) * 0.5f;
+	f32 radius_squared = 0.0f;
+	for (u32 i = first; i < last; i++)
+		radius_squared = std::max(radius_squared, glm::dot(vertices[indices[i]].pos - center, vertices[indices[i]].pos - center));
+	meshlet.bounding_sphere = glm::vec4(center, std::sqrt(radius_squared));
+
+	// Counter-clockwise triangles are front facing, their normals point towards the viewer
+	glm::vec3 axis(0.0f);
+	for (u32 i = first; i < last; i += 3) {
+		const glm::vec3& a = vertices[indices[i]].pos;
+		glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - a, vertices[indices[i + 2]].pos - a);
+		f32 length = glm::length(normal);
+		if (length > 0.0f)
+			axis += normal / length;
+	}
+	f32 axis_length = glm::length(axis);
+	meshlet.cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+	if (axis_length <= 0.0f)
+		return ;
+	axis /= axis_length;
+
+	f32 min_dot = 1.0f;
+	for (u32 i = first; i < last; i += 3) {
+		const glm::vec3& a = vertices[indices[i]].pos;
+		glm::vec3 normal = glm::cross(vertices[indices[i + 1]].pos - a, vertices[indices[i + 2]].pos - a);
+		f32 length = glm::length(normal);
+		if (length > 0.0f)
+			min_dot = std::min(min_dot, glm::dot(normal / length, axis));
+	}
+	if (min_dot <= MIN_CONE_SPREAD)
+		return ;
+	meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - min_dot * min_dot));
+}
+
+bool MeshletBuilder::is_backfacing(const Meshlet &meshlet, const glm::vec3 &camera_position)
+{
+	// Conservative over the whole bounding sphere, the camera has to be behind every triangle wherever they are in it
+	glm::vec3 to_center = glm::vec3(meshlet.bounding_sphere) - camera_position;
+	return glm::dot(to_center, glm::vec3(meshlet.cone)) >= meshlet.cone.w * glm::length(to_center) + meshlet.bounding_sphere.w;
+}
+
+} // Vulkan
@@ -0,0 +1,50 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+#include "defines.h"
+#include "glm/glm.hpp"
+#include "Vertex.h"
+
+namespace Vulkan {
+
+// A run of consecutive triangles of an index buffer, small enough to be culled on its own.
+// Mirrors MeshletData in cull.comp.glsl, std430 layout.
+struct Meshlet
+{
+	u32			first_index		= 0;
+	u32			triangle_count	= 0;
+	u32			vertex_count	= 0;
+	u32			padding			= 0;
+	// Model space, center in xyz and radius in w
+	glm::vec4	bounding_sphere	= glm::vec4(0.0f);
+	// Average normal in xyz, sine of the widest angle between it and a triangle normal in w. 1 when the cone is too wide to cull
+	glm::vec4	cone			= glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+};
+
+class MeshletBuilder
+{
+public:
+	// The limits of a mesh shader workgroup, so the same clusters can feed one later
+	static constexpr u32	MAX_VERTICES	= 64;
+	static constexpr u32	MAX_TRIANGLES	= 124;
+
+	// Cuts the triangles in order, a meshlet ends when the next triangle would exceed a limit.
+	// The index buffer is left as is: run MeshOptimizer first and consecutive triangles share most of their vertices
+	static std::vector<Meshlet>	build(const std::vector<Vertex>& vertices, const std::vector<u32>& indices,
+									u32 max_vertices = MAX_VERTICES, u32 max_triangles = MAX_TRIANGLES);
+
+	// The test cull.comp.glsl runs, in model space: true when every triangle of the meshlet faces away from the camera
+	static bool					is_backfacing(const Meshlet& meshlet, const glm::vec3& camera_position);
+
+private:	// Methods
+	static void					compute_bounds(Meshlet& meshlet, const std::vector<Vertex>& vertices, const std::vector<u32>& indices);
+};
+
+} // Vulkan
+
+#endif //MESHLET_H
@@ -0,0 +1,186 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include "ParallelRecorder.h"
+#include "vulkan/VulkanInstance.h"
+#include "vulkan/vulkan_errors.h"
+#include "core/Profiler.h"
+#include "log.h"
+
+namespace Vulkan {
+
+// Below this many items per worker, waking one up costs more than it records
+static constexpr u32	MIN_ITEMS_PER_SLICE = 64;
+
+ParallelRecorder::~ParallelRecorder()
+{
+	shutdown();
+}
+
+bool ParallelRecorder::initialize(u32 worker_count, u32 frames_in_flight)
+{
+	_workers.resize(worker_count);
+	for (auto& worker : _workers) {
+		if (!create_command_buffers(worker, frames_in_flight))
+			return false;
+	}
+
+	_stopping = false;
+	for (u32 i = 0; i < worker_count; i++)
+		_workers[i].thread = std::thread(&ParallelRecorder::worker_main, this, i);
+
+	CORE_TRACE("ParallelRecorder started %u workers", worker_count);
+	return true;
+}
+
+void ParallelRecorder::shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_start_condition.notify_all();
+
+	// Command buffers are implicitly freed with their pool
+	for (auto& worker : _workers) {
+		if (worker.thread.joinable())
+			worker.thread.join();
+		for (auto pool : worker.command_pools)
+			vkDestroyCommandPool(VulkanInstance::logical_device(), pool, nullptr);
+	}
+	_workers.clear();
+}
+
+std::vector<VkCommandBuffer> ParallelRecorder::record(u32 frame_index, const VkCommandBufferInheritanceInfo &inheritance,
+	u32 item_count, const RecordFunction &record)
+{
+	std::vector<VkCommandBuffer> command_buffers;
+	if (_workers.empty())
+		return command_buffers;
+
+	u32 slice_count = (item_count + MIN_ITEMS_PER_SLICE - 1) / MIN_ITEMS_PER_SLICE;
+	slice_count = std::clamp(slice_count, 1u, worker_count());
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_job.frame_index = frame_index;
+		_job.inheritance = &inheritance;
+		_job.record = &record;
+		_job.item_count = item_count;
+		_job.slice_count = slice_count;
+		_pending = worker_count();
+		_generation++;
+	}
+	_start_condition.notify_all();
+
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_done_condition.wait(lock, [this] { return _pending == 0; });
+	}
+
+	for (u32 i = 0; i < slice_count; i++) {
+		if (_workers[i].recorded)
+			command_buffers.push_back(_workers[i].command_buffers[frame_index]);
+	}
+	return command_buffers;
+}
+
+bool ParallelRecorder::create_command_buffers(Worker &worker, u32 frames_in_flight)
+{
+	QueueFamilyIndices queue_indices = VulkanInstance::get_queues_for_device(VulkanInstance::physical_device());
+
+	// Pools are reset as a whole once their frame is done, their buffers are never reset one by one
+	VkCommandPoolCreateInfo pool_create_infos{};
+	pool_create_infos.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_infos.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_infos.queueFamilyIndex = queue_indices.graphics_index.value();
+
+	worker.command_pools.resize(frames_in_flight, VK_NULL_HANDLE);
+	worker.command_buffers.resize(frames_in_flight, VK_NULL_HANDLE);
+	for (u32 frame = 0; frame < frames_in_flight; frame++) {
+		VkResult result = vkCreateCommandPool(VulkanInstance::logical_device(), &pool_create_infos, nullptr, &worker.command_pools[frame]);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create ParallelRecorder's command pool: %s", vulkan_error_to_string(result));
+			return false;
+		}
+
+		VkCommandBufferAllocateInfo alloc_infos{};
+		alloc_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		alloc_infos.commandPool = worker.command_pools[frame];
+		alloc_infos.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		alloc_infos.commandBufferCount = 1;
+
+		result = vkAllocateCommandBuffers(VulkanInstance::logical_device(), &alloc_infos, &worker.command_buffers[frame]);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't allocate ParallelRecorder's command buffers: %s", vulkan_error_to_string(result));
+			return false;
+		}
+	}
+	return true;
+}
+
+void ParallelRecorder::worker_main(u32 worker_index)
+{
+	PROFILE_THREAD_NAME("Recorder " + std::to_string(worker_index));
+	u64 last_generation = 0;
+	while (true) {
+		std::unique_lock<std::mutex> lock(_mutex);
+		_start_condition.wait(lock, [this, last_generation] { return _stopping || _generation != last_generation; });
+		if (_stopping)
+			return ;
+		last_generation = _generation;
+		Job job = _job;
+		lock.unlock();
+
+		_workers[worker_index].recorded = false;
+		if (worker_index < job.slice_count)
+			record_slice(worker_index, job);
+
+		lock.lock();
+		if (--_pending == 0)
+			_done_condition.notify_one();
+	}
+}
+
+void ParallelRecorder::record_slice(u32 worker_index, const Job &job)
+{
+	PROFILE_SCOPE("ParallelRecorder::record_slice");
+	Worker& worker = _workers[worker_index];
+	VkCommandBuffer command_buffer = worker.command_buffers[job.frame_index];
+
+	// The caller waited on the frame's fence, nothing from this pool is still executing
+	VkResult result = vkResetCommandPool(VulkanInstance::logical_device(), worker.command_pools[job.frame_index], 0);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't reset ParallelRecorder's command pool: %s", vulkan_error_to_string(result));
+		return ;
+	}
+
+	VkCommandBufferBeginInfo begin_infos{};
+	begin_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_infos.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	begin_infos.pInheritanceInfo = job.inheritance;
+
+	result = vkBeginCommandBuffer(command_buffer, &begin_infos);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't begin ParallelRecorder's command buffer: %s", vulkan_error_to_string(result));
+		return ;
+	}
+
+	// Even split, the first slices take one more item when it doesn't divide evenly
+	u32 base_count = job.item_count / job.slice_count;
+	u32 remainder = job.item_count % job.slice_count;
+	u32 first = worker_index * base_count + std::min(worker_index, remainder);
+	u32 count = base_count + (worker_index < remainder ? 1 : 0);
+	(*job.record)(command_buffer, first, count);
+
+	result = vkEndCommandBuffer(command_buffer);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't end ParallelRecorder's command buffer: %s", vulkan_error_to_string(result));
+		return ;
+	}
+	worker.recorded = true;
+}
+
+} // Vulkan
@@ -0,0 +1,91 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef PARALLELRECORDER_H
+#define PARALLELRECORDER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "defines.h"
+
+namespace Vulkan {
+
+// Worker threads recording slices of a frame into secondary command buffers.
+// Every worker owns a command pool per frame in flight, so no pool is ever touched by two threads.
+class ParallelRecorder
+{
+public:		// Types
+	// Records items [first, first + count) into command_buffer, which is already begun inside the render pass
+	using RecordFunction = std::function<void(VkCommandBuffer command_buffer, u32 first, u32 count)>;
+
+public:
+	ParallelRecorder() = default;
+	ParallelRecorder(const ParallelRecorder& other) = delete;
+	~ParallelRecorder();
+
+	ParallelRecorder& operator=(const ParallelRecorder& other) = delete;
+
+	//----
+	// Initialization
+	//----
+	bool	initialize(u32 worker_count, u32 frames_in_flight);
+	void	shutdown();
+
+	//----
+	// Recording
+	//----
+	// Splits item_count items across the workers and blocks until they are recorded.
+	// The last slice is always recorded, even when empty, so record can append to the end of the frame.
+	// Returns the secondary command buffers to execute, in item order.
+	std::vector<VkCommandBuffer>	record(u32 frame_index, const VkCommandBufferInheritanceInfo& inheritance, u32 item_count,
+										const RecordFunction& record);
+
+	//----
+	// Getters
+	//----
+	u32		worker_count()	const	{ return static_cast<u32>(_workers.size()); }
+
+private:	// Types
+	struct Worker
+	{
+		std::thread						thread;
+		std::vector<VkCommandPool>		command_pools;		// One per frame in flight
+		std::vector<VkCommandBuffer>	command_buffers;	// Allocated from the pool of the same frame
+		bool							recorded = false;
+	};
+
+	// What the workers are asked to do, written under _mutex before waking them up
+	struct Job
+	{
+		u32										frame_index		= 0;
+		const VkCommandBufferInheritanceInfo	*inheritance	= nullptr;
+		const RecordFunction					*record			= nullptr;
+		u32										item_count		= 0;
+		u32										slice_count		= 0;
+	};
+
+private:	// Methods
+	bool	create_command_buffers(Worker& worker, u32 frames_in_flight);
+	void	worker_main(u32 worker_index);
+	void	record_slice(u32 worker_index, const Job& job);
+
+private:	// Members
+	std::vector<Worker>		_workers;
+
+	std::mutex				_mutex;
+	std::condition_variable	_start_condition;
+	std::condition_variable	_done_condition;
+	Job						_job;
+	u64						_generation		= 0;
+	u32						_pending		= 0;
+	bool					_stopping		= false;
+};
+
+} // Vulkan
+
+#endif //PARALLELRECORDER_H
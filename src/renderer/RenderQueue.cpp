@@ -0,0 +1,186 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <cstring>
+#include "RenderQueue.h"
+
+namespace Vulkan {
+
+u64 RenderQueue::make_key(u32 pipeline, u32 mesh_slot, f32 depth)
+{
+	// The bits of a positive float sort like the float itself, anything behind the camera is clamped to 0
+	u32 depth_bits = 0;
+	if (depth > 0.0f)
+		memcpy(&depth_bits, &depth, sizeof(depth_bits));
+
+	u64 key = static_cast<u64>(pipeline & ((1u << PIPELINE_BITS) - 1)) << (MESH_BITS + DEPTH_BITS);
+	key |= static_cast<u64>(mesh_slot & ((1u << MESH_BITS) - 1)) << DEPTH_BITS;
+	key |= depth_bits;
+	return key;
+}
+
+void RenderQueue::clear()
+{
+	_packets.clear();
+	_transforms.clear();
+	_culler.clear();
+	_meshes.clear();
+	_mesh_slots.clear();
+	_batches.clear();
+	_sorted_transforms.clear();
+	_statistics = Statistics{};
+}
+
+void RenderQueue::push(u32 pipeline, u32 mesh_id, u32 lod, const MeshBinding &mesh, const glm::mat4 *transforms, u32 count)
+{
+	if (count == 0)
+		return ;
+
+	// The first transform stands for the whole packet when sorting by depth
+	const glm::vec4 view_position = _view * transforms[0][3];
+
+	// Slots are handed out densely every frame, they fit the key where the ids themselves wouldn't
+	DrawPacket packet;
+	packet.mesh_slot = get_mesh_slot(mesh_id, lod, mesh);
+	packet.key = make_key(pipeline, packet.mesh_slot, -view_position.z);
+	packet.first_transform = static_cast<u32>(_transforms.size());
+	packet.transform_count = count;
+	_packets.push_back(packet);
+
+	_transforms.insert(_transforms.end(), transforms, transforms + count);
+
+	// The culler indexes its spheres like _transforms
+	for (u32 i = 0; i < count; i++)
+		_culler.add(mesh.bounding_sphere, transforms[i]);
+}
+
+void RenderQueue::cull(const Frustum &frustum)
+{
+	const u32 tested = _culler.size();
+	const u32 visible = _culler.cull(frustum);
+	_statistics.instances_tested = tested;
+	_statistics.instances_culled = tested - visible;
+	if (visible == tested)
+		return ;
+
+	// Compacted in place, a packet's transforms can only move towards the front
+	const std::vector<u8>& visibility = _culler.visibility();
+	u32 transform_count = 0;
+	u32 packet_count = 0;
+	for (const auto& packet : _packets) {
+		const u32 first_visible = transform_count;
+		for (u32 i = packet.first_transform; i < packet.first_transform + packet.transform_count; i++) {
+			if (visibility[i])
+				_transforms[transform_count++] = _transforms[i];
+		}
+		if (transform_count == first_visible)
+			continue;
+
+		DrawPacket& kept = _packets[packet_count++];
+		kept = packet;
+		kept.first_transform = first_visible;
+		kept.transform_count = transform_count - first_visible;
+	}
+	_packets.resize(packet_count);
+	_transforms.resize(transform_count);
+	_culler.clear();
+}
+
+void RenderQueue::sort_and_merge()
+{
+	_batches.clear();
+	_sorted_transforms.clear();
+	_sorted_transforms.reserve(_transforms.size());
+
+	radix_sort();
+
+	const u64 batch_mask = ~((static_cast<u64>(1) << DEPTH_BITS) - 1);
+	VkBuffer bound_vertex_buffer = VK_NULL_HANDLE;
+	VkBuffer bound_index_buffer = VK_NULL_HANDLE;
+	for (u32 i = 0; i < _packets.size(); i++) {
+		const DrawPacket& packet = _packets[i];
+
+		// Packets that only differ by their depth draw the same mesh with the same pipeline, the slot itself is compared
+		// in case a frame ever had more meshes than the key has room for
+		if (i == 0 || (packet.key & batch_mask) != (_packets[i - 1].key & batch_mask)
+			|| packet.mesh_slot != _packets[i - 1].mesh_slot) {
+			DrawBatch batch;
+			batch.pipeline = static_cast<u32>(packet.key >> (MESH_BITS + DEPTH_BITS));
+			batch.mesh_slot = packet.mesh_slot;
+			batch.first_instance = static_cast<u32>(_sorted_transforms.size());
+			_batches.push_back(batch);
+
+			// Same test as the recording, slots sharing their buffers are drawn without binding anything
+			const MeshBinding& mesh = _meshes[packet.mesh_slot];
+			if (mesh.vertex_buffer != bound_vertex_buffer || mesh.index_buffer != bound_index_buffer) {
+				bound_vertex_buffer = mesh.vertex_buffer;
+				bound_index_buffer = mesh.index_buffer;
+				_statistics.bind_count++;
+			}
+		}
+
+		_sorted_transforms.insert(_sorted_transforms.end(), _transforms.begin() + packet.first_transform,
+			_transforms.begin() + packet.first_transform + packet.transform_count);
+		_batches.back().instance_count += packet.transform_count;
+	}
+
+	_statistics.packet_count = static_cast<u32>(_packets.size());
+	_statistics.draw_count = static_cast<u32>(_batches.size());
+	_statistics.draws_eliminated = _statistics.packet_count - _statistics.draw_count;
+	_statistics.binds_eliminated = _statistics.packet_count - _statistics.bind_count;
+}
+
+u32 RenderQueue::get_mesh_slot(u32 mesh_id, u32 lod, const MeshBinding &mesh)
+{
+	const u64 mesh_key = (static_cast<u64>(mesh_id) << 32) | lod;
+	auto it = _mesh_slots.find(mesh_key);
+	if (it != _mesh_slots.end())
+		return it->second;
+
+	u32 slot = static_cast<u32>(_meshes.size());
+	_meshes.push_back(mesh);
+	_mesh_slots.emplace(mesh_key, slot);
+	return slot;
+}
+
+void RenderQueue::radix_sort()
+{
+	// LSD radix sort, one byte of the key per pass
+	constexpr u32 RADIX_BITS = 8;
+	constexpr u32 BUCKET_COUNT = 1 << RADIX_BITS;
+	constexpr u32 PASS_COUNT = 64 / RADIX_BITS;
+
+	const size_t count = _packets.size();
+	if (count < 2)
+		return ;
+
+	// All the histograms are built in a single pass over the keys
+	u32 histograms[PASS_COUNT][BUCKET_COUNT] = {};
+	for (const auto& packet : _packets)
+		for (u32 pass = 0; pass < PASS_COUNT; pass++)
+			histograms[pass][(packet.key >> (pass * RADIX_BITS)) & (BUCKET_COUNT - 1)]++;
+
+	_sort_scratch.resize(count);
+	for (u32 pass = 0; pass < PASS_COUNT; pass++) {
+		u32 *histogram = histograms[pass];
+		const u32 shift = pass * RADIX_BITS;
+
+		// Every key has the same byte here, this pass wouldn't move anything
+		if (histogram[(_packets[0].key >> shift) & (BUCKET_COUNT - 1)] == count)
+			continue;
+
+		u32 offset = 0;
+		for (u32 bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+			u32 bucket_size = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucket_size;
+		}
+
+		for (const auto& packet : _packets)
+			_sort_scratch[histogram[(packet.key >> shift) & (BUCKET_COUNT - 1)]++] = packet;
+		_packets.swap(_sort_scratch);
+	}
+}
+
+} // Vulkan
@@ -0,0 +1,127 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <unordered_map>
+#include "defines.h"
+#include "glm/glm.hpp"
+#include "FrustumCuller.h"
+#include "Vertex.h"
+
+namespace Vulkan {
+
+// Collects the draws of a frame so they can be sorted and merged before anything is recorded
+class RenderQueue
+{
+public:		// Types
+	// What has to be bound to draw a mesh
+	struct MeshBinding
+	{
+		VkBuffer	vertex_buffer	= VK_NULL_HANDLE;
+		VkBuffer	index_buffer	= VK_NULL_HANDLE;
+		u32			first_index		= 0;
+		u32			index_count		= 0;
+		VkIndexType	index_type		= VK_INDEX_TYPE_UINT32;
+		// Triangles the full detail level has on top of this one, per instance
+		u32			triangles_saved	= 0;
+		// Pushed before drawing a quantized mesh
+		VertexDequantization	dequantization;
+		// In model space, center in xyz and radius in w
+		glm::vec4	bounding_sphere	= glm::vec4(0.0f);
+	};
+
+	// Consecutive instances of the same mesh, drawn with a single call
+	struct DrawBatch
+	{
+		u32		pipeline		= 0;
+		u32		mesh_slot		= 0;
+		u32		first_instance	= 0;
+		u32		instance_count	= 0;
+	};
+
+	struct Statistics
+	{
+		u32	packet_count		= 0;
+		u32	draw_count			= 0;
+		u32	bind_count			= 0;
+
+		// Compared to recording every packet as it came, with its own binds and draw
+		u32	draws_eliminated	= 0;
+		u32	binds_eliminated	= 0;
+
+		// Filled by cull()
+		u32	instances_tested	= 0;
+		u32	instances_culled	= 0;
+	};
+
+public:
+	RenderQueue() = default;
+
+	// Bits of the sort key, most significant first: pipeline, mesh slot, depth
+	static constexpr u32	PIPELINE_BITS	= 8;
+	static constexpr u32	MESH_BITS		= 24;
+	static constexpr u32	DEPTH_BITS		= 32;
+
+	static u64	make_key(u32 pipeline, u32 mesh_slot, f32 depth);
+
+	//----
+	// Recording
+	//----
+	void	clear();
+	void	set_view(const glm::mat4& view)	{ _view = view; }
+	// Each level of detail of a mesh is a mesh of its own
+	void	push(u32 pipeline, u32 mesh_id, u32 lod, const MeshBinding& mesh, const glm::mat4 *transforms, u32 count);
+
+	// Drops the instances outside the frustum, and the packets left without any
+	void	cull(const Frustum& frustum);
+
+	// Sorts the packets and builds the batches, the transforms are reordered to match
+	void	sort_and_merge();
+
+	//----
+	// Getters
+	//----
+	bool									empty()				const	{ return _packets.empty(); }
+	const std::vector<DrawBatch>&			batches()			const	{ return _batches; }
+	const std::vector<glm::mat4>&			sorted_transforms()	const	{ return _sorted_transforms; }
+	const MeshBinding&						mesh(u32 slot)		const	{ return _meshes[slot]; }
+	const Statistics&						statistics()		const	{ return _statistics; }
+
+private:	// Types
+	struct DrawPacket
+	{
+		u64		key					= 0;
+		u32		mesh_slot			= 0;
+		u32		first_transform		= 0;
+		u32		transform_count		= 0;
+	};
+
+private:	// Methods
+	u32		get_mesh_slot(u32 mesh_id, u32 lod, const MeshBinding& mesh);
+	void	radix_sort();
+
+private:	// Members
+	std::vector<DrawPacket>			_packets;
+	std::vector<DrawPacket>			_sort_scratch;
+	std::vector<glm::mat4>			_transforms;
+	FrustumCuller					_culler;
+
+	std::vector<MeshBinding>		_meshes;
+	// Mesh id in the high bits, level of detail in the low ones
+	std::unordered_map<u64, u32>	_mesh_slots;
+
+	std::vector<DrawBatch>			_batches;
+	std::vector<glm::mat4>			_sorted_transforms;
+
+	glm::mat4						_view = glm::mat4(1.0f);
+	Statistics						_statistics;
+};
+
+} // Vulkan
+
+#endif //RENDERQUEUE_H
@@ -10,6 +10,11 @@
 #include "vulkan/SwapchainManager.h"
 #include "vulkan/GraphicsPipeline.h"
 #include "vulkan/CommandBuffers.h"
+#include "vulkan/MemoryAllocator.h"
+#include "vulkan/TransferContext.h"
+#include "vulkan/DeletionQueue.h"
+#include "vulkan/PipelineCache.h"
+#include "vulkan/ShaderBundle.h"
 #include "log.h"
 #include "Window.h"
 
@@ -32,16 +37,26 @@ Buffer*							Renderer::_index_staging_buffer = nullptr;
 VkDescriptorPool				Renderer::_descriptor_pool = VK_NULL_HANDLE;
 std::vector<VkDescriptorSet>	Renderer::_descriptor_sets;
 std::vector<Buffer*>			Renderer::_uniform_buffers;
+std::vector<Buffer*>			Renderer::_instance_buffers;
 
 
 bool Renderer::initialize()
 {
 	if (!VulkanInstance::initialize())
 		return false;
+	if (!MemoryAllocator::initialize())
+		return false;
+	if (!TransferContext::initialize())
+		return false;
 	if (!SwapchainManager::initialize())
 		return false;
+	if (!ShaderBundle::initialize())
+		return false;
+	if (!PipelineCache::initialize())
+		return false;
 	if (!GraphicsPipeline::initialize())
 		return false;
+	PipelineCache::log_statistics();
 	if (!SwapchainManager::create_framebuffers())
 		return false;
 	if (!create_buffers())
@@ -74,11 +89,17 @@ void Renderer::shutdown()
 
 	for (auto& buffer : _uniform_buffers)
 		delete buffer;
+	for (auto& buffer : _instance_buffers)
+		delete buffer;
 
 	vkDestroyDescriptorPool(VulkanInstance::logical_device(), _descriptor_pool, nullptr);
 
+	DeletionQueue::flush_all();
 	GraphicsPipeline::shutdown();
+	PipelineCache::shutdown();
 	SwapchainManager::shutdown();
+	TransferContext::shutdown();
+	MemoryAllocator::shutdown();
 	VulkanInstance::shutdown();
 }
 
@@ -96,7 +117,7 @@ void Renderer::draw_call(const std::vector<Vertex>& verticies, const std::vector
 		std::numeric_limits<u64>::max(), image_available_semaphores()[current_frame()], VK_NULL_HANDLE, &image_index);
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		SwapchainManager::recreate();
+		recreate_swapchain();
 		return ;
 	} else if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't acquire next swapchain image for rendering!");
@@ -110,13 +131,14 @@ void Renderer::draw_call(const std::vector<Vertex>& verticies, const std::vector
 	fill_vertex_buffer(verticies, 0);
 	fill_index_buffer(indices, 0);
 	fill_uniform_buffer(pos);
+	fill_instance_buffer();
 
 	if (indices.size() >index_buffer_capacity()) {
 		CommandBuffers::record_command_buffer(CommandBuffers::get(current_frame()), image_index, vertex_buffer()->buffer(),
-			index_buffer()->buffer(), index_buffer_capacity(), _descriptor_sets[current_frame()]);
+			_instance_buffers[current_frame()]->buffer(), index_buffer()->buffer(), index_buffer_capacity(), _descriptor_sets[current_frame()]);
 	} else {
 		CommandBuffers::record_command_buffer(CommandBuffers::get(current_frame()), image_index, vertex_buffer()->buffer(),
-			index_buffer()->buffer(), indices.size(), _descriptor_sets[current_frame()]);
+			_instance_buffers[current_frame()]->buffer(), index_buffer()->buffer(), indices.size(), _descriptor_sets[current_frame()]);
 	}
 
 
@@ -148,7 +170,7 @@ void Renderer::draw_call(const std::vector<Vertex>& verticies, const std::vector
 
 	result = vkQueuePresentKHR(VulkanInstance::present_queue(), &present_infos);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || Window::did_resize()) {
-		SwapchainManager::recreate();
+		recreate_swapchain();
 	} else if (result != VK_SUCCESS) {
 		CORE_ERROR("Couldn't present swap chain image!");
 		return ;
@@ -157,6 +179,14 @@ void Renderer::draw_call(const std::vector<Vertex>& verticies, const std::vector
 	_current_frame = (current_frame() + 1) % frames_in_flight_count();
 }
 
+void Renderer::recreate_swapchain()
+{
+	// Frames aren't tracked for the DeletionQueue here, the device is idle so the old swapchain can go right away
+	vkDeviceWaitIdle(VulkanInstance::logical_device());
+	SwapchainManager::recreate();
+	DeletionQueue::flush_all();
+}
+
 bool Renderer::create_sync_objects()
 {
 	VkSemaphoreCreateInfo semaphore_infos{};
@@ -200,19 +230,27 @@ bool Renderer::create_buffers()
 			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 	}
 
+	// A single instance is drawn, its model matrix is written every frame
+	_instance_buffers.resize(frames_in_flight_count());
+	for (u32 i = 0; i < frames_in_flight_count(); i++) {
+		_instance_buffers[i] = new Buffer(sizeof(InstanceData),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	}
+
 	return true;
 }
 
 void Renderer::fill_vertex_buffer(const std::vector<Vertex> &verticies, u32 offset)
 {
 	vertex_staging_buffer()->set_data(verticies, 0);
-	vertex_staging_buffer()->copy_to(*vertex_buffer(), offset, verticies.size() * sizeof(Vertex), 0);
+	// The staging buffer is written again by the next draw
+	TransferContext::wait(vertex_staging_buffer()->copy_to(*vertex_buffer(), offset, verticies.size() * sizeof(Vertex), 0));
 }
 
 void Renderer::fill_index_buffer(const std::vector<u16> &indices, u32 offset)
 {
 	index_staging_buffer()->set_data(indices, 0);
-	index_staging_buffer()->copy_to(*index_buffer(), offset, indices.size() * sizeof(u16), 0);
+	TransferContext::wait(index_staging_buffer()->copy_to(*index_buffer(), offset, indices.size() * sizeof(u16), 0));
 }
 
 void Renderer::fill_uniform_buffer(const glm::vec3 &pos)
@@ -227,6 +265,15 @@ void Renderer::fill_uniform_buffer(const glm::vec3 &pos)
 	_uniform_buffers[current_frame()]->set_data(&ubo, sizeof(CameraUBO));
 }
 
+void Renderer::fill_instance_buffer()
+{
+	// pos only ever reached the camera, which ignores it: the mesh is drawn where its vertices are
+	InstanceData instance{};
+	instance.model = glm::mat4(1.0f);
+
+	_instance_buffers[current_frame()]->set_data(&instance, sizeof(InstanceData));
+}
+
 bool Renderer::create_descriptor_pool()
 {
 	VkDescriptorPoolSize pool_size{};
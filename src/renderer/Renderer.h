@@ -38,10 +38,12 @@ private:	// Methods
 	static bool	create_descriptor_sets();
 
 	static void	draw_call(const std::vector<Vertex>& verticies, const std::vector<u16>& indices, const glm::vec3& pos);
+	static void	recreate_swapchain();
 
 	static void	fill_vertex_buffer(const std::vector<Vertex>& verticies, u32 offset);
 	static void	fill_index_buffer(const std::vector<u16>& indices, u32 offset);
 	static void	fill_uniform_buffer(const glm::vec3& pos);
+	static void	fill_instance_buffer();
 
 	//----
 	// Getters
@@ -58,6 +60,7 @@ private:	// Methods
 	static Buffer*						index_buffer()					{ return _index_buffer; }
 	static Buffer*						index_staging_buffer()			{ return _index_staging_buffer; }
 	static std::vector<Buffer*>			uniform_buffers()				{ return _uniform_buffers; }
+	static std::vector<Buffer*>			instance_buffers()				{ return _instance_buffers; }
 
 private:	// Members
 	static std::vector<VkSemaphore>		_image_available_semaphores;
@@ -76,6 +79,7 @@ private:	// Members
 	static Buffer*						_index_staging_buffer;
 
 	static std::vector<Buffer*>			_uniform_buffers;
+	static std::vector<Buffer*>			_instance_buffers;
 	static VkDescriptorPool				_descriptor_pool;
 	static std::vector<VkDescriptorSet>	_descriptor_sets;
 };
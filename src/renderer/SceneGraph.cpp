@@ -0,0 +1,169 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include "SceneGraph.h"
+#include "log.h"
+
+namespace Vulkan {
+
+//----
+// Nodes
+//----
+
+SceneGraph::NodeHandle SceneGraph::create_node(NodeHandle parent, const glm::mat4 &local_transform)
+{
+	if (parent != INVALID_NODE && !is_valid(parent)) {
+		CORE_ERROR("SceneGraph::create_node(): invalid parent node %u", parent);
+		return INVALID_NODE;
+	}
+
+	NodeHandle node;
+	if (!_free_handles.empty()) {
+		node = _free_handles.back();
+		_free_handles.pop_back();
+	} else {
+		node = static_cast<NodeHandle>(_indices.size());
+		_indices.push_back(INVALID_INDEX);
+		_dirty_flags.push_back(0);
+	}
+
+	// Right after the last node of the parent's subtree, which keeps the whole array in depth-first order
+	u32 position = size();
+	u32 parent_index = INVALID_INDEX;
+	if (parent != INVALID_NODE) {
+		parent_index = _indices[parent];
+		position = parent_index + _subtree_sizes[parent_index];
+		for (u32 ancestor = parent_index; ancestor != INVALID_INDEX; ancestor = _parents[ancestor])
+			_subtree_sizes[ancestor]++;
+	}
+
+	// Everything after the insertion point moves by one, and so do the parent positions pointing there
+	for (u32& parent_position : _parents) {
+		if (parent_position != INVALID_INDEX && parent_position >= position)
+			parent_position++;
+	}
+	_parents.insert(_parents.begin() + position, parent_index);
+	_subtree_sizes.insert(_subtree_sizes.begin() + position, 1);
+	_local_transforms.insert(_local_transforms.begin() + position, local_transform);
+	_world_transforms.insert(_world_transforms.begin() + position, local_transform);
+	_handles.insert(_handles.begin() + position, node);
+	reindex(position);
+
+	mark_dirty(node);
+	return node;
+}
+
+void SceneGraph::destroy_node(NodeHandle node)
+{
+	if (!is_valid(node)) {
+		CORE_ERROR("SceneGraph::destroy_node(): invalid node %u", node);
+		return ;
+	}
+
+	const u32 first = _indices[node];
+	const u32 count = _subtree_sizes[first];
+	for (u32 ancestor = _parents[first]; ancestor != INVALID_INDEX; ancestor = _parents[ancestor])
+		_subtree_sizes[ancestor] -= count;
+
+	for (u32 i = first; i < first + count; i++) {
+		_indices[_handles[i]] = INVALID_INDEX;
+		_free_handles.push_back(_handles[i]);
+	}
+
+	_parents.erase(_parents.begin() + first, _parents.begin() + first + count);
+	_subtree_sizes.erase(_subtree_sizes.begin() + first, _subtree_sizes.begin() + first + count);
+	_local_transforms.erase(_local_transforms.begin() + first, _local_transforms.begin() + first + count);
+	_world_transforms.erase(_world_transforms.begin() + first, _world_transforms.begin() + first + count);
+	_handles.erase(_handles.begin() + first, _handles.begin() + first + count);
+
+	// Parents inside the removed range are gone with it, only those after it move
+	for (u32& parent_position : _parents) {
+		if (parent_position != INVALID_INDEX && parent_position >= first + count)
+			parent_position -= count;
+	}
+	reindex(first);
+}
+
+void SceneGraph::clear()
+{
+	_parents.clear();
+	_subtree_sizes.clear();
+	_local_transforms.clear();
+	_world_transforms.clear();
+	_handles.clear();
+	_indices.clear();
+	_dirty_flags.clear();
+	_free_handles.clear();
+	_dirty.clear();
+	_changed_nodes.clear();
+	_changed_world_transforms.clear();
+}
+
+SceneGraph::NodeHandle SceneGraph::parent(NodeHandle node) const
+{
+	u32 parent_index = _parents[_indices[node]];
+	return parent_index == INVALID_INDEX ? INVALID_NODE : _handles[parent_index];
+}
+
+void SceneGraph::set_local_transform(NodeHandle node, const glm::mat4 &local_transform)
+{
+	_local_transforms[_indices[node]] = local_transform;
+	mark_dirty(node);
+}
+
+void SceneGraph::mark_dirty(NodeHandle node)
+{
+	if (_dirty_flags[node])
+		return ;
+	_dirty_flags[node] = 1;
+	_dirty.push_back(node);
+}
+
+void SceneGraph::reindex(u32 first)
+{
+	for (u32 i = first; i < _handles.size(); i++)
+		_indices[_handles[i]] = i;
+}
+
+//----
+// Update
+//----
+
+u32 SceneGraph::update()
+{
+	_changed_nodes.clear();
+	_changed_world_transforms.clear();
+
+	// Positions of the dirty nodes, destroyed ones are dropped
+	_dirty_scratch.clear();
+	for (NodeHandle node : _dirty) {
+		_dirty_flags[node] = 0;
+		if (_indices[node] != INVALID_INDEX)
+			_dirty_scratch.push_back(_indices[node]);
+	}
+	_dirty.clear();
+	std::sort(_dirty_scratch.begin(), _dirty_scratch.end());
+
+	// A dirty node inside a subtree that was just walked is already up to date
+	u32 updated_end = 0;
+	for (u32 first : _dirty_scratch) {
+		if (first < updated_end)
+			continue;
+
+		// Parents come first in depth-first order, their world matrix is always ready when a child needs it
+		updated_end = first + _subtree_sizes[first];
+		for (u32 i = first; i < updated_end; i++) {
+			if (_parents[i] == INVALID_INDEX)
+				_world_transforms[i] = _local_transforms[i];
+			else
+				_world_transforms[i] = _world_transforms[_parents[i]] * _local_transforms[i];
+			_changed_nodes.push_back(_handles[i]);
+			_changed_world_transforms.push_back(_world_transforms[i]);
+		}
+	}
+	return static_cast<u32>(_changed_nodes.size());
+}
+
+} // Vulkan
@@ -0,0 +1,85 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef SCENEGRAPH_H
+#define SCENEGRAPH_H
+
+#include <vector>
+#include <limits>
+#include "defines.h"
+#include "glm/glm.hpp"
+
+namespace Vulkan {
+
+// Hierarchy of transforms, stored in depth-first order so that every subtree is a contiguous range of nodes
+// and a parent always comes before its children.
+// update() only walks the subtrees whose local transform changed, and lists the world matrices it wrote.
+class SceneGraph
+{
+public:		// Types
+	// Stays valid while nodes are added and removed around it, unlike the node's position in the arrays
+	using NodeHandle = u32;
+	static constexpr NodeHandle	INVALID_NODE = std::numeric_limits<u32>::max();
+
+public:
+	SceneGraph() = default;
+
+	//----
+	// Nodes
+	//----
+	// Added as the last child of parent, or as a new root
+	NodeHandle	create_node(NodeHandle parent = INVALID_NODE, const glm::mat4& local_transform = glm::mat4(1.0f));
+	// Destroys the node and its whole subtree
+	void		destroy_node(NodeHandle node);
+	void		clear();
+
+	void		set_local_transform(NodeHandle node, const glm::mat4& local_transform);
+
+	// Recomputes the world matrices of the changed subtrees, returns how many nodes were updated
+	u32			update();
+
+	//----
+	// Getters
+	//----
+	bool				is_valid(NodeHandle node)			const	{ return node < _indices.size() && _indices[node] != INVALID_INDEX; }
+	NodeHandle			parent(NodeHandle node)				const;
+	const glm::mat4&	local_transform(NodeHandle node)	const	{ return _local_transforms[_indices[node]]; }
+	// Valid as of the last update()
+	const glm::mat4&	world_transform(NodeHandle node)	const	{ return _world_transforms[_indices[node]]; }
+	u32					size()								const	{ return static_cast<u32>(_handles.size()); }
+
+	// The nodes update() wrote and their new world matrices, packed in the same order, ready to be uploaded
+	const std::vector<NodeHandle>&	changed_nodes()				const	{ return _changed_nodes; }
+	const std::vector<glm::mat4>&	changed_world_transforms()	const	{ return _changed_world_transforms; }
+
+private:	// Types
+	static constexpr u32	INVALID_INDEX = std::numeric_limits<u32>::max();
+
+private:	// Methods
+	void	mark_dirty(NodeHandle node);
+	// Rewrites _indices for the nodes from first onwards, after the arrays moved
+	void	reindex(u32 first);
+
+private:	// Members
+	// Indexed by position in depth-first order
+	std::vector<u32>			_parents;			// Position of the parent, INVALID_INDEX for roots
+	std::vector<u32>			_subtree_sizes;		// The node included
+	std::vector<glm::mat4>		_local_transforms;
+	std::vector<glm::mat4>		_world_transforms;
+	std::vector<NodeHandle>		_handles;
+
+	// Indexed by handle
+	std::vector<u32>			_indices;
+	std::vector<u8>				_dirty_flags;
+	std::vector<NodeHandle>		_free_handles;
+
+	std::vector<NodeHandle>		_dirty;
+	std::vector<u32>			_dirty_scratch;
+	std::vector<NodeHandle>		_changed_nodes;
+	std::vector<glm::mat4>		_changed_world_transforms;
+};
+
+} // Vulkan
+
+#endif //SCENEGRAPH_H
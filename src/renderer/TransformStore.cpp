@@ -0,0 +1,193 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "TransformStore.h"
+#include "core/JobSystem.h"
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+namespace Vulkan {
+
+// Dirty entries per job when updating on several threads
+static constexpr u32	UPDATE_GRAIN_SIZE = 4096;
+
+glm::mat4 TransformStore::compose(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale)
+{
+	const f32 x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+	const f32 xx = x * x, yy = y * y, zz = z * z;
+	const f32 xy = x * y, xz = x * z, yz = y * z;
+	const f32 wx = w * x, wy = w * y, wz = w * z;
+
+	// Columns of the rotation matrix of a unit quaternion, each scaled along its axis
+	glm::mat4 matrix;
+	matrix[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * scale.x;
+	matrix[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * scale.y;
+	matrix[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * scale.z;
+	matrix[3] = glm::vec4(position, 1.0f);
+	return matrix;
+}
+
+//----
+// Entries
+//----
+
+TransformStore::Handle TransformStore::create(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale)
+{
+	Handle handle;
+	if (!_free_handles.empty()) {
+		handle = _free_handles.back();
+		_free_handles.pop_back();
+	} else {
+		handle = size();
+		for (auto *array : {&_position_x, &_position_y, &_position_z, &_rotation_x, &_rotation_y, &_rotation_z, &_rotation_w,
+				&_scale_x, &_scale_y, &_scale_z})
+			array->push_back(0.0f);
+		_matrices.emplace_back(1.0f);
+		_dirty_flags.push_back(0);
+	}
+
+	set_position(handle, position);
+	set_rotation(handle, rotation);
+	set_scale(handle, scale);
+	return handle;
+}
+
+void TransformStore::destroy(Handle handle)
+{
+	_free_handles.push_back(handle);
+}
+
+void TransformStore::clear()
+{
+	for (auto *array : {&_position_x, &_position_y, &_position_z, &_rotation_x, &_rotation_y, &_rotation_z, &_rotation_w,
+			&_scale_x, &_scale_y, &_scale_z})
+		array->clear();
+	_matrices.clear();
+	_dirty.clear();
+	_dirty_flags.clear();
+	_free_handles.clear();
+}
+
+void TransformStore::set_position(Handle handle, const glm::vec3 &position)
+{
+	_position_x[handle] = position.x;
+	_position_y[handle] = position.y;
+	_position_z[handle] = position.z;
+	mark_dirty(handle);
+}
+
+void TransformStore::set_rotation(Handle handle, const glm::quat &rotation)
+{
+	_rotation_x[handle] = rotation.x;
+	_rotation_y[handle] = rotation.y;
+	_rotation_z[handle] = rotation.z;
+	_rotation_w[handle] = rotation.w;
+	mark_dirty(handle);
+}
+
+void TransformStore::set_rotation(Handle handle, const glm::vec3 &euler_angles)
+{
+	// glm builds the quaternion of rotate(z) * rotate(y) * rotate(x)
+	set_rotation(handle, glm::quat(euler_angles));
+}
+
+void TransformStore::set_scale(Handle handle, const glm::vec3 &scale)
+{
+	_scale_x[handle] = scale.x;
+	_scale_y[handle] = scale.y;
+	_scale_z[handle] = scale.z;
+	mark_dirty(handle);
+}
+
+void TransformStore::mark_dirty(Handle handle)
+{
+	if (_dirty_flags[handle])
+		return ;
+	_dirty_flags[handle] = 1;
+	_dirty.push_back(handle);
+}
+
+//----
+// Update
+//----
+
+u32 TransformStore::update()
+{
+	const u32 dirty_count = static_cast<u32>(_dirty.size());
+	JobSystem::parallel_for(dirty_count, UPDATE_GRAIN_SIZE, [this](u32 first, u32 last) {
+		update_range(first, last);
+	});
+
+	for (Handle handle : _dirty)
+		_dirty_flags[handle] = 0;
+	_dirty.clear();
+	return dirty_count;
+}
+
+void TransformStore::update_range(u32 first, u32 last)
+{
+	for (u32 i = update_range_sse(first, last); i < last; i++) {
+		const Handle handle = _dirty[i];
+		_matrices[handle] = compose(position(handle), rotation(handle), scale(handle));
+	}
+}
+
+#if defined(__SSE2__)
+u32 TransformStore::update_range_sse(u32 first, u32 last)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 two = _mm_set1_ps(2.0f);
+
+	u32 i = first;
+	for (; i + 4 <= last; i += 4) {
+		const Handle h0 = _dirty[i], h1 = _dirty[i + 1], h2 = _dirty[i + 2], h3 = _dirty[i + 3];
+		auto gather = [h0, h1, h2, h3](const std::vector<f32>& array) {
+			return _mm_setr_ps(array[h0], array[h1], array[h2], array[h3]);
+		};
+
+		const __m128 x = gather(_rotation_x), y = gather(_rotation_y), z = gather(_rotation_z), w = gather(_rotation_w);
+		const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+		const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+		const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+		const __m128 scale_x = gather(_scale_x), scale_y = gather(_scale_y), scale_z = gather(_scale_z);
+
+		// One register per matrix element, holding it for the 4 entries, same formulas as compose()
+		__m128 columns[4][4];
+		columns[0][0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), scale_x);
+		columns[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), scale_x);
+		columns[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), scale_x);
+		columns[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), scale_y);
+		columns[1][1] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), scale_y);
+		columns[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), scale_y);
+		columns[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), scale_z);
+		columns[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), scale_z);
+		columns[2][2] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), scale_z);
+		columns[3][0] = gather(_position_x);
+		columns[3][1] = gather(_position_y);
+		columns[3][2] = gather(_position_z);
+		for (u32 column = 0; column < 3; column++)
+			columns[column][3] = _mm_setzero_ps();
+		columns[3][3] = one;
+
+		// Transposing a column turns the 4 entries' values of each element into each entry's column
+		const Handle handles[4] = {h0, h1, h2, h3};
+		for (u32 column = 0; column < 4; column++) {
+			__m128 *c = columns[column];
+			_MM_TRANSPOSE4_PS(c[0], c[1], c[2], c[3]);
+			for (u32 entry = 0; entry < 4; entry++)
+				_mm_storeu_ps(&_matrices[handles[entry]][column][0], c[entry]);
+		}
+	}
+	return i;
+}
+#else
+u32 TransformStore::update_range_sse(u32 first, u32)
+{
+	return first;
+}
+#endif
+
+} // Vulkan
@@ -0,0 +1,88 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef TRANSFORMSTORE_H
+#define TRANSFORMSTORE_H
+
+#include <vector>
+#include "defines.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+namespace Vulkan {
+
+// Positions, rotations and scales kept as separate arrays of floats, turned into model matrices by update().
+// Only the entries changed since the last update() are recomputed, 4 at a time with SSE2 and spread over the JobSystem.
+class TransformStore
+{
+public:		// Types
+	using Handle = u32;
+
+public:
+	TransformStore() = default;
+
+	// translate(position) * rotate(rotation) * scale(scale), without multiplying any matrix
+	static glm::mat4	compose(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+	//----
+	// Entries
+	//----
+	Handle	create(const glm::vec3& position = glm::vec3(0.0f), const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+				const glm::vec3& scale = glm::vec3(1.0f));
+	// The handle can be given back by a later create()
+	void	destroy(Handle handle);
+	void	clear();
+
+	void	set_position(Handle handle, const glm::vec3& position);
+	void	set_rotation(Handle handle, const glm::quat& rotation);
+	// Same order as BasicRenderer::draw(): z, then y, then x
+	void	set_rotation(Handle handle, const glm::vec3& euler_angles);
+	void	set_scale(Handle handle, const glm::vec3& scale);
+
+	// Recomputes the matrices of the dirty entries, returns how many there were
+	u32		update();
+
+	//----
+	// Getters
+	//----
+	glm::vec3			position(Handle handle)	const	{ return {_position_x[handle], _position_y[handle], _position_z[handle]}; }
+	glm::quat			rotation(Handle handle)	const	{ return {_rotation_w[handle], _rotation_x[handle], _rotation_y[handle], _rotation_z[handle]}; }
+	glm::vec3			scale(Handle handle)	const	{ return {_scale_x[handle], _scale_y[handle], _scale_z[handle]}; }
+
+	// Valid as of the last update()
+	const glm::mat4&	matrix(Handle handle)	const	{ return _matrices[handle]; }
+	// Indexed by handle, destroyed entries included
+	const glm::mat4		*matrices()				const	{ return _matrices.data(); }
+	u32					size()					const	{ return static_cast<u32>(_matrices.size()); }
+	u32					dirty_count()			const	{ return static_cast<u32>(_dirty.size()); }
+
+private:	// Methods
+	void	mark_dirty(Handle handle);
+	// Computes the matrices of _dirty[first, last)
+	void	update_range(u32 first, u32 last);
+	u32		update_range_sse(u32 first, u32 last);
+
+private:	// Members
+	std::vector<f32>		_position_x;
+	std::vector<f32>		_position_y;
+	std::vector<f32>		_position_z;
+	std::vector<f32>		_rotation_x;
+	std::vector<f32>		_rotation_y;
+	std::vector<f32>		_rotation_z;
+	std::vector<f32>		_rotation_w;
+	std::vector<f32>		_scale_x;
+	std::vector<f32>		_scale_y;
+	std::vector<f32>		_scale_z;
+
+	std::vector<glm::mat4>	_matrices;
+
+	// Handles changed since the last update(), each listed once thanks to the flags
+	std::vector<Handle>		_dirty;
+	std::vector<u8>			_dirty_flags;
+	std::vector<Handle>		_free_handles;
+};
+
+} // Vulkan
+
+#endif //TRANSFORMSTORE_H
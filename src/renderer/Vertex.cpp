@@ -4,6 +4,8 @@
 
 #include "Vertex.h"
 #include <vulkan/vulkan.h>
+#include <cmath>
+#include "defines.h"
 
 namespace Vulkan {
 
@@ -28,4 +30,69 @@ std::array<VkVertexInputAttributeDescription, 2> Vertex::get_attribute_descripti
 	return attribute_description;
 }
 
+VertexDequantization QuantizedVertex::get_dequantization(const glm::vec3 &box_min, const glm::vec3 &box_max) {
+	VertexDequantization dequantization;
+	glm::vec3 extents = glm::max((box_max - box_min) * 0.5f, glm::vec3(1e-6f));
+	dequantization.offset = glm::vec4((box_min + box_max) * 0.5f, 0.0f);
+	dequantization.scale = glm::vec4(extents, 1.0f);
+	return dequantization;
+}
+
+QuantizedVertex QuantizedVertex::quantize(const Vertex &vertex, const VertexDequantization &dequantization) {
+	// -32768 is left out, snorm maps both it and -32767 to -1
+	glm::vec3 normalized = (vertex.pos - glm::vec3(dequantization.offset)) / glm::vec3(dequantization.scale);
+	normalized = glm::clamp(normalized, -1.0f, 1.0f) * 32767.0f;
+	glm::vec3 color = glm::clamp(vertex.col, 0.0f, 1.0f) * 255.0f;
+
+	QuantizedVertex quantized{};
+	for (u32 i = 0; i < 3; i++) {
+		quantized.pos[i] = static_cast<i16>(std::lround(normalized[i]));
+		quantized.col[i] = static_cast<u8>(std::lround(color[i]));
+	}
+	quantized.pos[3] = 0;
+	quantized.col[3] = 255;
+	return quantized;
+}
+
+VkVertexInputBindingDescription QuantizedVertex::get_binding_description() {
+	VkVertexInputBindingDescription binding_description{};
+	binding_description.binding = 0;
+	binding_description.stride = sizeof (QuantizedVertex);
+	binding_description.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	return binding_description;
+}
+
+std::array<VkVertexInputAttributeDescription, 2> QuantizedVertex::get_attribute_description() {
+	// Normalized formats, the vertex shader receives the position in [-1, 1] and the color in [0, 1]
+	std::array<VkVertexInputAttributeDescription, 2> attribute_description{};
+	attribute_description[0].binding = 0;
+	attribute_description[0].offset = offsetof(QuantizedVertex, pos);
+	attribute_description[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+	attribute_description[0].location = 0;
+	attribute_description[1].binding = 0;
+	attribute_description[1].offset = offsetof(QuantizedVertex, col);
+	attribute_description[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+	attribute_description[1].location = 1;
+	return attribute_description;
+}
+
+VkVertexInputBindingDescription InstanceData::get_binding_description() {
+	VkVertexInputBindingDescription binding_description{};
+	binding_description.binding = 1;
+	binding_description.stride = sizeof (InstanceData);
+	binding_description.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+	return binding_description;
+}
+
+std::array<VkVertexInputAttributeDescription, 4> InstanceData::get_attribute_description() {
+	std::array<VkVertexInputAttributeDescription, 4> attribute_description{};
+	for (u32 column = 0; column < 4; column++) {
+		attribute_description[column].binding = 1;
+		attribute_description[column].offset = offsetof(InstanceData, model) + column * sizeof(glm::vec4);
+		attribute_description[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		attribute_description[column].location = 2 + column;
+	}
+	return attribute_description;
+}
+
 } // Vulkan
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <vulkan/vulkan.h>
 #include <array>
 #include "glm/glm.hpp"
+#include "defines.h"
 
 namespace Vulkan {
 
@@ -23,6 +24,46 @@ struct Vertex
 
 	static std::array<VkVertexInputAttributeDescription, 2> get_attribute_description();
 };
+
+// How a mesh stores its vertices in its vertex buffer, each format has its own pipeline
+enum class VertexFormat
+{
+	Float,		// Vertex, 24 bytes
+	Quantized	// QuantizedVertex, 12 bytes
+};
+
+// Turns quantized positions back into model space, position = offset + quantized * scale. Pushed as constants.
+struct VertexDequantization
+{
+	glm::vec4 offset = glm::vec4(0.0f);
+	glm::vec4 scale = glm::vec4(1.0f);
+};
+
+// Position as 16-bit snorm relative to the bounding box of its mesh, color as 8-bit unorm
+struct QuantizedVertex
+{
+	i16 pos[4];		// w is unused, it keeps the attribute 4-component wide
+	u8 col[4];		// a is always 255
+
+	// The dequantization that maps [-1, 1] onto the box, degenerate axes are given a non-zero extent
+	static VertexDequantization get_dequantization(const glm::vec3& box_min, const glm::vec3& box_max);
+	static QuantizedVertex quantize(const Vertex& vertex, const VertexDequantization& dequantization);
+
+	static VkVertexInputBindingDescription get_binding_description();
+
+	static std::array<VkVertexInputAttributeDescription, 2> get_attribute_description();
+};
+
+// Per-instance data, fed through a second vertex binding stepped once per instance
+struct InstanceData
+{
+	glm::mat4 model;
+
+	static VkVertexInputBindingDescription get_binding_description();
+
+	// A mat4 attribute takes 4 consecutive locations, one per column
+	static std::array<VkVertexInputAttributeDescription, 4> get_attribute_description();
+};
 } // Vulkan
 
 #endif //VERTEX_H
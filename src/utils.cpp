@@ -5,6 +5,10 @@
 #include "utils.h"
 #include "log.h"
 #include <fstream>
+#include <climits>
+#if defined PLATFORM_MACOS
+# include <mach-o/dyld.h>
+#endif
 
 namespace Vulkan {
 
@@ -43,4 +47,27 @@ std::vector<char> read_file(const std::string& file_name)
 	return buffer;
 }
 
+std::string executable_directory()
+{
+	char path[PATH_MAX];
+#if defined PLATFORM_MACOS
+	// Can be relative or go through symlinks, realpath() settles it
+	char unresolved[PATH_MAX];
+	u32 size = sizeof(unresolved);
+	if (_NSGetExecutablePath(unresolved, &size) != 0 || realpath(unresolved, path) == nullptr)
+		return {};
+#else
+	ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+	if (length <= 0)
+		return {};
+	path[length] = '\0';
+#endif
+
+	std::string directory(path);
+	size_t separator = directory.find_last_of('/');
+	if (separator == std::string::npos)
+		return {};
+	return directory.substr(0, separator);
+}
+
 }
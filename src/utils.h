@@ -20,6 +20,9 @@ void my_sleep(u64 us);
 
 std::vector<char> read_file(const std::string& file_name);
 
+// Directory of the running binary, without the trailing slash. Empty when it can't be found
+std::string executable_directory();
+
 }
 
 #endif //UTILS_H
@@ -10,9 +10,13 @@
 #include <vector>
 #include "defines.h"
 #include "log.h"
+#include "MemoryAllocator.h"
 
 namespace Vulkan {
 
+// Identifies the TransferContext batch a transfer was recorded in, batches complete in increasing token order
+using UploadToken = u64;
+
 class Buffer
 {
 public:		// Factory
@@ -32,10 +36,14 @@ public:
 
 	void	release_ressources();
 
-	void	copy_to(const Buffer& buffer, u32 dst_offset = 0) const;
-	void	copy_to(const Buffer& buffer, u32 dst_offset, u32 size_to_copy, u32 src_offset = 0) const;
+	// Recorded in TransferContext's current batch without waiting: both buffers must stay alive until
+	// TransferContext::wait() on the returned token, which also sends the batch
+	UploadToken	copy_to(const Buffer& buffer, u32 dst_offset = 0) const;
+	UploadToken	copy_to(const Buffer& buffer, u32 dst_offset, u32 size_to_copy, u32 src_offset = 0) const;
 
 	void	set_data(const void *src_data, size_t byte_count, u32 offset = 0);
+	// Reads back what the device wrote, once the work writing it has completed
+	void	get_data(void *dst_data, size_t byte_count, u32 offset = 0) const;
 	template<typename T>
 	void	set_data(const std::vector<T> &vector, u32 offset)
 	{
@@ -70,21 +78,11 @@ private:	// Methods
 
 	void	create_buffer();
 	void	allocate_buffer();
-	void	create_command_pool();
-	void	create_command_buffer();
-	void	create_fence();
-	void	record_command_buffer(VkBuffer dst_buffer, u32 dst_offset, u32 size_to_copy, u32 src_offset) const;
-	void	submit_command_buffer() const;
-
-	std::optional<u32>	find_memory_type(u32 type_filter, VkMemoryPropertyFlags properties) const;
 
 	//----
 	// Getters
 	//----
-	const VkDeviceMemory&			memory()			const	{ return _memory; }
-	const VkCommandPool&			command_pool()		const	{ return _command_pool; }
-	const VkCommandBuffer&			command_buffer()	const	{ return _command_buffer; }
-	const VkFence&					copy_fence()		const	{ return _copy_fence; }
+	const MemoryAllocator::Allocation&	allocation()	const	{ return _allocation; }
 	void							*mapped_memory()	const	{ return _mapped_memory; }
 
 private:	// Members
@@ -92,11 +90,7 @@ private:	// Members
 	VkDeviceSize			_size;
 	VkBufferUsageFlags		_usage;
 	VkMemoryPropertyFlags	_memory_properties;
-	VkDeviceMemory			_memory;
-
-	VkCommandPool			_command_pool;
-	VkCommandBuffer			_command_buffer;
-	VkFence					_copy_fence;
+	MemoryAllocator::Allocation	_allocation;
 
 	void					*_mapped_memory;
 };
@@ -50,7 +50,7 @@ void CommandBuffers::shutdown()
 }
 
 void CommandBuffers::record_command_buffer(VkCommandBuffer command_buffer, u32 image_index, VkBuffer vertex_buffer,
-	VkBuffer index_buffer, u32 index_count, VkDescriptorSet descriptor)
+	VkBuffer instance_buffer, VkBuffer index_buffer, u32 index_count, VkDescriptorSet descriptor)
 {
 	VkCommandBufferBeginInfo begin_infos{};
 	begin_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -69,9 +69,12 @@ void CommandBuffers::record_command_buffer(VkCommandBuffer command_buffer, u32 i
 	render_pass_infos.renderArea.offset = {0, 0};
 	render_pass_infos.renderArea.extent = SwapchainManager::swapchain_extent();
 
-	VkClearValue clear_color = {{{0.0f, 0.0f, 0.0f, 1.0f}}};
-	render_pass_infos.clearValueCount = 1;
-	render_pass_infos.pClearValues = &clear_color;
+	// Color, then depth: the render pass clears both
+	VkClearValue clear_values[2]{};
+	clear_values[0].color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+	clear_values[1].depthStencil = {1.0f, 0};
+	render_pass_infos.clearValueCount = 2;
+	render_pass_infos.pClearValues = clear_values;
 
 	vkCmdBeginRenderPass(command_buffer, &render_pass_infos, VK_SUBPASS_CONTENTS_INLINE);
 	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline::pipeline());
@@ -90,9 +93,9 @@ void CommandBuffers::record_command_buffer(VkCommandBuffer command_buffer, u32 i
 	scissors.extent = SwapchainManager::swapchain_extent();
 	vkCmdSetScissor(command_buffer, 0, 1, &scissors);
 
-	VkBuffer vertex_buffers[] = {vertex_buffer};
-	VkDeviceSize offsets[] = {0};
-	vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+	VkBuffer vertex_buffers[] = {vertex_buffer, instance_buffer};
+	VkDeviceSize offsets[] = {0, 0};
+	vkCmdBindVertexBuffers(command_buffer, 0, 2, vertex_buffers, offsets);
 
 	vkCmdBindIndexBuffer(command_buffer, index_buffer, 0, VK_INDEX_TYPE_UINT16);
 
@@ -0,0 +1,163 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "ComputePipeline.h"
+#include "GraphicsPipeline.h"
+#include "VulkanInstance.h"
+#include "PipelineCache.h"
+#include "vulkan_errors.h"
+#include "utils.h"
+#include "log.h"
+
+namespace Vulkan {
+
+ComputePipeline::ComputePipeline()
+	: _descriptor_set_layout(VK_NULL_HANDLE), _pipeline_layout(VK_NULL_HANDLE), _pipeline(VK_NULL_HANDLE)
+{
+}
+
+ComputePipeline::ComputePipeline(ComputePipeline &&other) noexcept
+	: _descriptor_set_layout(other._descriptor_set_layout), _pipeline_layout(other._pipeline_layout), _pipeline(other._pipeline)
+{
+	other._descriptor_set_layout = VK_NULL_HANDLE;
+	other._pipeline_layout = VK_NULL_HANDLE;
+	other._pipeline = VK_NULL_HANDLE;
+}
+
+ComputePipeline::~ComputePipeline()
+{
+	shutdown();
+}
+
+ComputePipeline &ComputePipeline::operator=(ComputePipeline &&other) noexcept
+{
+	if (&other == this)
+		return *this;
+
+	shutdown();
+
+	_descriptor_set_layout = other._descriptor_set_layout;
+	_pipeline_layout = other._pipeline_layout;
+	_pipeline = other._pipeline;
+
+	other._descriptor_set_layout = VK_NULL_HANDLE;
+	other._pipeline_layout = VK_NULL_HANDLE;
+	other._pipeline = VK_NULL_HANDLE;
+
+	return *this;
+}
+
+bool ComputePipeline::initialize(const std::string &shader_name, const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+	u32 push_constant_size)
+{
+	if (!create_descriptor_set_layout(bindings))
+		return false;
+	if (!create_pipeline_layout(push_constant_size))
+		return false;
+	if (!create_pipeline(shader_name))
+		return false;
+	CORE_TRACE("Compute pipeline created from %s", shader_name.c_str());
+	return true;
+}
+
+void ComputePipeline::shutdown()
+{
+	if (_pipeline != VK_NULL_HANDLE)
+		vkDestroyPipeline(VulkanInstance::logical_device(), _pipeline, nullptr);
+	if (_pipeline_layout != VK_NULL_HANDLE)
+		vkDestroyPipelineLayout(VulkanInstance::logical_device(), _pipeline_layout, nullptr);
+	if (_descriptor_set_layout != VK_NULL_HANDLE)
+		vkDestroyDescriptorSetLayout(VulkanInstance::logical_device(), _descriptor_set_layout, nullptr);
+
+	_pipeline = VK_NULL_HANDLE;
+	_pipeline_layout = VK_NULL_HANDLE;
+	_descriptor_set_layout = VK_NULL_HANDLE;
+}
+
+void ComputePipeline::bind(VkCommandBuffer command_buffer, VkDescriptorSet descriptor_set) const
+{
+	vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+	vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+}
+
+void ComputePipeline::push_constants(VkCommandBuffer command_buffer, const void *data, u32 size) const
+{
+	vkCmdPushConstants(command_buffer, _pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, data);
+}
+
+void ComputePipeline::dispatch(VkCommandBuffer command_buffer, u32 invocation_count, u32 group_size, u32 group_count_y) const
+{
+	if (invocation_count == 0 || group_count_y == 0)
+		return ;
+	vkCmdDispatch(command_buffer, (invocation_count + group_size - 1) / group_size, group_count_y, 1);
+}
+
+bool ComputePipeline::create_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+{
+	VkDescriptorSetLayoutCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	create_infos.bindingCount = static_cast<u32>(bindings.size());
+	create_infos.pBindings = bindings.data();
+
+	VkResult result = vkCreateDescriptorSetLayout(VulkanInstance::logical_device(), &create_infos, nullptr, &_descriptor_set_layout);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create a compute pipeline's descriptor set layout: %s", vulkan_error_to_string(result));
+		return false;
+	}
+	return true;
+}
+
+bool ComputePipeline::create_pipeline_layout(u32 push_constant_size)
+{
+	VkPushConstantRange push_constants{};
+	push_constants.offset = 0;
+	push_constants.size = push_constant_size;
+	push_constants.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkPipelineLayoutCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	create_infos.setLayoutCount = 1;
+	create_infos.pSetLayouts = &_descriptor_set_layout;
+	create_infos.pushConstantRangeCount = push_constant_size > 0 ? 1 : 0;
+	create_infos.pPushConstantRanges = push_constant_size > 0 ? &push_constants : nullptr;
+
+	VkResult result = vkCreatePipelineLayout(VulkanInstance::logical_device(), &create_infos, nullptr, &_pipeline_layout);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create a compute pipeline's layout: %s", vulkan_error_to_string(result));
+		return false;
+	}
+	return true;
+}
+
+bool ComputePipeline::create_pipeline(const std::string &shader_name)
+{
+	VkShaderModule shader_module = GraphicsPipeline::create_shader_module(shader_name);
+	if (shader_module == VK_NULL_HANDLE)
+		return false;
+
+	VkPipelineShaderStageCreateInfo stage_create_infos{};
+	stage_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	stage_create_infos.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	stage_create_infos.module = shader_module;
+	stage_create_infos.pName = "main";
+
+	VkComputePipelineCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	create_infos.stage = stage_create_infos;
+	create_infos.layout = _pipeline_layout;
+	create_infos.basePipelineHandle = VK_NULL_HANDLE;
+	create_infos.basePipelineIndex = -1;
+
+	f64 creation_start = get_absolute_time();
+	VkResult result = vkCreateComputePipelines(VulkanInstance::logical_device(), PipelineCache::cache(), 1, &create_infos, nullptr, &_pipeline);
+	vkDestroyShaderModule(VulkanInstance::logical_device(), shader_module, nullptr);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create a compute pipeline from %s: %s", shader_name.c_str(), vulkan_error_to_string(result));
+		return false;
+	}
+	PipelineCache::record_creation(get_absolute_time() - creation_start);
+	return true;
+}
+
+} // Vulkan
@@ -0,0 +1,63 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef COMPUTEPIPELINE_H
+#define COMPUTEPIPELINE_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include "defines.h"
+
+namespace Vulkan {
+
+// A compute shader with its own descriptor set layout (set 0) and an optional push constant range.
+// Unlike GraphicsPipeline there can be as many as needed, each pass owns its own.
+class ComputePipeline
+{
+public:
+	ComputePipeline();
+	ComputePipeline(const ComputePipeline& other) = delete;
+	ComputePipeline(ComputePipeline&& other) noexcept;
+	~ComputePipeline();
+
+	ComputePipeline& operator=(const ComputePipeline& other) = delete;
+	ComputePipeline& operator=(ComputePipeline&& other) noexcept;
+
+	//----
+	// Initialization
+	//----
+	bool	initialize(const std::string& shader_name, const std::vector<VkDescriptorSetLayoutBinding>& bindings, u32 push_constant_size = 0);
+	void	shutdown();
+
+	//----
+	// Recording
+	//----
+	void	bind(VkCommandBuffer command_buffer, VkDescriptorSet descriptor_set) const;
+	void	push_constants(VkCommandBuffer command_buffer, const void *data, u32 size) const;
+	// group_count_y workgroups along y, each a row of invocation_count invocations along x
+	void	dispatch(VkCommandBuffer command_buffer, u32 invocation_count, u32 group_size, u32 group_count_y = 1) const;
+
+	//----
+	// Getters
+	//----
+	VkPipeline				pipeline()				const	{ return _pipeline; }
+	VkPipelineLayout		pipeline_layout()		const	{ return _pipeline_layout; }
+	VkDescriptorSetLayout	descriptor_set_layout()	const	{ return _descriptor_set_layout; }
+	bool					is_valid()				const	{ return _pipeline != VK_NULL_HANDLE; }
+
+private:	// Methods
+	bool	create_descriptor_set_layout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	bool	create_pipeline_layout(u32 push_constant_size);
+	bool	create_pipeline(const std::string& shader_name);
+
+private:	// Members
+	VkDescriptorSetLayout	_descriptor_set_layout;
+	VkPipelineLayout		_pipeline_layout;
+	VkPipeline				_pipeline;
+};
+
+} // Vulkan
+
+#endif //COMPUTEPIPELINE_H
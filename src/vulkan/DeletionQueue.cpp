@@ -0,0 +1,36 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include "DeletionQueue.h"
+
+namespace Vulkan {
+
+std::deque<DeletionQueue::Entry>	DeletionQueue::_entries;
+u64									DeletionQueue::_submitted_frames = 0;
+
+void DeletionQueue::push(std::function<void()> &&deleter)
+{
+	_entries.push_back({_submitted_frames, std::move(deleter)});
+}
+
+u64 DeletionQueue::frame_submitted()
+{
+	return ++_submitted_frames;
+}
+
+void DeletionQueue::flush(u64 completed_frames)
+{
+	// Entries are pushed with a growing frame count, the ones that can be deleted are all at the front
+	while (!_entries.empty() && _entries.front().retired_at <= completed_frames) {
+		_entries.front().deleter();
+		_entries.pop_front();
+	}
+}
+
+void DeletionQueue::flush_all()
+{
+	flush(_submitted_frames);
+}
+
+} // Vulkan
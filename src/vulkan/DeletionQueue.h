@@ -0,0 +1,52 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef DELETIONQUEUE_H
+#define DELETIONQUEUE_H
+
+#include <functional>
+#include <deque>
+#include "defines.h"
+
+namespace Vulkan {
+
+// Destroys resources once the frames that may still use them are done, instead of waiting for the whole device.
+// A deleter pushed after n frames were submitted runs once the n-th frame is known to be finished.
+class DeletionQueue
+{
+public:
+	//----
+	// Deferred deletion
+	//----
+	static void	push(std::function<void()>&& deleter);
+
+	// Called once a frame is submitted, returns the number of frames submitted so far including this one
+	static u64	frame_submitted();
+	// Runs the deleters of every resource retired before completed_frames frames were submitted, in the order they
+	// were pushed. Frames go through a single queue, waiting on the fence of one means all the earlier ones are done too
+	static void	flush(u64 completed_frames);
+	// The device must be idle, every deleter left is run
+	static void	flush_all();
+
+	//----
+	// Getters
+	//----
+	static u64	submitted_frames()	{ return _submitted_frames; }
+	static u64	pending_count()		{ return _entries.size(); }
+
+private:	// Types
+	struct Entry
+	{
+		u64						retired_at;
+		std::function<void()>	deleter;
+	};
+
+private:	// Members
+	static std::deque<Entry>	_entries;
+	static u64					_submitted_frames;
+};
+
+} // Vulkan
+
+#endif //DELETIONQUEUE_H
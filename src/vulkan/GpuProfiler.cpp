@@ -0,0 +1,252 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include "GpuProfiler.h"
+#include "VulkanInstance.h"
+#include "vulkan_errors.h"
+#include "log.h"
+
+namespace Vulkan {
+
+bool							GpuProfiler::_enabled = false;
+std::vector<GpuProfiler::FrameQueries>	GpuProfiler::_frames;
+u32								GpuProfiler::_current_frame = 0;
+std::vector<GpuProfiler::Pass>	GpuProfiler::_passes;
+std::mutex						GpuProfiler::_pending_mutex;
+std::vector<std::pair<const char *, f64>>	GpuProfiler::_pending_times;
+
+GpuProfiler::Scope::Scope(VkCommandBuffer command_buffer, const char *name)
+	: _command_buffer(command_buffer), _scope(begin_scope(command_buffer, name))
+{
+}
+
+GpuProfiler::Scope::~Scope()
+{
+	end_scope(_command_buffer, _scope);
+}
+
+bool GpuProfiler::initialize(u32 frames_in_flight)
+{
+	if (VulkanInstance::device_features().timestamp_period <= 0.0f || VulkanInstance::device_features().timestamp_valid_bits == 0) {
+		CORE_WARN("GpuProfiler: the graphics queue can't write timestamps, GPU passes won't be timed");
+		return true;
+	}
+
+	_frames.resize(frames_in_flight);
+	for (auto& frame : _frames) {
+		VkQueryPoolCreateInfo create_infos{};
+		create_infos.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		create_infos.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		create_infos.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+		VkResult result = vkCreateQueryPool(VulkanInstance::logical_device(), &create_infos, nullptr, &frame.query_pool);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create GpuProfiler's query pool: %s", vulkan_error_to_string(result));
+			return false;
+		}
+		frame.scope_names.reserve(MAX_SCOPES_PER_FRAME);
+	}
+	_current_frame = 0;
+	_enabled = true;
+	CORE_TRACE("GpuProfiler initialized with %u scopes per frame", MAX_SCOPES_PER_FRAME);
+	return true;
+}
+
+void GpuProfiler::shutdown()
+{
+	for (auto& frame : _frames) {
+		if (frame.query_pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(VulkanInstance::logical_device(), frame.query_pool, nullptr);
+	}
+	_frames.clear();
+	_passes.clear();
+	_pending_times.clear();
+	_enabled = false;
+}
+
+void GpuProfiler::begin_frame(u32 frame_index)
+{
+	if (!_enabled)
+		return ;
+
+	_current_frame = frame_index;
+	collect(_frames[frame_index]);
+}
+
+void GpuProfiler::reset_queries(VkCommandBuffer command_buffer)
+{
+	if (!_enabled)
+		return ;
+
+	vkCmdResetQueryPool(command_buffer, _frames[_current_frame].query_pool, 0, MAX_SCOPES_PER_FRAME * 2);
+}
+
+u32 GpuProfiler::begin_scope(VkCommandBuffer command_buffer, const char *name)
+{
+	if (!_enabled)
+		return INVALID_SCOPE;
+
+	FrameQueries& frame = _frames[_current_frame];
+	if (frame.scope_names.size() >= MAX_SCOPES_PER_FRAME) {
+		CORE_DEBUG("GpuProfiler: out of scopes this frame, %s isn't timed", name);
+		return INVALID_SCOPE;
+	}
+
+	// Top of pipe as the scope's commands start, bottom of pipe once they are all done
+	u32 scope = static_cast<u32>(frame.scope_names.size());
+	frame.scope_names.push_back(name);
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.query_pool, scope * 2);
+	return scope;
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer command_buffer, u32 scope)
+{
+	if (!_enabled || scope == INVALID_SCOPE)
+		return ;
+
+	vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, _frames[_current_frame].query_pool, scope * 2 + 1);
+}
+
+void GpuProfiler::add_time(const char *name, f64 milliseconds)
+{
+	if (!_enabled)
+		return ;
+
+	std::lock_guard<std::mutex> lock(_pending_mutex);
+	_pending_times.emplace_back(name, milliseconds);
+}
+
+f64 GpuProfiler::ticks_to_milliseconds(u64 begin, u64 end)
+{
+	const u32 valid_bits = VulkanInstance::device_features().timestamp_valid_bits;
+	const u64 mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+	return static_cast<f64>((end - begin) & mask) * VulkanInstance::device_features().timestamp_period / 1e6;
+}
+
+std::vector<std::string> GpuProfiler::pass_names()
+{
+	std::vector<std::string> names;
+	names.reserve(_passes.size());
+	for (const auto& pass : _passes)
+		names.push_back(pass.name);
+	return names;
+}
+
+std::vector<f64> GpuProfiler::history(const std::string &name)
+{
+	std::vector<f64> samples;
+	for (const auto& pass : _passes) {
+		if (pass.name != name)
+			continue ;
+
+		// Until the ring is full the oldest sample is the first one
+		u32 oldest = pass.sample_count < HISTORY_LENGTH ? 0 : pass.next;
+		samples.reserve(pass.sample_count);
+		for (u32 i = 0; i < pass.sample_count; i++)
+			samples.push_back(pass.history[(oldest + i) % HISTORY_LENGTH]);
+		break ;
+	}
+	return samples;
+}
+
+f64 GpuProfiler::average(const std::string &name)
+{
+	std::vector<f64> samples = history(name);
+	if (samples.empty())
+		return 0.0;
+
+	f64 total = 0.0;
+	for (f64 sample : samples)
+		total += sample;
+	return total / samples.size();
+}
+
+void GpuProfiler::log_statistics()
+{
+	if (!_enabled || _passes.empty())
+		return ;
+
+	std::string line;
+	char buffer[128];
+	for (auto& pass : _passes) {
+		if (pass.period_sample_count == 0)
+			continue ;
+
+		snprintf(buffer, sizeof(buffer), "%s%s %.3f ms", line.empty() ? "" : ", ", pass.name.c_str(),
+			pass.period_time / pass.period_sample_count);
+		line += buffer;
+		pass.period_time = 0.0;
+		pass.period_sample_count = 0;
+	}
+	if (!line.empty())
+		CORE_INFO("GpuProfiler: %s per frame", line.c_str());
+}
+
+//----
+// Collection
+//----
+
+u32 GpuProfiler::find_pass(const char *name)
+{
+	for (u32 i = 0; i < _passes.size(); i++) {
+		if (_passes[i].name == name)
+			return i;
+	}
+	Pass& pass = _passes.emplace_back();
+	pass.name = name;
+	pass.history.resize(HISTORY_LENGTH, 0.0);
+	return static_cast<u32>(_passes.size() - 1);
+}
+
+void GpuProfiler::collect(FrameQueries &frame)
+{
+	// Times of the frame by pass index, a pass measured several times is added up
+	std::vector<std::pair<u32, f64>> frame_times;
+	auto add = [&frame_times](u32 pass, f64 milliseconds) {
+		for (auto& [frame_pass, time] : frame_times) {
+			if (frame_pass == pass) {
+				time += milliseconds;
+				return ;
+			}
+		}
+		frame_times.emplace_back(pass, milliseconds);
+	};
+
+	if (!frame.scope_names.empty()) {
+		// The fence was waited on so everything is available, a scope that was never closed just isn't
+		const u32 query_count = static_cast<u32>(frame.scope_names.size()) * 2;
+		std::vector<u64> results(query_count * 2, 0);
+		VkResult result = vkGetQueryPoolResults(VulkanInstance::logical_device(), frame.query_pool, 0, query_count,
+			results.size() * sizeof(u64), results.data(), sizeof(u64) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (result == VK_SUCCESS || result == VK_NOT_READY) {
+			for (u32 scope = 0; scope < frame.scope_names.size(); scope++) {
+				const u64 *begin = &results[scope * 4];
+				const u64 *end = &results[scope * 4 + 2];
+				if (begin[1] != 0 && end[1] != 0)
+					add(find_pass(frame.scope_names[scope]), ticks_to_milliseconds(begin[0], end[0]));
+			}
+		}
+		frame.scope_names.clear();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_pending_mutex);
+		for (const auto& [name, milliseconds] : _pending_times)
+			add(find_pass(name), milliseconds);
+		_pending_times.clear();
+	}
+
+	for (const auto& [index, time] : frame_times) {
+		Pass& pass = _passes[index];
+		pass.history[pass.next] = time;
+		pass.next = (pass.next + 1) % HISTORY_LENGTH;
+		pass.sample_count = std::min(pass.sample_count + 1, HISTORY_LENGTH);
+		pass.period_time += time;
+		pass.period_sample_count++;
+	}
+}
+
+} // Vulkan
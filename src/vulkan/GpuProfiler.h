@@ -0,0 +1,118 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <mutex>
+#include "defines.h"
+
+namespace Vulkan {
+
+// GPU time of the passes of a frame, measured with timestamp queries. Every frame in flight owns a query pool whose
+// results are only read once its fence was waited on, so reading them back never stalls.
+// Scopes with the same name add up within a frame. Not thread-safe apart from add_time().
+class GpuProfiler
+{
+public:	// Types
+	// Opens a scope on construction and closes it on destruction, in the same command buffer
+	class Scope
+	{
+	public:
+		Scope(VkCommandBuffer command_buffer, const char *name);
+		~Scope();
+
+		Scope(const Scope& other) = delete;
+		Scope& operator=(const Scope& other) = delete;
+
+	private:
+		VkCommandBuffer	_command_buffer;
+		u32				_scope;
+	};
+
+	static constexpr u32	MAX_SCOPES_PER_FRAME = 32;
+	// Frames of history kept per pass
+	static constexpr u32	HISTORY_LENGTH = 256;
+	static constexpr u32	INVALID_SCOPE = ~0u;
+
+public:
+	//----
+	// Initialization
+	//----
+	// Stays disabled, every scope doing nothing, if the device can't write timestamps on its graphics queue
+	static bool	initialize(u32 frames_in_flight);
+	static void	shutdown();
+
+	//----
+	// Frame
+	//----
+	// The frame's fence must have been waited on: collects what it measured the last time it ran
+	static void	begin_frame(u32 frame_index);
+	// First thing in the frame's command buffer, outside of any render pass
+	static void	reset_queries(VkCommandBuffer command_buffer);
+
+	// INVALID_SCOPE when disabled or out of queries, end_scope() then does nothing
+	static u32	begin_scope(VkCommandBuffer command_buffer, const char *name);
+	static void	end_scope(VkCommandBuffer command_buffer, u32 scope);
+
+	// GPU time measured outside of the frames' command buffers, added to the next frame collected. Thread-safe
+	static void	add_time(const char *name, f64 milliseconds);
+	// The difference between two timestamps of the graphics queue, wrapping around included
+	static f64	ticks_to_milliseconds(u64 begin, u64 end);
+
+	//----
+	// Results
+	//----
+	static bool						is_enabled()	{ return _enabled; }
+	// In the order they were first measured
+	static std::vector<std::string>	pass_names();
+	// Milliseconds of the last frames that measured the pass, oldest first. Empty for an unknown pass
+	static std::vector<f64>			history(const std::string& name);
+	static f64						average(const std::string& name);
+
+	// Average of each pass since the last call, on a single line
+	static void						log_statistics();
+
+private:	// Types
+	struct Pass
+	{
+		std::string			name;
+		// Ring of HISTORY_LENGTH samples, next is where the next one goes
+		std::vector<f64>	history;
+		u32					next				= 0;
+		u32					sample_count		= 0;
+
+		// Since the last log_statistics()
+		f64					period_time			= 0.0;
+		u32					period_sample_count	= 0;
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool					query_pool	= VK_NULL_HANDLE;
+		// Scope i writes queries 2 * i and 2 * i + 1
+		std::vector<const char *>	scope_names;
+	};
+
+private:	// Methods
+	static u32		find_pass(const char *name);
+	static void		collect(FrameQueries& frame);
+
+private:	// Members
+	static bool							_enabled;
+	static std::vector<FrameQueries>	_frames;
+	static u32							_current_frame;
+	static std::vector<Pass>			_passes;
+
+	// Filled by add_time() from any thread, drained into the next frame collected
+	static std::mutex					_pending_mutex;
+	static std::vector<std::pair<const char *, f64>>	_pending_times;
+};
+
+} // Vulkan
+
+#endif //GPUPROFILER_H
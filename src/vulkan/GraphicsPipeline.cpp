@@ -3,41 +3,196 @@
 //
 
 #include "GraphicsPipeline.h"
+#include <algorithm>
 #include "utils.h"
 #include "log.h"
 #include "VulkanInstance.h"
 #include "SwapchainManager.h"
+#include "PipelineCache.h"
+#include "ShaderBundle.h"
+#include "Window.h"
 #include "renderer/Renderer.h"
 
 namespace Vulkan {
 
 VkPipelineLayout		GraphicsPipeline::_pipeline_layout;
 VkRenderPass			GraphicsPipeline::_render_pass;
+VkRenderPass			GraphicsPipeline::_early_render_pass;
+VkRenderPass			GraphicsPipeline::_late_render_pass;
 VkPipeline				GraphicsPipeline::_pipeline;
+VkPipeline				GraphicsPipeline::_quantized_pipeline;
 VkDescriptorSetLayout	GraphicsPipeline::_descriptor_set_layout;
-
-bool GraphicsPipeline::initialize()
+VkDescriptorSetLayout	GraphicsPipeline::_object_descriptor_set_layout;
+VkPipelineLayout		GraphicsPipeline::_indirect_pipeline_layout;
+VkPipeline				GraphicsPipeline::_indirect_pipeline;
+bool					GraphicsPipeline::_depth_prepass = false;
+VkPipeline				GraphicsPipeline::_depth_pipeline = VK_NULL_HANDLE;
+VkPipeline				GraphicsPipeline::_quantized_depth_pipeline = VK_NULL_HANDLE;
+VkPipeline				GraphicsPipeline::_indirect_depth_pipeline = VK_NULL_HANDLE;
+
+bool GraphicsPipeline::initialize(bool depth_prepass)
 {
+	_depth_prepass = depth_prepass;
 	if (!initialize_render_pass())
 		return false;
 
 	if (!initialize_descriptor_sets())
 		return false;
 
-	auto vert_code = read_file("obj/shaders/shader.vert.spv");
-	auto frag_code = read_file("obj/shaders/shader.frag.spv");
+	if (!initialize_pipeline_layouts())
+		return false;
+
+	// After a prepass the depth buffer already holds the nearest surfaces, only the fragments landing exactly on them are shaded
+	const VkCompareOp depth_compare_op = depth_prepass ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+	const bool depth_write = !depth_prepass;
+
+	// Binding 0 is stepped per vertex, binding 1 per instance
+	VkVertexInputBindingDescription binding_descriptions[] = {Vertex::get_binding_description(), InstanceData::get_binding_description()};
+
+	std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
+	for (const auto& attribute : Vertex::get_attribute_description())
+		attribute_descriptions.push_back(attribute);
+	for (const auto& attribute : InstanceData::get_attribute_description())
+		attribute_descriptions.push_back(attribute);
+
+	VkPipelineVertexInputStateCreateInfo vertex_input_create_infos{};
+	vertex_input_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input_create_infos.vertexBindingDescriptionCount = 2;
+	vertex_input_create_infos.vertexAttributeDescriptionCount = static_cast<u32>(attribute_descriptions.size());
+	vertex_input_create_infos.pVertexBindingDescriptions = binding_descriptions;
+	vertex_input_create_infos.pVertexAttributeDescriptions = attribute_descriptions.data();
+
+	_pipeline = create_pipeline("shader.vert", "shader.frag", vertex_input_create_infos, pipeline_layout(),
+		depth_compare_op, depth_write);
+	if (_pipeline == VK_NULL_HANDLE)
+		return false;
+
+	// Same bindings, only the per-vertex attributes are narrower
+	binding_descriptions[0] = QuantizedVertex::get_binding_description();
+	auto quantized_vertex_attributes = QuantizedVertex::get_attribute_description();
+	std::copy(quantized_vertex_attributes.begin(), quantized_vertex_attributes.end(), attribute_descriptions.begin());
+
+	_quantized_pipeline = create_pipeline("quantized.vert", "shader.frag", vertex_input_create_infos,
+		pipeline_layout(), depth_compare_op, depth_write);
+	if (_quantized_pipeline == VK_NULL_HANDLE)
+		return false;
+
+	// The indirect pipeline reads the model matrices from the object storage buffer, indexed by the instance index
+	VkVertexInputBindingDescription indirect_binding_description = Vertex::get_binding_description();
+	auto indirect_attribute_descriptions = Vertex::get_attribute_description();
 
-	if (vert_code.empty() || frag_code.empty()) {
-		CORE_ERROR("Couldn't create the graphics pipeline: couldn't load SpirV shaders!");
+	VkPipelineVertexInputStateCreateInfo indirect_vertex_input_create_infos{};
+	indirect_vertex_input_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	indirect_vertex_input_create_infos.vertexBindingDescriptionCount = 1;
+	indirect_vertex_input_create_infos.vertexAttributeDescriptionCount = static_cast<u32>(indirect_attribute_descriptions.size());
+	indirect_vertex_input_create_infos.pVertexBindingDescriptions = &indirect_binding_description;
+	indirect_vertex_input_create_infos.pVertexAttributeDescriptions = indirect_attribute_descriptions.data();
+
+	_indirect_pipeline = create_pipeline("indirect.vert", "shader.frag",
+		indirect_vertex_input_create_infos, indirect_pipeline_layout(), depth_compare_op, depth_write);
+	if (_indirect_pipeline == VK_NULL_HANDLE)
+		return false;
+
+	if (depth_prepass && !initialize_depth_pipelines())
+		return false;
+
+	return true;
+}
+
+bool GraphicsPipeline::initialize_depth_pipelines()
+{
+	// Location 0 is the position in both vertex formats, the color is never fetched
+	VkVertexInputBindingDescription binding_descriptions[] = {Vertex::get_binding_description(), InstanceData::get_binding_description()};
+
+	std::vector<VkVertexInputAttributeDescription> attribute_descriptions = {Vertex::get_attribute_description()[0]};
+	for (const auto& attribute : InstanceData::get_attribute_description())
+		attribute_descriptions.push_back(attribute);
+
+	VkPipelineVertexInputStateCreateInfo vertex_input_create_infos{};
+	vertex_input_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	vertex_input_create_infos.vertexBindingDescriptionCount = 2;
+	vertex_input_create_infos.vertexAttributeDescriptionCount = static_cast<u32>(attribute_descriptions.size());
+	vertex_input_create_infos.pVertexBindingDescriptions = binding_descriptions;
+	vertex_input_create_infos.pVertexAttributeDescriptions = attribute_descriptions.data();
+
+	_depth_pipeline = create_pipeline("depth.vert", "", vertex_input_create_infos, pipeline_layout(),
+		VK_COMPARE_OP_LESS, true);
+	if (_depth_pipeline == VK_NULL_HANDLE)
+		return false;
+
+	binding_descriptions[0] = QuantizedVertex::get_binding_description();
+	attribute_descriptions[0] = QuantizedVertex::get_attribute_description()[0];
+	_quantized_depth_pipeline = create_pipeline("depth_quantized.vert", "", vertex_input_create_infos, pipeline_layout(),
+		VK_COMPARE_OP_LESS, true);
+	if (_quantized_depth_pipeline == VK_NULL_HANDLE)
+		return false;
+
+	// Only the vertex binding, the model matrices come from the object storage buffer
+	binding_descriptions[0] = Vertex::get_binding_description();
+	attribute_descriptions[0] = Vertex::get_attribute_description()[0];
+	vertex_input_create_infos.vertexBindingDescriptionCount = 1;
+	vertex_input_create_infos.vertexAttributeDescriptionCount = 1;
+	_indirect_depth_pipeline = create_pipeline("depth_indirect.vert", "", vertex_input_create_infos,
+		indirect_pipeline_layout(), VK_COMPARE_OP_LESS, true);
+	if (_indirect_depth_pipeline == VK_NULL_HANDLE)
+		return false;
+
+	CORE_TRACE("Depth prepass pipelines created");
+	return true;
+}
+
+bool GraphicsPipeline::initialize_pipeline_layouts()
+{
+	// The model matrix comes from the instance binding, the push constants only dequantize the positions.
+	// Both vertex formats share the layout, switching between them keeps the camera set bound
+	VkPushConstantRange dequantization_range{};
+	dequantization_range.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	dequantization_range.offset = 0;
+	dequantization_range.size = sizeof(VertexDequantization);
+
+	VkPipelineLayoutCreateInfo pipeline_layout_create_infos{};
+	pipeline_layout_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipeline_layout_create_infos.setLayoutCount = 1;
+	pipeline_layout_create_infos.pSetLayouts = &_descriptor_set_layout;
+	pipeline_layout_create_infos.pushConstantRangeCount = 1;
+	pipeline_layout_create_infos.pPushConstantRanges = &dequantization_range;
+
+	if (vkCreatePipelineLayout(VulkanInstance::logical_device(), &pipeline_layout_create_infos, nullptr, &_pipeline_layout) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the graphics pipeline's layout!");
 		return false;
 	}
 
-	VkShaderModule vert_shader_module = create_shader_module(vert_code);
-	VkShaderModule frag_shader_module = create_shader_module(frag_code);
+	// Set 0 is the camera, shared with the other pipeline, set 1 the objects
+	VkDescriptorSetLayout indirect_set_layouts[] = {_descriptor_set_layout, _object_descriptor_set_layout};
+	VkPipelineLayoutCreateInfo indirect_layout_create_infos{};
+	indirect_layout_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	indirect_layout_create_infos.setLayoutCount = 2;
+	indirect_layout_create_infos.pSetLayouts = indirect_set_layouts;
+	indirect_layout_create_infos.pushConstantRangeCount = 0;
+	indirect_layout_create_infos.pPushConstantRanges = nullptr;
+
+	if (vkCreatePipelineLayout(VulkanInstance::logical_device(), &indirect_layout_create_infos, nullptr, &_indirect_pipeline_layout) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the indirect graphics pipeline's layout!");
+		return false;
+	}
+	return true;
+}
 
-	if (vert_shader_module == VK_NULL_HANDLE || frag_shader_module == VK_NULL_HANDLE) {
+VkPipeline GraphicsPipeline::create_pipeline(const std::string &vert_shader, const std::string &frag_shader,
+	const VkPipelineVertexInputStateCreateInfo &vertex_input_create_infos, VkPipelineLayout layout, VkCompareOp depth_compare_op,
+	bool depth_write)
+{
+	const bool depth_only = frag_shader.empty();
+	VkShaderModule vert_shader_module = create_shader_module(vert_shader);
+	VkShaderModule frag_shader_module = depth_only ? VK_NULL_HANDLE : create_shader_module(frag_shader);
+
+	if (vert_shader_module == VK_NULL_HANDLE || (!depth_only && frag_shader_module == VK_NULL_HANDLE)) {
 		CORE_ERROR("Couldn't create the graphics pipeline!");
-		return false;
+		if (vert_shader_module != VK_NULL_HANDLE)
+			vkDestroyShaderModule(VulkanInstance::logical_device(), vert_shader_module, nullptr);
+		if (frag_shader_module != VK_NULL_HANDLE)
+			vkDestroyShaderModule(VulkanInstance::logical_device(), frag_shader_module, nullptr);
+		return VK_NULL_HANDLE;
 	}
 
 	VkPipelineShaderStageCreateInfo vert_shader_create_infos{};
@@ -63,16 +218,6 @@ bool GraphicsPipeline::initialize()
 	dynamic_state_create_infos.dynamicStateCount = static_cast<u32>(dynamic_states.size());
 	dynamic_state_create_infos.pDynamicStates = dynamic_states.data();
 
-	auto binding_description = Vertex::get_binding_description();
-	auto attribute_description = Vertex::get_attribute_description();
-
-	VkPipelineVertexInputStateCreateInfo vertex_input_create_infos{};
-	vertex_input_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertex_input_create_infos.vertexBindingDescriptionCount = 1;
-	vertex_input_create_infos.vertexAttributeDescriptionCount = attribute_description.size();
-	vertex_input_create_infos.pVertexBindingDescriptions = &binding_description;
-	vertex_input_create_infos.pVertexAttributeDescriptions = attribute_description.data();
-
 	VkPipelineInputAssemblyStateCreateInfo input_assembly_create_infos{};
 	input_assembly_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
 	input_assembly_create_infos.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
@@ -119,8 +264,18 @@ bool GraphicsPipeline::initialize()
 	multisampling.alphaToCoverageEnable = VK_FALSE;
 	multisampling.alphaToOneEnable = VK_FALSE;
 
+	VkPipelineDepthStencilStateCreateInfo depth_stencil{};
+	depth_stencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depth_stencil.depthTestEnable = VK_TRUE;
+	depth_stencil.depthWriteEnable = depth_write ? VK_TRUE : VK_FALSE;
+	depth_stencil.depthCompareOp = depth_compare_op;
+	depth_stencil.depthBoundsTestEnable = VK_FALSE;
+	depth_stencil.stencilTestEnable = VK_FALSE;
+
 	VkPipelineColorBlendAttachmentState colorBlend_attachment{};
 	colorBlend_attachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	if (depth_only)
+		colorBlend_attachment.colorWriteMask = 0;
 	colorBlend_attachment.blendEnable = VK_FALSE;
 	colorBlend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE; // Optional
 	colorBlend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
@@ -140,66 +295,56 @@ bool GraphicsPipeline::initialize()
 	color_blending.blendConstants[2] = 0.0f; // Optional
 	color_blending.blendConstants[3] = 0.0f; // Optional
 
-	VkPushConstantRange push_constants{};
-	push_constants.offset = 0;
-	push_constants.size = sizeof(glm::mat4);
-	push_constants.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-	VkPipelineLayoutCreateInfo pipeline_layout_create_infos{};
-	pipeline_layout_create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipeline_layout_create_infos.setLayoutCount = 1;
-	pipeline_layout_create_infos.pSetLayouts = &_descriptor_set_layout;
-	pipeline_layout_create_infos.pushConstantRangeCount = 1;
-	pipeline_layout_create_infos.pPushConstantRanges = &push_constants;
-
-	if (vkCreatePipelineLayout(VulkanInstance::logical_device(), &pipeline_layout_create_infos, nullptr, &_pipeline_layout) != VK_SUCCESS) {
-		CORE_ERROR("Couldn't create the graphics pipeline's layout!");
-		vkDestroyShaderModule(VulkanInstance::logical_device(), vert_shader_module, nullptr);
-		vkDestroyShaderModule(VulkanInstance::logical_device(), frag_shader_module, nullptr);
-		return false;
-	}
-
 	VkGraphicsPipelineCreateInfo create_infos{};
 	create_infos.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	create_infos.stageCount = 2;
+	create_infos.stageCount = depth_only ? 1 : 2;
 	create_infos.pStages = shader_stages;
 	create_infos.pVertexInputState = &vertex_input_create_infos;
 	create_infos.pInputAssemblyState = &input_assembly_create_infos;
 	create_infos.pViewportState = &viewport_state_create_infos;
 	create_infos.pRasterizationState = &rasterizer;
 	create_infos.pMultisampleState = &multisampling;
-	create_infos.pDepthStencilState = nullptr;
+	create_infos.pDepthStencilState = &depth_stencil;
 	create_infos.pColorBlendState = &color_blending;
 	create_infos.pDynamicState = &dynamic_state_create_infos;
-	create_infos.layout = pipeline_layout();
+	create_infos.layout = layout;
 	create_infos.renderPass = render_pass();
 	create_infos.subpass = 0;
 	create_infos.basePipelineHandle = VK_NULL_HANDLE;
 	create_infos.basePipelineIndex = -1;
 
-	if (vkCreateGraphicsPipelines(VulkanInstance::logical_device(), VK_NULL_HANDLE, 1, &create_infos, nullptr, &_pipeline) != VK_SUCCESS) {
-		CORE_ERROR("Couldn't create the graphics pipeline!");
-		vkDestroyShaderModule(VulkanInstance::logical_device(), vert_shader_module, nullptr);
-		vkDestroyShaderModule(VulkanInstance::logical_device(), frag_shader_module, nullptr);
-		return false;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	f64 creation_start = get_absolute_time();
+	if (vkCreateGraphicsPipelines(VulkanInstance::logical_device(), PipelineCache::cache(), 1, &create_infos, nullptr, &pipeline) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the graphics pipeline from %s!", vert_shader.c_str());
+		pipeline = VK_NULL_HANDLE;
+	} else {
+		PipelineCache::record_creation(get_absolute_time() - creation_start);
 	}
 
 	vkDestroyShaderModule(VulkanInstance::logical_device(), vert_shader_module, nullptr);
-	vkDestroyShaderModule(VulkanInstance::logical_device(), frag_shader_module, nullptr);
+	if (frag_shader_module != VK_NULL_HANDLE)
+		vkDestroyShaderModule(VulkanInstance::logical_device(), frag_shader_module, nullptr);
 
-	return true;
+	return pipeline;
 }
 
-VkShaderModule GraphicsPipeline::create_shader_module(const std::vector<char> &code)
+
+VkShaderModule GraphicsPipeline::create_shader_module(const std::string &name)
 {
+	auto shader = ShaderBundle::find(name);
+	if (!shader.has_value())
+		return VK_NULL_HANDLE;
+
+	// Straight from the words built into the binary, nothing is copied
 	VkShaderModuleCreateInfo create_infos{};
 	create_infos.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	create_infos.codeSize = code.size();
-	create_infos.pCode = reinterpret_cast<const u32*>(code.data());
+	create_infos.codeSize = shader->size;
+	create_infos.pCode = shader->code;
 
 	VkShaderModule module{};
 	if (vkCreateShaderModule(VulkanInstance::logical_device(), &create_infos, nullptr, &module) != VK_SUCCESS) {
-		CORE_ERROR("Couldn't create a shader module!");
+		CORE_ERROR("Couldn't create a shader module from %s!", name.c_str());
 		return VK_NULL_HANDLE;
 	}
 	return module;
@@ -208,56 +353,111 @@ VkShaderModule GraphicsPipeline::create_shader_module(const std::vector<char> &c
 void GraphicsPipeline::shutdown()
 {
 	vkDestroyRenderPass(VulkanInstance::logical_device(), render_pass(), nullptr);
+	vkDestroyRenderPass(VulkanInstance::logical_device(), early_render_pass(), nullptr);
+	vkDestroyRenderPass(VulkanInstance::logical_device(), late_render_pass(), nullptr);
 	vkDestroyDescriptorSetLayout(VulkanInstance::logical_device(), descriptor_set_layout(), nullptr);
+	vkDestroyDescriptorSetLayout(VulkanInstance::logical_device(), object_descriptor_set_layout(), nullptr);
 	vkDestroyPipelineLayout(VulkanInstance::logical_device(), pipeline_layout(), nullptr);
+	vkDestroyPipelineLayout(VulkanInstance::logical_device(), indirect_pipeline_layout(), nullptr);
 	vkDestroyPipeline(VulkanInstance::logical_device(), pipeline(), nullptr);
-
+	vkDestroyPipeline(VulkanInstance::logical_device(), quantized_pipeline(), nullptr);
+	vkDestroyPipeline(VulkanInstance::logical_device(), indirect_pipeline(), nullptr);
+	vkDestroyPipeline(VulkanInstance::logical_device(), depth_pipeline(), nullptr);
+	vkDestroyPipeline(VulkanInstance::logical_device(), quantized_depth_pipeline(), nullptr);
+	vkDestroyPipeline(VulkanInstance::logical_device(), indirect_depth_pipeline(), nullptr);
+	_depth_pipeline = VK_NULL_HANDLE;
+	_quantized_depth_pipeline = VK_NULL_HANDLE;
+	_indirect_depth_pipeline = VK_NULL_HANDLE;
 }
 
 bool GraphicsPipeline::initialize_render_pass()
+{
+	// Headless, PRESENT_SRC_KHR doesn't exist without VK_KHR_swapchain, the offscreen images are left ready to be copied out
+	const VkImageLayout final_layout = Window::is_headless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// Occlusion culling splits the frame around the build of the depth pyramid, the first pass keeps everything for the second
+	_render_pass = create_render_pass(false, final_layout, false);
+	_early_render_pass = create_render_pass(false, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true);
+	_late_render_pass = create_render_pass(true, final_layout, false);
+	if (_render_pass == VK_NULL_HANDLE || _early_render_pass == VK_NULL_HANDLE || _late_render_pass == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't create the render passes!");
+		return false;
+	}
+	return true;
+}
+
+VkRenderPass GraphicsPipeline::create_render_pass(bool load, VkImageLayout color_final_layout, bool sample_depth)
 {
 	VkAttachmentDescription color_attachment{};
 	color_attachment.format = SwapchainManager::swapchain_image_format();
 	color_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	color_attachment.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
 	color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	color_attachment.initialLayout = load ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	color_attachment.finalLayout = color_final_layout;
+
+	// Cleared every frame and only stored when the depth pyramid is built from it
+	VkAttachmentDescription depth_attachment{};
+	depth_attachment.format = SwapchainManager::depth_format();
+	depth_attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	depth_attachment.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depth_attachment.storeOp = sample_depth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depth_attachment.initialLayout = load ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	depth_attachment.finalLayout = sample_depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+		: VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkAttachmentReference color_attachment_ref{};
 	color_attachment_ref.attachment = 0;
 	color_attachment_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+	VkAttachmentReference depth_attachment_ref{};
+	depth_attachment_ref.attachment = 1;
+	depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	subpass.colorAttachmentCount = 1;
 	subpass.pColorAttachments = &color_attachment_ref;
-
-	VkSubpassDependency dependency{};
-	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.dstSubpass = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.srcAccessMask = 0;
-	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT;
-
+	subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+	// The depth buffer is shared by the frames in flight, the clear has to wait for the previous frame's depth tests and for the
+	// builds of the depth pyramid reading it
+	VkSubpassDependency dependencies[2]{};
+	dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[0].dstSubpass = 0;
+	dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
+		| VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	// The depth written by the pass is then read by the compute shader building the pyramid
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	VkAttachmentDescription attachments[] = {color_attachment, depth_attachment};
 	VkRenderPassCreateInfo create_infos{};
 	create_infos.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	create_infos.attachmentCount = 1;
-	create_infos.pAttachments = &color_attachment;
+	create_infos.attachmentCount = 2;
+	create_infos.pAttachments = attachments;
 	create_infos.subpassCount = 1;
 	create_infos.pSubpasses = &subpass;
-	create_infos.dependencyCount = 1;
-	create_infos.pDependencies = &dependency;
-
-	if (vkCreateRenderPass(VulkanInstance::logical_device(), &create_infos, nullptr, &_render_pass) != VK_SUCCESS) {
-		CORE_ERROR("Couldn't create the render pass!");
-		return false;
-	}
+	create_infos.dependencyCount = sample_depth ? 2 : 1;
+	create_infos.pDependencies = dependencies;
 
-	return true;
+	VkRenderPass render_pass = VK_NULL_HANDLE;
+	if (vkCreateRenderPass(VulkanInstance::logical_device(), &create_infos, nullptr, &render_pass) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	return render_pass;
 }
 
 bool GraphicsPipeline::initialize_descriptor_sets()
@@ -278,6 +478,23 @@ bool GraphicsPipeline::initialize_descriptor_sets()
 		CORE_ERROR("Couldn't create the descriptor set!");
 		return false;
 	}
+
+	VkDescriptorSetLayoutBinding objects_layout_binding{};
+	objects_layout_binding.binding = 0;
+	objects_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	objects_layout_binding.descriptorCount = 1;
+	objects_layout_binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	objects_layout_binding.pImmutableSamplers = nullptr;
+
+	VkDescriptorSetLayoutCreateInfo objects_create_infos{};
+	objects_create_infos.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	objects_create_infos.bindingCount = 1;
+	objects_create_infos.pBindings = &objects_layout_binding;
+
+	if (vkCreateDescriptorSetLayout(VulkanInstance::logical_device(), &objects_create_infos, nullptr, &_object_descriptor_set_layout) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the objects descriptor set!");
+		return false;
+	}
 	return true;
 }
 } // Vulkan
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include <vulkan/vulkan_core.h>
 #include <vector>
+#include <string>
 
 namespace Vulkan {
 
@@ -16,21 +17,48 @@ public:
 	//----
 	// Initialization
 	//----
-	static bool initialize();
+	// With depth_prepass, depth-only pipelines are created too and the color pipelines only shade EQUAL depths
+	static bool initialize(bool depth_prepass = false);
 	static void shutdown();
 
 	//----
 	// Getters
 	//----
 	static VkRenderPass&			render_pass()			{ return _render_pass; }
+	// Compatible with render_pass(), for frames split in two by occlusion culling. The early pass leaves the color attachment
+	// to the late one and its depth readable by compute shaders, the late pass loads both and presents
+	static VkRenderPass&			early_render_pass()		{ return _early_render_pass; }
+	static VkRenderPass&			late_render_pass()		{ return _late_render_pass; }
 	static VkPipeline&				pipeline()				{ return _pipeline; }
 	static VkDescriptorSetLayout	descriptor_set_layout()	{ return _descriptor_set_layout; };
 	static VkPipelineLayout&		pipeline_layout()		{ return _pipeline_layout; }
+	// Same layout as pipeline(), dequantizes QuantizedVertex with the VertexDequantization push constants
+	static VkPipeline&				quantized_pipeline()	{ return _quantized_pipeline; }
+
+	// Pipeline of the GPU-driven path, the model matrices come from a storage buffer in set 1
+	static VkPipeline&				indirect_pipeline()				{ return _indirect_pipeline; }
+	static VkPipelineLayout&		indirect_pipeline_layout()		{ return _indirect_pipeline_layout; }
+	static VkDescriptorSetLayout	object_descriptor_set_layout()	{ return _object_descriptor_set_layout; }
+
+	// Position only and without a fragment stage, same layouts as their color counterparts. VK_NULL_HANDLE without a prepass
+	static bool						depth_prepass_enabled()			{ return _depth_prepass; }
+	static VkPipeline&				depth_pipeline()				{ return _depth_pipeline; }
+	static VkPipeline&				quantized_depth_pipeline()		{ return _quantized_depth_pipeline; }
+	static VkPipeline&				indirect_depth_pipeline()		{ return _indirect_depth_pipeline; }
+
+	// From the ShaderBundle, e.g. "shader.vert"
+	static VkShaderModule	create_shader_module(const std::string& name);
 
 private:	// Methods
-	static VkShaderModule	create_shader_module(const std::vector<char>& code);
 	static bool				initialize_render_pass();
+	static VkRenderPass		create_render_pass(bool load, VkImageLayout color_final_layout, bool sample_depth);
 	static bool				initialize_descriptor_sets();
+	static bool				initialize_pipeline_layouts();
+	static bool				initialize_depth_pipelines();
+	// Without frag_shader, the pipeline only writes depth
+	static VkPipeline		create_pipeline(const std::string& vert_shader, const std::string& frag_shader,
+								const VkPipelineVertexInputStateCreateInfo& vertex_input_create_infos, VkPipelineLayout layout,
+								VkCompareOp depth_compare_op, bool depth_write);
 
 	//----
 	// Getters
@@ -40,7 +68,19 @@ private:	// Members
 	static VkDescriptorSetLayout	_descriptor_set_layout;
 	static VkPipelineLayout			_pipeline_layout;
 	static VkRenderPass				_render_pass;
+	static VkRenderPass				_early_render_pass;
+	static VkRenderPass				_late_render_pass;
 	static VkPipeline				_pipeline;
+	static VkPipeline				_quantized_pipeline;
+
+	static VkDescriptorSetLayout	_object_descriptor_set_layout;
+	static VkPipelineLayout			_indirect_pipeline_layout;
+	static VkPipeline				_indirect_pipeline;
+
+	static bool						_depth_prepass;
+	static VkPipeline				_depth_pipeline;
+	static VkPipeline				_quantized_depth_pipeline;
+	static VkPipeline				_indirect_depth_pipeline;
 };
 } // Vulkan
 
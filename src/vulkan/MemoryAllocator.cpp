@@ -0,0 +1,386 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <algorithm>
+#include <limits>
+#include "MemoryAllocator.h"
+#include "VulkanInstance.h"
+#include "vulkan_errors.h"
+#include "log.h"
+
+namespace Vulkan {
+
+// Blocks are never bigger than this, smaller heaps get smaller blocks
+static constexpr VkDeviceSize	LARGE_HEAP_BLOCK_SIZE = 64ull * 1024 * 1024;
+static constexpr VkDeviceSize	SMALL_HEAP_LIMIT = 1024ull * 1024 * 1024;
+
+VkPhysicalDeviceMemoryProperties			MemoryAllocator::_memory_properties;
+std::vector<MemoryAllocator::MemoryPool>	MemoryAllocator::_pools;
+std::mutex									MemoryAllocator::_mutex;
+u32											MemoryAllocator::_dedicated_allocation_count = 0;
+VkDeviceSize								MemoryAllocator::_dedicated_bytes = 0;
+
+bool MemoryAllocator::initialize()
+{
+	vkGetPhysicalDeviceMemoryProperties(VulkanInstance::physical_device(), &_memory_properties);
+
+	// One pool of linear resources and one pool of optimal resources per memory type, so that
+	// bufferImageGranularity never has to be taken into account inside of a block
+	_pools.resize(_memory_properties.memoryTypeCount * 2);
+	for (u32 i = 0; i < _memory_properties.memoryTypeCount; i++) {
+		_pools[pool_index(i, ResourceKind::Linear)].memory_type_index = i;
+		_pools[pool_index(i, ResourceKind::Linear)].kind = ResourceKind::Linear;
+		_pools[pool_index(i, ResourceKind::Linear)].block_size = preferred_block_size(i);
+		_pools[pool_index(i, ResourceKind::Optimal)].memory_type_index = i;
+		_pools[pool_index(i, ResourceKind::Optimal)].kind = ResourceKind::Optimal;
+		_pools[pool_index(i, ResourceKind::Optimal)].block_size = preferred_block_size(i);
+	}
+
+	_dedicated_allocation_count = 0;
+	_dedicated_bytes = 0;
+	return true;
+}
+
+void MemoryAllocator::shutdown()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (auto& pool : _pools) {
+		for (auto& block : pool.blocks) {
+			if (block.allocation_count > 0)
+				CORE_WARN("MemoryAllocator: a block of memory type %u still has %u live allocations at shutdown!", pool.memory_type_index, block.allocation_count);
+			destroy_block(block);
+		}
+	}
+	_pools.clear();
+
+	if (_dedicated_allocation_count > 0)
+		CORE_WARN("MemoryAllocator: %u dedicated allocations were not freed before shutdown!", _dedicated_allocation_count);
+}
+
+std::optional<MemoryAllocator::Allocation> MemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+	VkMemoryPropertyFlags properties, ResourceKind kind)
+{
+	std::optional<u32> memory_type_index = find_memory_type(requirements.memoryTypeBits, properties);
+	if (!memory_type_index.has_value()) {
+		CORE_ERROR("MemoryAllocator: couldn't find a memory region with the right type!");
+		return {};
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	u32 pool = pool_index(memory_type_index.value(), kind);
+	if (requirements.size > _pools[pool].block_size / 2)
+		return allocate_dedicated(requirements.size, memory_type_index.value());
+
+	return allocate_from_pool(requirements.size, std::max<VkDeviceSize>(requirements.alignment, 1), pool);
+}
+
+void MemoryAllocator::free(Allocation &allocation)
+{
+	if (!allocation.is_valid())
+		return ;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (allocation.dedicated) {
+		if (allocation.mapped_memory != nullptr)
+			vkUnmapMemory(VulkanInstance::logical_device(), allocation.memory);
+		vkFreeMemory(VulkanInstance::logical_device(), allocation.memory, nullptr);
+		_dedicated_allocation_count--;
+		_dedicated_bytes -= allocation.size;
+	} else {
+		// Freed after shutdown(), the blocks and their memory are already gone
+		if (allocation.pool_index >= _pools.size()) {
+			allocation = Allocation{};
+			return ;
+		}
+
+		MemoryPool& pool = _pools[allocation.pool_index];
+		MemoryBlock& block = pool.blocks[allocation.block_index];
+		release_range(block, allocation.offset, allocation.size);
+
+		// Give empty blocks back to the driver, but keep one around per pool to avoid thrashing
+		if (block.allocation_count == 0) {
+			u32 empty_blocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+				[](const MemoryBlock& b) { return b.memory != VK_NULL_HANDLE && b.allocation_count == 0; });
+			if (empty_blocks > 1)
+				destroy_block(block);
+		}
+	}
+
+	allocation = Allocation{};
+}
+
+std::optional<u32> MemoryAllocator::find_memory_type(u32 type_filter, VkMemoryPropertyFlags properties)
+{
+	// VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT bit specifies that memory allocated with this type is the most efficient for device access. This property will be set if and only if the memory type belongs to a heap with the VK_MEMORY_HEAP_DEVICE_LOCAL_BIT set
+	for (u32 i = 0; i < _memory_properties.memoryTypeCount; i++) {
+		if (type_filter & (1 << i) && (_memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+	return {};
+}
+
+MemoryAllocator::Statistics MemoryAllocator::get_statistics()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	Statistics stats{};
+	VkDeviceSize total_free = 0;
+	for (const auto& pool : _pools) {
+		for (const auto& block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+			stats.block_count++;
+			stats.allocation_count += block.allocation_count;
+			stats.bytes_reserved += block.size;
+			stats.bytes_used += block.used;
+			stats.free_range_count += block.free_ranges.size();
+			for (const auto& range : block.free_ranges) {
+				total_free += range.second;
+				stats.largest_free_range = std::max(stats.largest_free_range, range.second);
+			}
+		}
+	}
+
+	stats.dedicated_allocation_count = _dedicated_allocation_count;
+	stats.allocation_count += _dedicated_allocation_count;
+	stats.bytes_dedicated = _dedicated_bytes;
+	if (total_free > 0)
+		stats.fragmentation = 1.0f - static_cast<f32>(stats.largest_free_range) / static_cast<f32>(total_free);
+	return stats;
+}
+
+void MemoryAllocator::log_statistics()
+{
+	Statistics stats = get_statistics();
+	CORE_INFO("MemoryAllocator: %u allocations, %u blocks (%.2f/%.2f MiB used), %u dedicated (%.2f MiB), %u free ranges, fragmentation %.1f%%",
+		stats.allocation_count, stats.block_count, stats.bytes_used / (1024.0 * 1024.0), stats.bytes_reserved / (1024.0 * 1024.0),
+		stats.dedicated_allocation_count, stats.bytes_dedicated / (1024.0 * 1024.0), stats.free_range_count, stats.fragmentation * 100.0f);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (const auto& pool : _pools) {
+		for (u32 i = 0; i < pool.blocks.size(); i++) {
+			const MemoryBlock& block = pool.blocks[i];
+			if (block.memory == VK_NULL_HANDLE)
+				continue;
+			CORE_INFO("    type %u %s block %u: %u allocations, %.2f/%.2f MiB used, %lu free ranges",
+				pool.memory_type_index, pool.kind == ResourceKind::Linear ? "linear" : "optimal", i, block.allocation_count,
+				block.used / (1024.0 * 1024.0), block.size / (1024.0 * 1024.0), block.free_ranges.size());
+		}
+	}
+}
+
+u32 MemoryAllocator::pool_index(u32 memory_type_index, ResourceKind kind)
+{
+	return memory_type_index * 2 + (kind == ResourceKind::Linear ? 0 : 1);
+}
+
+VkDeviceSize MemoryAllocator::preferred_block_size(u32 memory_type_index)
+{
+	u32 heap_index = _memory_properties.memoryTypes[memory_type_index].heapIndex;
+	VkDeviceSize heap_size = _memory_properties.memoryHeaps[heap_index].size;
+
+	if (heap_size <= SMALL_HEAP_LIMIT)
+		return std::max<VkDeviceSize>(heap_size / 8, 1);
+	return LARGE_HEAP_BLOCK_SIZE;
+}
+
+bool MemoryAllocator::is_host_visible(u32 memory_type_index)
+{
+	return (_memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+std::optional<MemoryAllocator::Allocation> MemoryAllocator::allocate_dedicated(VkDeviceSize size, u32 memory_type_index)
+{
+	VkMemoryAllocateInfo alloc_infos{};
+	alloc_infos.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_infos.allocationSize = size;
+	alloc_infos.memoryTypeIndex = memory_type_index;
+
+	Allocation allocation{};
+	VkResult result = vkAllocateMemory(VulkanInstance::logical_device(), &alloc_infos, nullptr, &allocation.memory);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("MemoryAllocator: couldn't make a dedicated allocation of %lu bytes: %s", size, vulkan_error_to_string(result));
+		return {};
+	}
+
+	if (is_host_visible(memory_type_index)) {
+		result = vkMapMemory(VulkanInstance::logical_device(), allocation.memory, 0, size, 0, &allocation.mapped_memory);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("MemoryAllocator: couldn't map a dedicated allocation: %s", vulkan_error_to_string(result));
+			vkFreeMemory(VulkanInstance::logical_device(), allocation.memory, nullptr);
+			return {};
+		}
+	}
+
+	allocation.offset = 0;
+	allocation.size = size;
+	allocation.memory_type_index = memory_type_index;
+	allocation.dedicated = true;
+
+	_dedicated_allocation_count++;
+	_dedicated_bytes += size;
+	return allocation;
+}
+
+std::optional<MemoryAllocator::Allocation> MemoryAllocator::allocate_from_pool(VkDeviceSize size, VkDeviceSize alignment, u32 pool)
+{
+	MemoryPool& memory_pool = _pools[pool];
+
+	std::optional<u32> block_index;
+	VkDeviceSize offset = 0;
+	for (u32 i = 0; i < memory_pool.blocks.size(); i++) {
+		MemoryBlock& block = memory_pool.blocks[i];
+		if (block.memory == VK_NULL_HANDLE || block.size - block.used < size)
+			continue;
+		if (sub_allocate(block, size, alignment, offset)) {
+			block_index = i;
+			break;
+		}
+	}
+
+	if (!block_index.has_value()) {
+		block_index = create_block(pool);
+		if (!block_index.has_value())
+			return {};
+		if (!sub_allocate(memory_pool.blocks[block_index.value()], size, alignment, offset)) {
+			CORE_ERROR("MemoryAllocator: couldn't fit %lu bytes in a brand new block!", size);
+			return {};
+		}
+	}
+
+	MemoryBlock& block = memory_pool.blocks[block_index.value()];
+
+	Allocation allocation{};
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.memory_type_index = memory_pool.memory_type_index;
+	allocation.pool_index = pool;
+	allocation.block_index = block_index.value();
+	allocation.dedicated = false;
+	if (block.mapped_memory != nullptr)
+		allocation.mapped_memory = static_cast<u8 *>(block.mapped_memory) + offset;
+	return allocation;
+}
+
+std::optional<u32> MemoryAllocator::create_block(u32 pool)
+{
+	MemoryPool& memory_pool = _pools[pool];
+
+	MemoryBlock block{};
+	block.size = memory_pool.block_size;
+
+	VkMemoryAllocateInfo alloc_infos{};
+	alloc_infos.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	alloc_infos.allocationSize = block.size;
+	alloc_infos.memoryTypeIndex = memory_pool.memory_type_index;
+
+	VkResult result = vkAllocateMemory(VulkanInstance::logical_device(), &alloc_infos, nullptr, &block.memory);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("MemoryAllocator: couldn't allocate a new block of %lu bytes: %s", block.size, vulkan_error_to_string(result));
+		return {};
+	}
+
+	// Host visible blocks stay mapped for their whole lifetime
+	if (is_host_visible(memory_pool.memory_type_index)) {
+		result = vkMapMemory(VulkanInstance::logical_device(), block.memory, 0, block.size, 0, &block.mapped_memory);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("MemoryAllocator: couldn't map a new block: %s", vulkan_error_to_string(result));
+			vkFreeMemory(VulkanInstance::logical_device(), block.memory, nullptr);
+			return {};
+		}
+	}
+
+	block.free_ranges[0] = block.size;
+
+	// Reuse the slot of a destroyed block so that block indices held by live allocations stay valid
+	for (u32 i = 0; i < memory_pool.blocks.size(); i++) {
+		if (memory_pool.blocks[i].memory == VK_NULL_HANDLE) {
+			memory_pool.blocks[i] = std::move(block);
+			return i;
+		}
+	}
+	memory_pool.blocks.push_back(std::move(block));
+	return memory_pool.blocks.size() - 1;
+}
+
+bool MemoryAllocator::sub_allocate(MemoryBlock &block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &out_offset)
+{
+	// Best fit: the smallest free range that can hold the aligned allocation
+	auto best = block.free_ranges.end();
+	VkDeviceSize best_waste = std::numeric_limits<VkDeviceSize>::max();
+	for (auto it = block.free_ranges.begin(); it != block.free_ranges.end(); it++) {
+		VkDeviceSize aligned_offset = (it->first + alignment - 1) / alignment * alignment;
+		VkDeviceSize padding = aligned_offset - it->first;
+		if (it->second < padding + size)
+			continue;
+		VkDeviceSize waste = it->second - size;
+		if (waste < best_waste) {
+			best = it;
+			best_waste = waste;
+			if (waste == padding)
+				break;
+		}
+	}
+
+	if (best == block.free_ranges.end())
+		return false;
+
+	VkDeviceSize range_offset = best->first;
+	VkDeviceSize range_size = best->second;
+	VkDeviceSize aligned_offset = (range_offset + alignment - 1) / alignment * alignment;
+	block.free_ranges.erase(best);
+
+	// Padding before the allocation and the tail after it go back in the free list
+	if (aligned_offset > range_offset)
+		block.free_ranges[range_offset] = aligned_offset - range_offset;
+	VkDeviceSize end = aligned_offset + size;
+	if (end < range_offset + range_size)
+		block.free_ranges[end] = range_offset + range_size - end;
+
+	block.used += size;
+	block.allocation_count++;
+	out_offset = aligned_offset;
+	return true;
+}
+
+void MemoryAllocator::release_range(MemoryBlock &block, VkDeviceSize offset, VkDeviceSize size)
+{
+	auto inserted = block.free_ranges.emplace(offset, size).first;
+
+	// Coalesce with the following range
+	auto next = std::next(inserted);
+	if (next != block.free_ranges.end() && inserted->first + inserted->second == next->first) {
+		inserted->second += next->second;
+		block.free_ranges.erase(next);
+	}
+
+	// Coalesce with the preceding range
+	if (inserted != block.free_ranges.begin()) {
+		auto previous = std::prev(inserted);
+		if (previous->first + previous->second == inserted->first) {
+			previous->second += inserted->second;
+			block.free_ranges.erase(inserted);
+		}
+	}
+
+	block.used -= size;
+	block.allocation_count--;
+}
+
+void MemoryAllocator::destroy_block(MemoryBlock &block)
+{
+	if (block.memory == VK_NULL_HANDLE)
+		return ;
+
+	if (block.mapped_memory != nullptr)
+		vkUnmapMemory(VulkanInstance::logical_device(), block.memory);
+	vkFreeMemory(VulkanInstance::logical_device(), block.memory, nullptr);
+	block = MemoryBlock{};
+}
+
+} // Vulkan
@@ -0,0 +1,122 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef MEMORYALLOCATOR_H
+#define MEMORYALLOCATOR_H
+
+#include <vulkan/vulkan.h>
+#include <optional>
+#include <vector>
+#include <map>
+#include <mutex>
+#include "defines.h"
+
+namespace Vulkan {
+
+class MemoryAllocator
+{
+public:		// Types
+	enum class ResourceKind
+	{
+		Linear,		// Buffers and linear images
+		Optimal		// Optimally tiled images
+	};
+
+	// A sub-range of a VkDeviceMemory handed out by the allocator
+	struct Allocation
+	{
+		VkDeviceMemory	memory				= VK_NULL_HANDLE;
+		VkDeviceSize	offset				= 0;
+		VkDeviceSize	size				= 0;
+		void			*mapped_memory		= nullptr;
+		u32				memory_type_index	= 0;
+		u32				pool_index			= 0;
+		u32				block_index			= 0;
+		bool			dedicated			= false;
+
+		bool	is_valid()	const	{ return memory != VK_NULL_HANDLE; }
+	};
+
+	struct Statistics
+	{
+		u32				block_count					= 0;
+		u32				dedicated_allocation_count	= 0;
+		u32				allocation_count			= 0;
+		u32				free_range_count			= 0;
+		VkDeviceSize	bytes_reserved				= 0;
+		VkDeviceSize	bytes_used					= 0;
+		VkDeviceSize	bytes_dedicated				= 0;
+		VkDeviceSize	largest_free_range			= 0;
+
+		// 0 when all the free space of the blocks is contiguous, close to 1 when it is scattered in small ranges
+		f32				fragmentation				= 0.0f;
+	};
+
+public:
+	//----
+	// Initialization
+	//----
+	static bool	initialize();
+	static void	shutdown();
+
+	//----
+	// Allocations
+	//----
+	static std::optional<Allocation>	allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+											ResourceKind kind = ResourceKind::Linear);
+	static void							free(Allocation& allocation);
+
+	static std::optional<u32>			find_memory_type(u32 type_filter, VkMemoryPropertyFlags properties);
+
+	//----
+	// Statistics
+	//----
+	static Statistics	get_statistics();
+	static void			log_statistics();
+
+private:	// Types
+	struct MemoryBlock
+	{
+		VkDeviceMemory							memory				= VK_NULL_HANDLE;
+		VkDeviceSize							size				= 0;
+		VkDeviceSize							used				= 0;
+		u32										allocation_count	= 0;
+		void									*mapped_memory		= nullptr;
+
+		// Free ranges of the block, offset -> size, kept coalesced
+		std::map<VkDeviceSize, VkDeviceSize>	free_ranges;
+	};
+
+	struct MemoryPool
+	{
+		u32							memory_type_index	= 0;
+		ResourceKind				kind				= ResourceKind::Linear;
+		VkDeviceSize				block_size			= 0;
+		std::vector<MemoryBlock>	blocks;
+	};
+
+private:	// Methods
+	static u32							pool_index(u32 memory_type_index, ResourceKind kind);
+	static VkDeviceSize					preferred_block_size(u32 memory_type_index);
+	static bool							is_host_visible(u32 memory_type_index);
+
+	static std::optional<Allocation>	allocate_dedicated(VkDeviceSize size, u32 memory_type_index);
+	static std::optional<Allocation>	allocate_from_pool(VkDeviceSize size, VkDeviceSize alignment, u32 pool);
+	static std::optional<u32>			create_block(u32 pool);
+	static bool							sub_allocate(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& out_offset);
+	static void							release_range(MemoryBlock& block, VkDeviceSize offset, VkDeviceSize size);
+	static void							destroy_block(MemoryBlock& block);
+
+private:	// Members
+	static VkPhysicalDeviceMemoryProperties	_memory_properties;
+	static std::vector<MemoryPool>			_pools;
+	static std::mutex						_mutex;
+
+	static u32								_dedicated_allocation_count;
+	static VkDeviceSize						_dedicated_bytes;
+};
+
+} // Vulkan
+
+#endif //MEMORYALLOCATOR_H
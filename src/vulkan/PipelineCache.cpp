@@ -0,0 +1,179 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+#include "PipelineCache.h"
+#include "VulkanInstance.h"
+#include "vulkan_errors.h"
+#include "log.h"
+#include "utils.h"
+
+namespace Vulkan {
+
+VkPipelineCache		PipelineCache::_cache = VK_NULL_HANDLE;
+std::string			PipelineCache::_file_name;
+u64					PipelineCache::_loaded_size = 0;
+u32					PipelineCache::_pipeline_count = 0;
+f64					PipelineCache::_creation_time = 0.0;
+
+bool PipelineCache::initialize(const std::string &file_name)
+{
+	// The same cache is found whichever directory the application is started from
+	const std::string directory = executable_directory();
+	if (file_name.empty() || file_name[0] == '/' || directory.empty())
+		_file_name = file_name;
+	else
+		_file_name = directory + "/" + file_name;
+	_loaded_size = 0;
+	_pipeline_count = 0;
+	_creation_time = 0.0;
+
+	std::vector<char> data = load_file();
+	if (!data.empty() && !is_compatible(data))
+		data.clear();
+
+	VkPipelineCacheCreateInfo create_infos{};
+	create_infos.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	create_infos.initialDataSize = data.size();
+	create_infos.pInitialData = data.empty() ? nullptr : data.data();
+
+	VkResult result = vkCreatePipelineCache(VulkanInstance::logical_device(), &create_infos, nullptr, &_cache);
+	if (result != VK_SUCCESS && !data.empty()) {
+		// The header matched but the driver still refused the contents, starting over is all that's left
+		CORE_WARN("PipelineCache: [%s] was rejected by the driver, starting from an empty cache", _file_name.c_str());
+		data.clear();
+		create_infos.initialDataSize = 0;
+		create_infos.pInitialData = nullptr;
+		result = vkCreatePipelineCache(VulkanInstance::logical_device(), &create_infos, nullptr, &_cache);
+	}
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the pipeline cache: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	_loaded_size = data.size();
+	CORE_TRACE("PipelineCache initialized, %lu bytes loaded from [%s]", _loaded_size, _file_name.c_str());
+	return true;
+}
+
+void PipelineCache::shutdown()
+{
+	if (_cache == VK_NULL_HANDLE)
+		return ;
+
+	save_file();
+	vkDestroyPipelineCache(VulkanInstance::logical_device(), _cache, nullptr);
+	_cache = VK_NULL_HANDLE;
+}
+
+void PipelineCache::record_creation(f64 seconds)
+{
+	_pipeline_count++;
+	_creation_time += seconds;
+}
+
+void PipelineCache::log_statistics()
+{
+	if (_pipeline_count == 0)
+		return ;
+
+	if (is_warm()) {
+		CORE_INFO("PipelineCache: %u pipelines created in %.3f ms from a warm cache (%lu bytes loaded)",
+			_pipeline_count, _creation_time * 1000.0, _loaded_size);
+	} else {
+		CORE_INFO("PipelineCache: %u pipelines created in %.3f ms from a cold cache", _pipeline_count, _creation_time * 1000.0);
+	}
+}
+
+//----
+// File
+//----
+
+std::vector<char> PipelineCache::load_file()
+{
+	// No file is the normal first run, not worth a warning like read_file() would give
+	std::ifstream file(_file_name, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+		return {};
+
+	std::vector<char> data(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(data.data(), static_cast<std::streamsize>(data.size()));
+	if (!file) {
+		CORE_WARN("PipelineCache: couldn't read [%s], starting from an empty cache", _file_name.c_str());
+		return {};
+	}
+	return data;
+}
+
+bool PipelineCache::is_compatible(const std::vector<char> &data)
+{
+	// VkPipelineCacheHeaderVersionOne, read field by field: the file has no alignment to rely on
+	u32 header_size = 0;
+	u32 header_version = 0;
+	u32 vendor_id = 0;
+	u32 device_id = 0;
+	u8 uuid[VK_UUID_SIZE];
+	if (data.size() < 16 + VK_UUID_SIZE) {
+		CORE_WARN("PipelineCache: [%s] is too small to hold a header, ignored", _file_name.c_str());
+		return false;
+	}
+	std::memcpy(&header_size, data.data(), 4);
+	std::memcpy(&header_version, data.data() + 4, 4);
+	std::memcpy(&vendor_id, data.data() + 8, 4);
+	std::memcpy(&device_id, data.data() + 12, 4);
+	std::memcpy(uuid, data.data() + 16, VK_UUID_SIZE);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(VulkanInstance::physical_device(), &properties);
+	if (header_size < 16 + VK_UUID_SIZE || header_size > data.size() || header_version != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+		CORE_WARN("PipelineCache: [%s] has an invalid header, ignored", _file_name.c_str());
+		return false;
+	}
+	// Another GPU, or a driver update: its binaries would at best be ignored by this one
+	if (vendor_id != properties.vendorID || device_id != properties.deviceID
+		|| std::memcmp(uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		CORE_INFO("PipelineCache: [%s] was written by another device or driver, starting from an empty cache", _file_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool PipelineCache::save_file()
+{
+	size_t size = 0;
+	VkResult result = vkGetPipelineCacheData(VulkanInstance::logical_device(), _cache, &size, nullptr);
+	if (result != VK_SUCCESS || size == 0) {
+		CORE_WARN("PipelineCache: couldn't get the cache's size, it isn't saved: %s", vulkan_error_to_string(result));
+		return false;
+	}
+	std::vector<char> data(size);
+	result = vkGetPipelineCacheData(VulkanInstance::logical_device(), _cache, &size, data.data());
+	if (result != VK_SUCCESS) {
+		CORE_WARN("PipelineCache: couldn't get the cache's data, it isn't saved: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	// Written next to the file then renamed over it: readers only ever see the old file or the complete new one
+	const std::string temporary_name = _file_name + ".tmp";
+	FILE *file = fopen(temporary_name.c_str(), "wb");
+	if (file == nullptr) {
+		CORE_WARN("PipelineCache: couldn't open [%s], the cache isn't saved", temporary_name.c_str());
+		return false;
+	}
+	bool written = fwrite(data.data(), 1, size, file) == size && fflush(file) == 0 && fsync(fileno(file)) == 0;
+	written = fclose(file) == 0 && written;
+	if (!written || std::rename(temporary_name.c_str(), _file_name.c_str()) != 0) {
+		CORE_WARN("PipelineCache: couldn't write [%s], the cache isn't saved", _file_name.c_str());
+		std::remove(temporary_name.c_str());
+		return false;
+	}
+	CORE_TRACE("PipelineCache: %lu bytes saved to [%s]", static_cast<u64>(size), _file_name.c_str());
+	return true;
+}
+
+} // Vulkan
@@ -0,0 +1,64 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef PIPELINECACHE_H
+#define PIPELINECACHE_H
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include "defines.h"
+
+namespace Vulkan {
+
+// VkPipelineCache kept on disk between runs, so that pipelines are only compiled from scratch the first time.
+// A file written by another driver or device is ignored: its header must match the physical device's vendor, device
+// and pipelineCacheUUID. The file is replaced atomically on shutdown, a run killed while saving keeps the previous one.
+class PipelineCache
+{
+public:
+	// Next to the executable, wherever it is run from
+	static constexpr const char	*DEFAULT_FILE = "pipeline_cache.bin";
+
+public:
+	//----
+	// Initialization
+	//----
+	// After VulkanInstance, before any pipeline is created. A missing or stale file only means a cold start.
+	// A relative file_name is relative to the executable's directory, or to the working directory if it can't be found
+	static bool	initialize(const std::string& file_name = DEFAULT_FILE);
+	// Saves the cache. The pipelines created with it can already be destroyed, what they compiled stays in it
+	static void	shutdown();
+
+	//----
+	// Statistics
+	//----
+	// Time spent in vkCreate*Pipelines, measured by their callers
+	static void	record_creation(f64 seconds);
+	// Pipelines created so far and how long they took, cold or warm
+	static void	log_statistics();
+
+	//----
+	// Getters
+	//----
+	static VkPipelineCache	cache()			{ return _cache; }
+	static bool				is_warm()		{ return _loaded_size > 0; }
+
+private:	// Methods
+	static std::vector<char>	load_file();
+	static bool					is_compatible(const std::vector<char>& data);
+	static bool					save_file();
+
+private:	// Members
+	static VkPipelineCache		_cache;
+	static std::string			_file_name;
+	static u64					_loaded_size;
+
+	static u32					_pipeline_count;
+	static f64					_creation_time;
+};
+
+} // Vulkan
+
+#endif //PIPELINECACHE_H
@@ -0,0 +1,85 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <cstring>
+#include "ShaderBundle.h"
+#include "log.h"
+
+// Built by the Makefile from every compiled shader, relative to the directory the compiler runs from
+#ifndef SHADER_BUNDLE_PATH
+# define SHADER_BUNDLE_PATH "obj/shaders.bundle"
+#endif
+
+#if defined PLATFORM_MACOS
+# define BUNDLE_SECTION ".const_data"
+# define BUNDLE_SYMBOL(name) "_" #name
+#else
+# define BUNDLE_SECTION ".section .rodata"
+# define BUNDLE_SYMBOL(name) #name
+#endif
+
+// The archive goes in the binary's read-only data, the loader maps it along with the code
+asm(
+	BUNDLE_SECTION "\n"
+	".balign 16\n"
+	".global " BUNDLE_SYMBOL(shader_bundle_begin) "\n"
+	BUNDLE_SYMBOL(shader_bundle_begin) ":\n"
+	".incbin \"" SHADER_BUNDLE_PATH "\"\n"
+	".global " BUNDLE_SYMBOL(shader_bundle_end) "\n"
+	BUNDLE_SYMBOL(shader_bundle_end) ":\n"
+	".text\n"
+);
+
+extern "C" const u8	shader_bundle_begin[];
+extern "C" const u8	shader_bundle_end[];
+
+namespace Vulkan {
+
+const ShaderBundle::Header	*ShaderBundle::_header = nullptr;
+const ShaderBundle::Entry	*ShaderBundle::_entries = nullptr;
+
+bool ShaderBundle::initialize()
+{
+	_header = nullptr;
+	_entries = nullptr;
+
+	const size_t size = static_cast<size_t>(shader_bundle_end - shader_bundle_begin);
+	const Header *header = reinterpret_cast<const Header *>(shader_bundle_begin);
+	if (size < sizeof(Header) || header->magic != MAGIC || header->version != VERSION) {
+		CORE_ERROR("The shader bundle built in isn't one, or of another version: rebuild it");
+		return false;
+	}
+	if (size < sizeof(Header) + static_cast<size_t>(header->shader_count) * sizeof(Entry)) {
+		CORE_ERROR("The shader bundle is truncated");
+		return false;
+	}
+
+	// Validated once here, find() only compares names
+	const Entry *entries = reinterpret_cast<const Entry *>(shader_bundle_begin + sizeof(Header));
+	for (u32 i = 0; i < header->shader_count; i++) {
+		const Entry& entry = entries[i];
+		if (std::memchr(entry.name, '\0', MAX_NAME_LENGTH) == nullptr || entry.offset % 4 != 0 || entry.size % 4 != 0
+			|| entry.offset > size || entry.size > size - entry.offset) {
+			CORE_ERROR("The shader bundle's entry %u is invalid", i);
+			return false;
+		}
+	}
+
+	_header = header;
+	_entries = entries;
+	CORE_TRACE("ShaderBundle initialized with %u shaders, %lu bytes", _header->shader_count, static_cast<u64>(size));
+	return true;
+}
+
+std::optional<ShaderBundle::Shader> ShaderBundle::find(const std::string &name)
+{
+	for (u32 i = 0; i < shader_count(); i++) {
+		if (name == _entries[i].name)
+			return Shader{ reinterpret_cast<const u32 *>(shader_bundle_begin + _entries[i].offset), _entries[i].size };
+	}
+	CORE_ERROR("Shader %s isn't in the shader bundle", name.c_str());
+	return {};
+}
+
+} // Vulkan
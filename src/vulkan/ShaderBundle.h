@@ -0,0 +1,73 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef SHADERBUNDLE_H
+#define SHADERBUNDLE_H
+
+#include <optional>
+#include <string>
+#include "defines.h"
+
+namespace Vulkan {
+
+// Every compiled shader, packed by tools/pack_shaders into a single archive that is assembled into the binary.
+// Shaders are found by the name of their source without .glsl, e.g. "shader.vert", and their SPIR-V words are used in
+// place: loading one reads no file and copies nothing, whatever the working directory.
+class ShaderBundle
+{
+public:	// Types
+	// The archive starts with a header, then shader_count entries, then the SPIR-V of each one
+	struct Header
+	{
+		u32	magic;
+		u32	version;
+		u32	shader_count;
+		u32	reserved;
+	};
+
+	static constexpr u32	MAX_NAME_LENGTH = 56;
+
+	struct Entry
+	{
+		// Null-terminated
+		char	name[MAX_NAME_LENGTH];
+		// In bytes from the start of the archive, a multiple of 4
+		u32		offset;
+		u32		size;
+	};
+
+	struct Shader
+	{
+		const u32	*code;
+		// In bytes, as VkShaderModuleCreateInfo wants it
+		size_t		size;
+	};
+
+	// "SPVB"
+	static constexpr u32	MAGIC = 0x42565053;
+	static constexpr u32	VERSION = 1;
+	// Offset of the SPIR-V of the first shader, and alignment of the archive itself
+	static constexpr u32	DATA_ALIGNMENT = 16;
+
+public:
+	//----
+	// Initialization
+	//----
+	// Checks the archive the binary was built with, find() fails for every shader otherwise
+	static bool	initialize();
+
+	//----
+	// Shaders
+	//----
+	static std::optional<Shader>	find(const std::string& name);
+	static u32						shader_count()	{ return _header != nullptr ? _header->shader_count : 0; }
+
+private:	// Members
+	static const Header	*_header;
+	static const Entry	*_entries;
+};
+
+} // Vulkan
+
+#endif //SHADERBUNDLE_H
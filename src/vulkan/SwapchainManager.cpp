@@ -10,18 +10,40 @@
 #include "log.h"
 #include "VulkanInstance.h"
 #include "GraphicsPipeline.h"
+#include "DeletionQueue.h"
 
 namespace Vulkan {
 
+// Headless, as many images as a swapchain would usually get, in a format every device can render to
+static constexpr u32		OFFSCREEN_IMAGE_COUNT = 3;
+static constexpr VkFormat	OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
 VkSwapchainKHR				SwapchainManager::_swapchain;
 std::vector<VkImage>		SwapchainManager::_swapchain_images;
 std::vector<VkImageView>	SwapchainManager::_swapchain_image_views;
 std::vector<VkFramebuffer>	SwapchainManager::_swapchain_framebuffers;
 VkFormat					SwapchainManager::_swapchain_image_format;
 VkExtent2D					SwapchainManager::_swapchain_extent;
+std::vector<MemoryAllocator::Allocation>	SwapchainManager::_offscreen_allocations;
+u32							SwapchainManager::_next_offscreen_image = 0;
+VkFormat					SwapchainManager::_depth_format = VK_FORMAT_UNDEFINED;
+bool						SwapchainManager::_depth_sampleable = false;
+VkImage						SwapchainManager::_depth_image = VK_NULL_HANDLE;
+VkImageView					SwapchainManager::_depth_image_view = VK_NULL_HANDLE;
+MemoryAllocator::Allocation	SwapchainManager::_depth_allocation;
 
 bool SwapchainManager::initialize()
 {
+	// The format never changes with the swapchain, the render pass is created once with it
+	_depth_format = choose_depth_format();
+	if (_depth_format == VK_FORMAT_UNDEFINED) {
+		CORE_ERROR("The device doesn't support any depth attachment format!");
+		return false;
+	}
+
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(VulkanInstance::physical_device(), _depth_format, &properties);
+	_depth_sampleable = properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
 	return create_swapchain();
 }
 
@@ -32,10 +54,18 @@ void SwapchainManager::shutdown()
 
 bool SwapchainManager::recreate()
 {
-	vkDeviceWaitIdle(VulkanInstance::logical_device());
-	cleanup_swapchain();
+	// A minimized window has no extent to create images for, the old swapchain is kept until it gets one back
+	SwapchainSupportDetails swapchain_support = get_device_swapchain_capabilities(VulkanInstance::physical_device());
+	VkExtent2D extent = choose_swap_extent(swapchain_support.capabilities);
+	if (extent.width == 0 || extent.height == 0)
+		return false;
 
-	if (!create_swapchain()) {
+	// Nothing waits for the device: the frames in flight keep using the old resources, which are deleted once they are done.
+	// The old swapchain is handed to the new one so the presentation engine can reuse its resources
+	VkSwapchainKHR old_swapchain = _swapchain;
+	retire_swapchain();
+
+	if (!create_swapchain(old_swapchain)) {
 		CORE_ERROR("Couldn't to recreate the swapchain");
 		return false;
 	}
@@ -46,8 +76,20 @@ bool SwapchainManager::recreate()
 	return true;
 }
 
+u32 SwapchainManager::acquire_offscreen_image()
+{
+	// The render pass orders the frames writing to the same image, like the depth buffer they share
+	u32 image_index = _next_offscreen_image;
+	_next_offscreen_image = (_next_offscreen_image + 1) % static_cast<u32>(_swapchain_images.size());
+	return image_index;
+}
+
 bool SwapchainManager::is_device_capable(VkPhysicalDevice device)
 {
+	// Offscreen images need no surface
+	if (Window::is_headless())
+		return true;
+
 	SwapchainSupportDetails details = get_device_swapchain_capabilities(device);
 	return !details.formats.empty() && !details.present_modes.empty();
 }
@@ -117,6 +159,25 @@ VkExtent2D SwapchainManager::choose_swap_extent(const VkSurfaceCapabilitiesKHR &
 	}
 }
 
+VkFormat SwapchainManager::choose_depth_format()
+{
+	// Only depth is needed, a stencil aspect is just the fallback. A format that can also be sampled is preferred
+	const VkFormat candidates[] = {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT};
+	const VkFormatFeatureFlags required_features[] = {
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT,
+		VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+	};
+	for (VkFormatFeatureFlags required : required_features) {
+		for (VkFormat format : candidates) {
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(VulkanInstance::physical_device(), format, &properties);
+			if ((properties.optimalTilingFeatures & required) == required)
+				return format;
+		}
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
 void SwapchainManager::create_image_views()
 {
 	swapchain_image_views().resize(swapchain_images().size());
@@ -152,8 +213,9 @@ bool SwapchainManager::create_framebuffers()
 		VkFramebufferCreateInfo create_infos{};
 		create_infos.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
 		create_infos.renderPass = GraphicsPipeline::render_pass();
-		create_infos.attachmentCount = 1;
-		create_infos.pAttachments = &swapchain_image_views()[i];
+		VkImageView attachments[] = {swapchain_image_views()[i], depth_image_view()};
+		create_infos.attachmentCount = 2;
+		create_infos.pAttachments = attachments;
 		create_infos.width = swapchain_extent().width;
 		create_infos.height = swapchain_extent().height;
 		create_infos.layers = 1;
@@ -167,17 +229,127 @@ bool SwapchainManager::create_framebuffers()
 	return true;
 }
 
+bool SwapchainManager::create_depth_resources()
+{
+	VkImageCreateInfo image_infos{};
+	image_infos.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	image_infos.imageType = VK_IMAGE_TYPE_2D;
+	image_infos.format = depth_format();
+	image_infos.extent = {swapchain_extent().width, swapchain_extent().height, 1};
+	image_infos.mipLevels = 1;
+	image_infos.arrayLayers = 1;
+	image_infos.samples = VK_SAMPLE_COUNT_1_BIT;
+	image_infos.tiling = VK_IMAGE_TILING_OPTIMAL;
+	image_infos.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	if (depth_sampleable())
+		image_infos.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+	image_infos.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	image_infos.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(VulkanInstance::logical_device(), &image_infos, nullptr, &_depth_image) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the depth image!");
+		return false;
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(VulkanInstance::logical_device(), _depth_image, &requirements);
+	auto allocation = MemoryAllocator::allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryAllocator::ResourceKind::Optimal);
+	if (!allocation.has_value()) {
+		CORE_ERROR("Couldn't allocate the depth image's memory!");
+		return false;
+	}
+	_depth_allocation = allocation.value();
+	if (vkBindImageMemory(VulkanInstance::logical_device(), _depth_image, _depth_allocation.memory, _depth_allocation.offset) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't bind the depth image's memory!");
+		return false;
+	}
+
+	VkImageViewCreateInfo view_infos{};
+	view_infos.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_infos.image = _depth_image;
+	view_infos.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_infos.format = depth_format();
+	view_infos.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	view_infos.subresourceRange.baseArrayLayer = 0;
+	view_infos.subresourceRange.baseMipLevel = 0;
+	view_infos.subresourceRange.layerCount = 1;
+	view_infos.subresourceRange.levelCount = 1;
+
+	if (vkCreateImageView(VulkanInstance::logical_device(), &view_infos, nullptr, &_depth_image_view) != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the depth image view!");
+		return false;
+	}
+	return true;
+}
+
+void SwapchainManager::destroy_depth_resources()
+{
+	if (_depth_image_view != VK_NULL_HANDLE)
+		vkDestroyImageView(VulkanInstance::logical_device(), _depth_image_view, nullptr);
+	if (_depth_image != VK_NULL_HANDLE)
+		vkDestroyImage(VulkanInstance::logical_device(), _depth_image, nullptr);
+	MemoryAllocator::free(_depth_allocation);
+	_depth_image_view = VK_NULL_HANDLE;
+	_depth_image = VK_NULL_HANDLE;
+}
+
 void SwapchainManager::cleanup_swapchain()
 {
 	for (auto& framebuffer : swapchain_framebuffers())
 		vkDestroyFramebuffer(VulkanInstance::logical_device(), framebuffer, nullptr);
 	for (auto& image_view : swapchain_image_views())
 		vkDestroyImageView(VulkanInstance::logical_device(), image_view, nullptr);
+	destroy_depth_resources();
+
+	// Headless, the images are ours and there is no swapchain, VK_KHR_swapchain isn't even enabled
+	if (Window::is_headless()) {
+		for (auto& image : swapchain_images())
+			vkDestroyImage(VulkanInstance::logical_device(), image, nullptr);
+		for (auto& allocation : _offscreen_allocations)
+			MemoryAllocator::free(allocation);
+		_swapchain_images.clear();
+		_offscreen_allocations.clear();
+		return ;
+	}
 	vkDestroySwapchainKHR(VulkanInstance::logical_device(), swapchain(), nullptr);
 }
 
-bool SwapchainManager::create_swapchain()
+void SwapchainManager::retire_swapchain()
 {
+	// The handles are copied in the deleter, the members are free for the new swapchain right away
+	std::vector<VkFramebuffer> framebuffers = std::move(_swapchain_framebuffers);
+	std::vector<VkImageView> image_views = std::move(_swapchain_image_views);
+	VkImageView depth_image_view = _depth_image_view;
+	VkImage depth_image = _depth_image;
+	MemoryAllocator::Allocation depth_allocation = _depth_allocation;
+	VkSwapchainKHR swapchain = _swapchain;
+	DeletionQueue::push([=]() mutable {
+		for (auto& framebuffer : framebuffers)
+			vkDestroyFramebuffer(VulkanInstance::logical_device(), framebuffer, nullptr);
+		for (auto& image_view : image_views)
+			vkDestroyImageView(VulkanInstance::logical_device(), image_view, nullptr);
+		if (depth_image_view != VK_NULL_HANDLE)
+			vkDestroyImageView(VulkanInstance::logical_device(), depth_image_view, nullptr);
+		if (depth_image != VK_NULL_HANDLE)
+			vkDestroyImage(VulkanInstance::logical_device(), depth_image, nullptr);
+		MemoryAllocator::free(depth_allocation);
+		vkDestroySwapchainKHR(VulkanInstance::logical_device(), swapchain, nullptr);
+	});
+
+	_swapchain_framebuffers.clear();
+	_swapchain_image_views.clear();
+	_swapchain_images.clear();
+	_depth_image_view = VK_NULL_HANDLE;
+	_depth_image = VK_NULL_HANDLE;
+	_depth_allocation = MemoryAllocator::Allocation{};
+	_swapchain = VK_NULL_HANDLE;
+}
+
+bool SwapchainManager::create_swapchain(VkSwapchainKHR old_swapchain)
+{
+	if (Window::is_headless())
+		return create_offscreen_images();
+
 	SwapchainSupportDetails swapchain_support = get_device_swapchain_capabilities(VulkanInstance::physical_device());
 
 	VkSurfaceFormatKHR surface_format = choose_surface_format(swapchain_support.formats);
@@ -214,10 +386,12 @@ bool SwapchainManager::create_swapchain()
 	create_infos.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	create_infos.presentMode = present_mode;
 	create_infos.clipped = VK_TRUE;
-	create_infos.oldSwapchain = VK_NULL_HANDLE;
+	create_infos.oldSwapchain = old_swapchain;
 
+	// The old swapchain is retired even if this fails, its images can't be acquired anymore
 	if (vkCreateSwapchainKHR(VulkanInstance::logical_device(), &create_infos, nullptr, &_swapchain) != VK_SUCCESS) {
 		CORE_ERROR("Couldn't create a swapchain!");
+		_swapchain = VK_NULL_HANDLE;
 		return false;
 	}
 
@@ -228,6 +402,59 @@ bool SwapchainManager::create_swapchain()
 	_swapchain_image_format = surface_format.format;
 
 	create_image_views();
+	if (!create_depth_resources())
+		return false;
+
+	return true;
+}
+
+bool SwapchainManager::create_offscreen_images()
+{
+	_swapchain_extent = {Window::get_width(), Window::get_height()};
+	_swapchain_image_format = OFFSCREEN_FORMAT;
+	_swapchain_images.resize(OFFSCREEN_IMAGE_COUNT, VK_NULL_HANDLE);
+	_offscreen_allocations.resize(OFFSCREEN_IMAGE_COUNT);
+	_next_offscreen_image = 0;
+
+	for (u32 i = 0; i < OFFSCREEN_IMAGE_COUNT; i++) {
+		// Left in TRANSFER_SRC_OPTIMAL by the render passes, ready to be copied out
+		VkImageCreateInfo image_infos{};
+		image_infos.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		image_infos.imageType = VK_IMAGE_TYPE_2D;
+		image_infos.format = OFFSCREEN_FORMAT;
+		image_infos.extent = {_swapchain_extent.width, _swapchain_extent.height, 1};
+		image_infos.mipLevels = 1;
+		image_infos.arrayLayers = 1;
+		image_infos.samples = VK_SAMPLE_COUNT_1_BIT;
+		image_infos.tiling = VK_IMAGE_TILING_OPTIMAL;
+		image_infos.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		image_infos.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		image_infos.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		if (vkCreateImage(VulkanInstance::logical_device(), &image_infos, nullptr, &_swapchain_images[i]) != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create an offscreen image!");
+			return false;
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(VulkanInstance::logical_device(), _swapchain_images[i], &requirements);
+		auto allocation = MemoryAllocator::allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryAllocator::ResourceKind::Optimal);
+		if (!allocation.has_value()) {
+			CORE_ERROR("Couldn't allocate an offscreen image's memory!");
+			return false;
+		}
+		_offscreen_allocations[i] = allocation.value();
+		if (vkBindImageMemory(VulkanInstance::logical_device(), _swapchain_images[i], _offscreen_allocations[i].memory,
+			_offscreen_allocations[i].offset) != VK_SUCCESS) {
+			CORE_ERROR("Couldn't bind an offscreen image's memory!");
+			return false;
+		}
+	}
+	CORE_TRACE("%u offscreen images of %ux%u created", OFFSCREEN_IMAGE_COUNT, _swapchain_extent.width, _swapchain_extent.height);
+
+	create_image_views();
+	if (!create_depth_resources())
+		return false;
 
 	return true;
 }
@@ -7,6 +7,7 @@
 
 #include <vulkan/vulkan.h>
 #include <vector>
+#include "MemoryAllocator.h"
 
 namespace Vulkan {
 
@@ -23,7 +24,11 @@ public:
 	// Swapchains management
 	//----
 	static bool	create_framebuffers();
+	// Doesn't wait for the device, the old swapchain and its resources go to the DeletionQueue.
+	// Fails without touching anything while the window is minimized
 	static bool recreate();
+	// Headless only, in place of acquiring a swapchain image: the offscreen images are rendered into in turn
+	static u32	acquire_offscreen_image();
 
 	//----
 	// Compatibility checks
@@ -39,6 +44,11 @@ public:
 	static std::vector<VkImageView>&	swapchain_image_views()		{ return _swapchain_image_views; }
 	static std::vector<VkFramebuffer>&	swapchain_framebuffers()	{ return _swapchain_framebuffers; }
 	static VkFormat&					swapchain_image_format()	{ return _swapchain_image_format; }
+	// A single depth buffer shared by every swapchain image, the render pass orders the frames using it
+	static VkFormat&					depth_format()				{ return _depth_format; }
+	static VkImageView&					depth_image_view()			{ return _depth_image_view; }
+	// The depth pyramid can only be built from a depth buffer compute shaders can sample
+	static bool							depth_sampleable()			{ return _depth_sampleable; }
 
 private:	// Types
 	struct SwapchainSupportDetails
@@ -57,17 +67,23 @@ private:	// Methods
 	static VkSurfaceFormatKHR		choose_surface_format(const std::vector<VkSurfaceFormatKHR>& available_formats);
 	static VkPresentModeKHR			choose_present_mode(const std::vector<VkPresentModeKHR>& available_modes);
 	static VkExtent2D				choose_swap_extent(const VkSurfaceCapabilitiesKHR& capabilities);
+	static VkFormat					choose_depth_format();
 
 	//----
 	// Swapchain creation and destruction
 	//----
-	static bool						create_swapchain();
+	static bool						create_swapchain(VkSwapchainKHR old_swapchain = VK_NULL_HANDLE);
 	static void						cleanup_swapchain();
+	static void						retire_swapchain();
 
 	//----
 	// Images
 	//----
 	static void	create_image_views();
+	// Headless, images of the window's size standing in for the swapchain's
+	static bool	create_offscreen_images();
+	static bool	create_depth_resources();
+	static void	destroy_depth_resources();
 
 private:	// Members
 	static VkSwapchainKHR				_swapchain;
@@ -76,6 +92,15 @@ private:	// Members
 	static std::vector<VkFramebuffer>	_swapchain_framebuffers;
 	static VkFormat						_swapchain_image_format;
 	static VkExtent2D					_swapchain_extent;
+	// Headless only, the memory of the images the swapchain would own otherwise
+	static std::vector<MemoryAllocator::Allocation>	_offscreen_allocations;
+	static u32							_next_offscreen_image;
+
+	static VkFormat						_depth_format;
+	static bool							_depth_sampleable;
+	static VkImage						_depth_image;
+	static VkImageView					_depth_image_view;
+	static MemoryAllocator::Allocation	_depth_allocation;
 };
 }
 
@@ -0,0 +1,400 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#include <limits>
+#include <cstring>
+#include "TransferContext.h"
+#include "VulkanInstance.h"
+#include "GpuProfiler.h"
+#include "vulkan_errors.h"
+#include "log.h"
+
+namespace Vulkan {
+
+// Number of batches that can be recorded or in flight at the same time
+static constexpr u32			TRANSFER_SLOT_COUNT = 4;
+
+// Size of the persistently mapped staging ring, bigger uploads get their own temporary staging buffer
+static constexpr VkDeviceSize	STAGING_RING_SIZE = 16 * 1024 * 1024;
+static constexpr VkDeviceSize	STAGING_ALIGNMENT = 16;
+
+VkCommandPool						TransferContext::_command_pool = VK_NULL_HANDLE;
+std::vector<TransferContext::TransferSlot>	TransferContext::_slots;
+std::mutex							TransferContext::_mutex;
+
+UploadToken							TransferContext::_next_token = 1;
+std::atomic<UploadToken>			TransferContext::_completed_token(0);
+
+Buffer								TransferContext::_staging_ring;
+VkDeviceSize						TransferContext::_ring_head = 0;
+VkDeviceSize						TransferContext::_ring_tail = 0;
+
+bool TransferContext::initialize()
+{
+	if (!create_command_pool())
+		return false;
+	if (!create_slots())
+		return false;
+	if (!create_staging_ring())
+		return false;
+	CORE_TRACE("TransferContext initialized with %u slots and a %lu bytes staging ring", TRANSFER_SLOT_COUNT, STAGING_RING_SIZE);
+	return true;
+}
+
+void TransferContext::shutdown()
+{
+	// Uploads recorded but never flushed are dropped
+	for (auto& slot : _slots) {
+		if (slot.pending)
+			vkWaitForFences(VulkanInstance::logical_device(), 1, &slot.fence, VK_TRUE, std::numeric_limits<u64>::max());
+		if (slot.fence != VK_NULL_HANDLE)
+			vkDestroyFence(VulkanInstance::logical_device(), slot.fence, nullptr);
+		if (slot.timestamp_query_pool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(VulkanInstance::logical_device(), slot.timestamp_query_pool, nullptr);
+	}
+	_slots.clear();
+	_staging_ring.release_ressources();
+	_ring_head = 0;
+	_ring_tail = 0;
+	_completed_token = _next_token - 1;
+
+	// Command buffers are implicitly freed with their pool
+	if (_command_pool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(VulkanInstance::logical_device(), _command_pool, nullptr);
+		_command_pool = VK_NULL_HANDLE;
+	}
+}
+
+UploadToken TransferContext::upload(const void *data, VkDeviceSize byte_count, VkBuffer dst, VkDeviceSize dst_offset)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (byte_count == 0)
+		return _completed_token;
+
+	VkBufferCopy region{};
+	region.dstOffset = dst_offset;
+	region.size = byte_count;
+
+	VkBuffer src;
+	Buffer temporary_buffer;
+	if (byte_count > STAGING_RING_SIZE) {
+		temporary_buffer = Buffer(byte_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (temporary_buffer.buffer() == VK_NULL_HANDLE) {
+			CORE_ERROR("TransferContext::upload(): couldn't create a staging buffer of %lu bytes", byte_count);
+			return _completed_token;
+		}
+		temporary_buffer.set_data(data, byte_count, 0);
+		src = temporary_buffer.buffer();
+		region.srcOffset = 0;
+	} else {
+		// Reserving may have to flush the current batch to free some space in the ring, so it's done before beginning one
+		VkDeviceSize ring_offset;
+		if (!reserve_ring(byte_count, ring_offset)) {
+			CORE_ERROR("TransferContext::upload(): couldn't reserve %lu bytes in the staging ring", byte_count);
+			return _completed_token;
+		}
+		_staging_ring.set_data(data, byte_count, ring_offset);
+		src = _staging_ring.buffer();
+		region.srcOffset = ring_offset;
+	}
+
+	TransferSlot *slot = begin_batch();
+	if (slot == nullptr)
+		return _completed_token;
+
+	order_after_writes(*slot, src, dst);
+	vkCmdCopyBuffer(slot->command_buffer, src, dst, 1, &region);
+	slot->copy_count++;
+	if (temporary_buffer.buffer() != VK_NULL_HANDLE)
+		slot->temporary_buffers.push_back(std::move(temporary_buffer));
+	return slot->token;
+}
+
+UploadToken TransferContext::flush()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return flush_batch();
+}
+
+void TransferContext::update()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	retire_completed();
+}
+
+bool TransferContext::is_complete(UploadToken token)
+{
+	if (token <= _completed_token.load(std::memory_order_acquire))
+		return true;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (token > _completed_token)
+		retire_completed();
+	return token <= _completed_token;
+}
+
+void TransferContext::wait(UploadToken token)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	wait_for(token);
+}
+
+UploadToken TransferContext::copy_buffer(VkBuffer src, VkBuffer dst, const VkBufferCopy &region)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	TransferSlot *slot = begin_batch();
+	if (slot == nullptr)
+		return _completed_token;
+
+	order_after_writes(*slot, src, dst);
+	vkCmdCopyBuffer(slot->command_buffer, src, dst, 1, &region);
+	slot->copy_count++;
+	return slot->token;
+}
+
+bool TransferContext::create_command_pool()
+{
+	QueueFamilyIndices queue_indices = VulkanInstance::get_queues_for_device(VulkanInstance::physical_device());
+
+	VkCommandPoolCreateInfo pool_create_infos{};
+	pool_create_infos.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_infos.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	pool_create_infos.queueFamilyIndex = queue_indices.graphics_index.value();
+
+	VkResult result = vkCreateCommandPool(VulkanInstance::logical_device(), &pool_create_infos, nullptr, &_command_pool);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't create the TransferContext's command pool: %s", vulkan_error_to_string(result));
+		return false;
+	}
+	return true;
+}
+
+bool TransferContext::create_slots()
+{
+	std::vector<VkCommandBuffer> command_buffers(TRANSFER_SLOT_COUNT);
+
+	VkCommandBufferAllocateInfo alloc_infos{};
+	alloc_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_infos.commandPool = _command_pool;
+	alloc_infos.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	alloc_infos.commandBufferCount = TRANSFER_SLOT_COUNT;
+
+	VkResult result = vkAllocateCommandBuffers(VulkanInstance::logical_device(), &alloc_infos, command_buffers.data());
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't allocate the TransferContext's command buffers: %s", vulkan_error_to_string(result));
+		return false;
+	}
+
+	VkFenceCreateInfo fence_infos{};
+	fence_infos.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	_slots.resize(TRANSFER_SLOT_COUNT);
+	for (u32 i = 0; i < TRANSFER_SLOT_COUNT; i++) {
+		_slots[i].command_buffer = command_buffers[i];
+		result = vkCreateFence(VulkanInstance::logical_device(), &fence_infos, nullptr, &_slots[i].fence);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create the TransferContext's fences: %s", vulkan_error_to_string(result));
+			return false;
+		}
+	}
+
+	if (VulkanInstance::device_features().timestamp_period <= 0.0f)
+		return true;
+	VkQueryPoolCreateInfo query_infos{};
+	query_infos.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	query_infos.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	query_infos.queryCount = 2;
+	for (auto& slot : _slots) {
+		result = vkCreateQueryPool(VulkanInstance::logical_device(), &query_infos, nullptr, &slot.timestamp_query_pool);
+		if (result != VK_SUCCESS) {
+			CORE_ERROR("Couldn't create the TransferContext's query pools: %s", vulkan_error_to_string(result));
+			return false;
+		}
+	}
+	return true;
+}
+
+bool TransferContext::create_staging_ring()
+{
+	_staging_ring = Buffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	if (_staging_ring.buffer() == VK_NULL_HANDLE) {
+		CORE_ERROR("Couldn't create the TransferContext's staging ring");
+		return false;
+	}
+	_ring_head = 0;
+	_ring_tail = 0;
+	return true;
+}
+
+TransferContext::TransferSlot *TransferContext::begin_batch()
+{
+	TransferSlot& slot = current_slot();
+	if (slot.recording)
+		return &slot;
+
+	// The slot was last used by the batch submitted TRANSFER_SLOT_COUNT batches ago, which has to be retired first
+	if (_completed_token + _slots.size() < _next_token)
+		wait_for(_next_token - _slots.size());
+
+	vkResetCommandBuffer(slot.command_buffer, 0);
+
+	VkCommandBufferBeginInfo begin_infos{};
+	begin_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begin_infos.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult result = vkBeginCommandBuffer(slot.command_buffer, &begin_infos);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't begin a transfer command buffer: %s", vulkan_error_to_string(result));
+		return nullptr;
+	}
+	if (slot.timestamp_query_pool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(slot.command_buffer, slot.timestamp_query_pool, 0, 2);
+		vkCmdWriteTimestamp(slot.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.timestamp_query_pool, 0);
+	}
+
+	slot.token = _next_token;
+	slot.recording = true;
+	slot.copy_count = 0;
+	slot.read_buffers.clear();
+	slot.written_buffers.clear();
+	return &slot;
+}
+
+UploadToken TransferContext::flush_batch()
+{
+	TransferSlot& slot = current_slot();
+	if (!slot.recording)
+		return _next_token - 1;
+
+	// Make the copies visible to anything submitted after the batch, be it vertex fetching or another transfer
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+	vkCmdPipelineBarrier(slot.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (slot.timestamp_query_pool != VK_NULL_HANDLE)
+		vkCmdWriteTimestamp(slot.command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.timestamp_query_pool, 1);
+
+	slot.recording = false;
+	slot.ring_end = _ring_head;
+	_next_token++;
+
+	VkResult result = vkEndCommandBuffer(slot.command_buffer);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't record a transfer command buffer: %s", vulkan_error_to_string(result));
+		return slot.token;
+	}
+
+	VkSubmitInfo submit_infos{};
+	submit_infos.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submit_infos.commandBufferCount = 1;
+	submit_infos.pCommandBuffers = &slot.command_buffer;
+
+	// A batch that failed to submit is never pending, it is retired right away and its uploads are lost
+	result = vkQueueSubmit(VulkanInstance::graphics_queue(), 1, &submit_infos, slot.fence);
+	if (result != VK_SUCCESS) {
+		CORE_ERROR("Couldn't submit a transfer command buffer: %s", vulkan_error_to_string(result));
+		return slot.token;
+	}
+	slot.pending = true;
+	CORE_TRACE("TransferContext: submitted batch %lu with %u copies", slot.token, slot.copy_count);
+	return slot.token;
+}
+
+void TransferContext::retire_completed()
+{
+	// Batches go through a single queue, so they are retired in submission order
+	while (_completed_token + 1 < _next_token) {
+		TransferSlot& slot = _slots[(_completed_token + 1) % _slots.size()];
+		if (slot.pending) {
+			if (vkGetFenceStatus(VulkanInstance::logical_device(), slot.fence) != VK_SUCCESS)
+				break;
+			// Fences are only reset once their submission is known to be done, so that a failed submit never deadlocks a slot
+			vkResetFences(VulkanInstance::logical_device(), 1, &slot.fence);
+			slot.pending = false;
+
+			u64 timestamps[2] = {};
+			if (slot.timestamp_query_pool != VK_NULL_HANDLE && vkGetQueryPoolResults(VulkanInstance::logical_device(),
+				slot.timestamp_query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(u64), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+				GpuProfiler::add_time("Uploads", GpuProfiler::ticks_to_milliseconds(timestamps[0], timestamps[1]));
+		}
+		_ring_tail = slot.ring_end;
+		slot.temporary_buffers.clear();
+		_completed_token++;
+	}
+}
+
+void TransferContext::wait_for(UploadToken token)
+{
+	if (token >= _next_token)
+		flush_batch();
+
+	for (UploadToken t = _completed_token + 1; t <= token && t < _next_token; t++) {
+		TransferSlot& slot = _slots[t % _slots.size()];
+		if (slot.pending)
+			vkWaitForFences(VulkanInstance::logical_device(), 1, &slot.fence, VK_TRUE, std::numeric_limits<u64>::max());
+	}
+	retire_completed();
+}
+
+void TransferContext::order_after_writes(TransferSlot& slot, VkBuffer src, VkBuffer dst)
+{
+	// Copies in a batch run in any order, only one reading a buffer an earlier copy wrote to, or writing a buffer an
+	// earlier copy used, has to wait. Whole buffers are tracked, disjoint ranges of the same buffer still get a barrier
+	if (slot.written_buffers.count(src) != 0 || slot.written_buffers.count(dst) != 0 || slot.read_buffers.count(dst) != 0) {
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(slot.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 1, &barrier, 0, nullptr, 0, nullptr);
+		slot.read_buffers.clear();
+		slot.written_buffers.clear();
+	}
+	slot.read_buffers.insert(src);
+	slot.written_buffers.insert(dst);
+}
+
+bool TransferContext::reserve_ring(VkDeviceSize byte_count, VkDeviceSize &out_offset)
+{
+	while (!try_reserve_ring(byte_count, out_offset)) {
+		if (current_slot().recording)
+			flush_batch();
+		else if (_completed_token + 1 < _next_token)
+			wait_for(_completed_token + 1);
+		else
+			return false;
+	}
+	return true;
+}
+
+bool TransferContext::try_reserve_ring(VkDeviceSize byte_count, VkDeviceSize &out_offset)
+{
+	// Nothing lives in the ring anymore, start over from its beginning to avoid wrapping needlessly
+	if (_ring_head == _ring_tail && _completed_token + 1 == _next_token && !current_slot().recording) {
+		_ring_head = 0;
+		_ring_tail = 0;
+	}
+
+	VkDeviceSize offset = _ring_head % STAGING_RING_SIZE;
+	VkDeviceSize padding = (STAGING_ALIGNMENT - offset % STAGING_ALIGNMENT) % STAGING_ALIGNMENT;
+
+	// An upload never straddles the end of the ring, the end is skipped instead
+	if (offset + padding + byte_count > STAGING_RING_SIZE)
+		padding = STAGING_RING_SIZE - offset;
+
+	if (_ring_head + padding + byte_count - _ring_tail > STAGING_RING_SIZE)
+		return false;
+
+	out_offset = (offset + padding) % STAGING_RING_SIZE;
+	_ring_head += padding + byte_count;
+	return true;
+}
+
+} // Vulkan
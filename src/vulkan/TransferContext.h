@@ -0,0 +1,108 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+#ifndef TRANSFERCONTEXT_H
+#define TRANSFERCONTEXT_H
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+#include "defines.h"
+#include "Buffer.h"
+
+namespace Vulkan {
+
+class TransferContext
+{
+public:
+	//----
+	// Initialization
+	//----
+	static bool	initialize();
+	static void	shutdown();
+
+	//----
+	// Uploads
+	//----
+	// Stages byte_count bytes of data in the staging ring and records a copy to dst in the current batch.
+	// Nothing is sent to the GPU until flush() is called, the returned token tells when the data has landed in dst.
+	static UploadToken	upload(const void *data, VkDeviceSize byte_count, VkBuffer dst, VkDeviceSize dst_offset = 0);
+
+	// Submits the current batch if it isn't empty and returns the token of the last submitted batch
+	static UploadToken	flush();
+
+	// Retires every finished batch without blocking
+	static void			update();
+
+	// Lock-free once the token's batch is known to be retired, meshes check it on every draw
+	static bool			is_complete(UploadToken token);
+	static void			wait(UploadToken token);
+
+	//----
+	// Transfers
+	//----
+	// Records a copy from src to dst in the current batch, after every transfer recorded before it that touches the same buffers.
+	// Like upload(), nothing is sent until flush(): both buffers must outlive the returned token
+	static UploadToken	copy_buffer(VkBuffer src, VkBuffer dst, const VkBufferCopy& region);
+
+private:	// Types
+	struct TransferSlot
+	{
+		VkCommandBuffer		command_buffer	= VK_NULL_HANDLE;
+		VkFence				fence			= VK_NULL_HANDLE;
+		UploadToken			token			= 0;
+		bool				recording		= false;
+		bool				pending			= false;
+
+		// Staging ring position once the batch is submitted, the ring tail moves there when it retires
+		VkDeviceSize		ring_end		= 0;
+		u32					copy_count		= 0;
+
+		// Staging buffers of uploads that didn't fit in the ring, released when the batch retires
+		std::vector<Buffer>	temporary_buffers;
+
+		// Sources and destinations of the copies recorded since the last barrier in the batch
+		std::unordered_set<VkBuffer>	read_buffers;
+		std::unordered_set<VkBuffer>	written_buffers;
+
+		// Timestamps around the batch, its GPU time goes to GpuProfiler when it retires. Null without timestamps
+		VkQueryPool			timestamp_query_pool	= VK_NULL_HANDLE;
+	};
+
+private:	// Methods
+	static bool				create_command_pool();
+	static bool				create_slots();
+	static bool				create_staging_ring();
+
+	static TransferSlot&	current_slot()	{ return _slots[_next_token % _slots.size()]; }
+	static TransferSlot*	begin_batch();
+	static UploadToken		flush_batch();
+	static void				retire_completed();
+	static void				wait_for(UploadToken token);
+	static void				order_after_writes(TransferSlot& slot, VkBuffer src, VkBuffer dst);
+
+	static bool				reserve_ring(VkDeviceSize byte_count, VkDeviceSize& out_offset);
+	static bool				try_reserve_ring(VkDeviceSize byte_count, VkDeviceSize& out_offset);
+
+private:	// Members
+	static VkCommandPool				_command_pool;
+	static std::vector<TransferSlot>	_slots;
+	static std::mutex					_mutex;
+
+	// Token of the batch being recorded, and of the last batch known to be finished.
+	// Only written under the mutex, the completed token is also read without it
+	static UploadToken					_next_token;
+	static std::atomic<UploadToken>		_completed_token;
+
+	// Positions in the staging ring only ever grow, the offset in the buffer is position % size
+	static Buffer						_staging_ring;
+	static VkDeviceSize					_ring_head;
+	static VkDeviceSize					_ring_tail;
+};
+
+} // Vulkan
+
+#endif //TRANSFERCONTEXT_H
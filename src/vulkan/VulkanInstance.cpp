@@ -22,6 +22,7 @@ VkPhysicalDevice			VulkanInstance::_physical_device;
 VkDevice					VulkanInstance::_logical_device;
 VkQueue						VulkanInstance::_graphics_queue;
 VkQueue						VulkanInstance::_present_queue;
+DeviceFeatures				VulkanInstance::_device_features;
 
 bool VulkanInstance::initialize()
 {
@@ -348,10 +349,15 @@ QueueFamilyIndices VulkanInstance::get_queues_for_device(VkPhysicalDevice device
 		if (queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT)
 			indices.graphics_index = i;
 
-		VkBool32 present_support = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, Window::get_surface(), &present_support);
-		if (present_support)
-			indices.present_index = i;
+		// Headless there is no surface to present to, the graphics queue stands in for the present queue
+		if (Window::is_headless()) {
+			indices.present_index = indices.graphics_index;
+		} else {
+			VkBool32 present_support = false;
+			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, Window::get_surface(), &present_support);
+			if (present_support)
+				indices.present_index = i;
+		}
 
 		if (indices.is_complete())
 			break;
@@ -378,15 +384,64 @@ bool VulkanInstance::init_logical_device()
 		queues_infos.push_back(queue_info);
 	}
 
-	VkPhysicalDeviceFeatures device_features{};
+	// Query the optional features, and only enable the ones that are supported
+	const bool has_index_type_uint8 = supports_device_extension(physical_device(), VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME);
+	VkPhysicalDeviceIndexTypeUint8FeaturesEXT supported_features_uint8{};
+	supported_features_uint8.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT;
+	VkPhysicalDeviceVulkan12Features supported_features_12{};
+	supported_features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+	supported_features_12.pNext = has_index_type_uint8 ? &supported_features_uint8 : nullptr;
+	VkPhysicalDeviceFeatures2 supported_features{};
+	supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supported_features.pNext = &supported_features_12;
+	vkGetPhysicalDeviceFeatures2(physical_device(), &supported_features);
+
+	_device_features.multi_draw_indirect = supported_features.features.multiDrawIndirect == VK_TRUE;
+	_device_features.draw_indirect_first_instance = supported_features.features.drawIndirectFirstInstance == VK_TRUE;
+	_device_features.draw_indirect_count = supported_features_12.drawIndirectCount == VK_TRUE;
+	_device_features.index_type_uint8 = has_index_type_uint8 && supported_features_uint8.indexTypeUint8 == VK_TRUE;
+	_device_features.pipeline_statistics_query = supported_features.features.pipelineStatisticsQuery == VK_TRUE;
+	_device_features.inherited_queries = supported_features.features.inheritedQueries == VK_TRUE;
+
+	VkPhysicalDeviceProperties properties{};
+	vkGetPhysicalDeviceProperties(physical_device(), &properties);
+	if (properties.limits.timestampComputeAndGraphics == VK_TRUE) {
+		u32 family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device(), &family_count, nullptr);
+		std::vector<VkQueueFamilyProperties> families(family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(physical_device(), &family_count, families.data());
+		_device_features.timestamp_period = properties.limits.timestampPeriod;
+		_device_features.timestamp_valid_bits = families[queues.graphics_index.value()].timestampValidBits;
+	}
+
+	VkPhysicalDeviceIndexTypeUint8FeaturesEXT device_features_uint8{};
+	device_features_uint8.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_INDEX_TYPE_UINT8_FEATURES_EXT;
+	device_features_uint8.indexTypeUint8 = VK_TRUE;
+
+	VkPhysicalDeviceVulkan12Features device_features_12{};
+	device_features_12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_12_FEATURES;
+	device_features_12.pNext = _device_features.index_type_uint8 ? &device_features_uint8 : nullptr;
+	device_features_12.drawIndirectCount = _device_features.draw_indirect_count ? VK_TRUE : VK_FALSE;
+
+	VkPhysicalDeviceFeatures2 device_features{};
+	device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	device_features.pNext = &device_features_12;
+	device_features.features.multiDrawIndirect = _device_features.multi_draw_indirect ? VK_TRUE : VK_FALSE;
+	device_features.features.drawIndirectFirstInstance = _device_features.draw_indirect_first_instance ? VK_TRUE : VK_FALSE;
+	device_features.features.pipelineStatisticsQuery = _device_features.pipeline_statistics_query ? VK_TRUE : VK_FALSE;
+	device_features.features.inheritedQueries = _device_features.inherited_queries ? VK_TRUE : VK_FALSE;
 
 	std::vector<const char*> device_extensions = get_required_device_extensions();
+	if (_device_features.index_type_uint8)
+		device_extensions.push_back(VK_EXT_INDEX_TYPE_UINT8_EXTENSION_NAME);
 
+	// The features are passed through pNext, pEnabledFeatures has to stay null
 	VkDeviceCreateInfo device_infos{};
 	device_infos.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	device_infos.pNext = &device_features;
 	device_infos.pQueueCreateInfos = queues_infos.data();
 	device_infos.queueCreateInfoCount = queues_infos.size();
-	device_infos.pEnabledFeatures = &device_features;
+	device_infos.pEnabledFeatures = nullptr;
 	device_infos.enabledExtensionCount = device_extensions.size();
 	device_infos.ppEnabledExtensionNames = device_extensions.data();
 	device_infos.enabledLayerCount = 0;
@@ -411,7 +466,22 @@ bool VulkanInstance::init_logical_device()
 std::vector<const char *> VulkanInstance::get_required_device_extensions()
 {
 	std::vector<const char*> requirements;
-	requirements.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	if (!Window::is_headless())
+		requirements.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 	return requirements;
 }
+
+bool VulkanInstance::supports_device_extension(VkPhysicalDevice device, const char *extension)
+{
+	u32 extension_count;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
+	std::vector<VkExtensionProperties> available_extensions(extension_count);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, available_extensions.data());
+
+	for (const auto& available_extension : available_extensions) {
+		if (strcmp(available_extension.extensionName, extension) == 0)
+			return true;
+	}
+	return false;
+}
 }
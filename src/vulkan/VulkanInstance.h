@@ -24,6 +24,25 @@ public:
 	bool is_complete() const { return graphics_index.has_value() && present_index.has_value(); }
 };
 
+// Optional device features, enabled when the physical device supports them
+struct DeviceFeatures
+{
+	bool	multi_draw_indirect				= false;
+	bool	draw_indirect_first_instance	= false;
+	bool	draw_indirect_count				= false;
+	// VK_EXT_index_type_uint8, 8-bit index buffers
+	bool	index_type_uint8				= false;
+	// Fragment shader invocation counts, also inside secondary command buffers with inherited_queries
+	bool	pipeline_statistics_query		= false;
+	bool	inherited_queries				= false;
+	// Nanoseconds per timestamp tick, 0 when the graphics and compute queues can't write timestamps
+	f32		timestamp_period				= 0.0f;
+	// Timestamps wrap around past this many bits
+	u32		timestamp_valid_bits			= 0;
+
+	bool	supports_gpu_driven_rendering() const { return multi_draw_indirect && draw_indirect_first_instance && draw_indirect_count; }
+};
+
 class VulkanInstance
 {
 public:
@@ -41,6 +60,7 @@ public:
 	static VkDevice&			logical_device()	{ return _logical_device; }
 	static VkQueue&				graphics_queue()	{ return _graphics_queue; }
 	static VkQueue&				present_queue()		{ return _present_queue; }
+	static const DeviceFeatures&	device_features()	{ return _device_features; }
 
 	static QueueFamilyIndices	get_queues_for_device(VkPhysicalDevice device);
 
@@ -64,6 +84,7 @@ private:	// Methods
 	//----
 	static bool	init_logical_device();
 	static std::vector<const char*>	get_required_device_extensions();
+	static bool						supports_device_extension(VkPhysicalDevice device, const char *extension);
 
 	//----
 	// Debug
@@ -90,6 +111,7 @@ private:	// Members
 	static VkDevice					_logical_device;
 	static VkQueue					_graphics_queue;
 	static VkQueue					_present_queue;
+	static DeviceFeatures			_device_features;
 
 };
 
@@ -0,0 +1,147 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Creates, copies into and destroys 10k buffers through the shared TransferContext, on a headless device, and compares
+// their creation and destruction with buffers that each own a command pool, a command buffer and a fence as they used to.
+// Usage: bench_buffers [BUFFER_COUNT]
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+#include "Window.h"
+#include "utils.h"
+#include "log.h"
+#include "vulkan/VulkanInstance.h"
+#include "vulkan/MemoryAllocator.h"
+#include "vulkan/TransferContext.h"
+#include "vulkan/Buffer.h"
+
+using namespace Vulkan;
+
+static constexpr u32			DEFAULT_BUFFER_COUNT = 10000;
+static constexpr VkDeviceSize	BUFFER_SIZE = 4096;
+
+// The copy objects every Buffer created for itself before TransferContext
+struct CopyObjects
+{
+	VkCommandPool	command_pool	= VK_NULL_HANDLE;
+	VkCommandBuffer	command_buffer	= VK_NULL_HANDLE;
+	VkFence			fence			= VK_NULL_HANDLE;
+};
+
+static bool create_copy_objects(u32 queue_family_index, CopyObjects& objects)
+{
+	VkCommandPoolCreateInfo pool_create_infos{};
+	pool_create_infos.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	pool_create_infos.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	pool_create_infos.queueFamilyIndex = queue_family_index;
+	if (vkCreateCommandPool(VulkanInstance::logical_device(), &pool_create_infos, nullptr, &objects.command_pool) != VK_SUCCESS)
+		return false;
+
+	VkCommandBufferAllocateInfo alloc_infos{};
+	alloc_infos.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	alloc_infos.commandPool = objects.command_pool;
+	alloc_infos.commandBufferCount = 1;
+	alloc_infos.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	if (vkAllocateCommandBuffers(VulkanInstance::logical_device(), &alloc_infos, &objects.command_buffer) != VK_SUCCESS)
+		return false;
+
+	VkFenceCreateInfo fence_infos{};
+	fence_infos.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	return vkCreateFence(VulkanInstance::logical_device(), &fence_infos, nullptr, &objects.fence) == VK_SUCCESS;
+}
+
+static void destroy_copy_objects(CopyObjects& objects)
+{
+	if (objects.fence != VK_NULL_HANDLE)
+		vkDestroyFence(VulkanInstance::logical_device(), objects.fence, nullptr);
+	if (objects.command_buffer != VK_NULL_HANDLE)
+		vkFreeCommandBuffers(VulkanInstance::logical_device(), objects.command_pool, 1, &objects.command_buffer);
+	if (objects.command_pool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(VulkanInstance::logical_device(), objects.command_pool, nullptr);
+	objects = CopyObjects{};
+}
+
+int main(int argc, char **argv)
+{
+	const u32 buffer_count = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_BUFFER_COUNT;
+	if (buffer_count == 0) {
+		std::cerr << "Usage: " << argv[0] << " [BUFFER_COUNT]" << std::endl;
+		return 1;
+	}
+
+	if (!Window::initialize_headless(64, 64) || !VulkanInstance::initialize() || !MemoryAllocator::initialize()
+		|| !TransferContext::initialize())
+		return 1;
+
+	Buffer staging(BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	std::vector<char> data(BUFFER_SIZE, 1);
+	staging.set_data(data.data(), data.size(), 0);
+
+	// Baseline first, so that both runs start from the same empty memory blocks
+	const u32 queue_family_index = VulkanInstance::get_queues_for_device(VulkanInstance::physical_device()).graphics_index.value();
+	std::vector<Buffer> buffers;
+	std::vector<CopyObjects> copy_objects(buffer_count);
+	buffers.reserve(buffer_count);
+	f64 start = get_absolute_time();
+	for (u32 i = 0; i < buffer_count; i++) {
+		buffers.push_back(Buffer::create_vertex_buffer(BUFFER_SIZE, false));
+		if (!create_copy_objects(queue_family_index, copy_objects[i])) {
+			CORE_ERROR("bench_buffers: couldn't create the copy objects of buffer %u", i);
+			return 1;
+		}
+	}
+	const f64 baseline_creation = get_absolute_time() - start;
+
+	start = get_absolute_time();
+	for (u32 i = 0; i < buffer_count; i++) {
+		destroy_copy_objects(copy_objects[i]);
+		buffers[i].release_ressources();
+	}
+	buffers.clear();
+	const f64 baseline_destruction = get_absolute_time() - start;
+
+	start = get_absolute_time();
+	for (u32 i = 0; i < buffer_count; i++)
+		buffers.push_back(Buffer::create_vertex_buffer(BUFFER_SIZE, false));
+	const f64 creation = get_absolute_time() - start;
+	const MemoryAllocator::Statistics statistics = MemoryAllocator::get_statistics();
+
+	// Every copy goes in the same batches, one wait at the end
+	start = get_absolute_time();
+	UploadToken last = 0;
+	for (auto& buffer : buffers)
+		last = staging.copy_to(buffer);
+	TransferContext::wait(last);
+	const f64 batched_copies = get_absolute_time() - start;
+
+	// What every copy_to() used to cost: a submission and a fence round trip each
+	start = get_absolute_time();
+	for (auto& buffer : buffers)
+		TransferContext::wait(staging.copy_to(buffer));
+	const f64 blocking_copies = get_absolute_time() - start;
+
+	start = get_absolute_time();
+	buffers.clear();
+	const f64 destruction = get_absolute_time() - start;
+
+	CORE_INFO("bench_buffers: %u buffers of %lu bytes, %lu bytes of Buffer each", buffer_count, BUFFER_SIZE, sizeof(Buffer));
+	CORE_INFO("bench_buffers: %u memory blocks, old is a command pool, command buffer and fence per buffer", statistics.block_count);
+	CORE_INFO("bench_buffers: created   old %.3f ms (%.2f us each), new %.3f ms (%.2f us each), x%.1f",
+		baseline_creation * 1000.0, baseline_creation * 1000000.0 / buffer_count,
+		creation * 1000.0, creation * 1000000.0 / buffer_count, baseline_creation / creation);
+	CORE_INFO("bench_buffers: destroyed old %.3f ms, new %.3f ms, x%.1f",
+		baseline_destruction * 1000.0, destruction * 1000.0, baseline_destruction / destruction);
+	CORE_INFO("bench_buffers: copied    old %.3f ms waited one by one, new %.3f ms batched, x%.1f",
+		blocking_copies * 1000.0, batched_copies * 1000.0, blocking_copies / batched_copies);
+
+	staging.release_ressources();
+	TransferContext::shutdown();
+	MemoryAllocator::shutdown();
+	VulkanInstance::shutdown();
+	Window::shutdown();
+	return 0;
+}
@@ -0,0 +1,94 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Culls 1M bounding spheres with one sphere per test, then with FrustumCuller on one thread and on the JobSystem.
+// Usage: bench_frustum_culling [SPHERE_COUNT]
+
+#include <iostream>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "utils.h"
+#include "log.h"
+#include "core/JobSystem.h"
+#include "renderer/FrustumCuller.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace Vulkan;
+
+static constexpr u32	DEFAULT_SPHERE_COUNT = 1000000;
+// Best of, the first run also pays for the page faults
+static constexpr u32	RUN_COUNT = 5;
+
+template <typename Function>
+static f64 best_time(Function function)
+{
+	f64 best = 0.0;
+	for (u32 run = 0; run < RUN_COUNT; run++) {
+		const f64 start = get_absolute_time();
+		function();
+		const f64 elapsed = get_absolute_time() - start;
+		if (run == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const u32 sphere_count = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_SPHERE_COUNT;
+	if (sphere_count == 0) {
+		std::cerr << "Usage: " << argv[0] << " [SPHERE_COUNT]" << std::endl;
+		return 1;
+	}
+
+	// Spread around the camera, about a tenth of them end up in the frustum
+	const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	projection[1][1] *= -1;
+	const Frustum frustum = Frustum::from_view_projection(projection * view);
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<f32> position(-400.0f, 400.0f);
+	std::uniform_real_distribution<f32> radius(0.1f, 4.0f);
+	FrustumCuller culler;
+	culler.reserve(sphere_count);
+	std::vector<glm::vec4> spheres(sphere_count);
+	for (auto& sphere : spheres) {
+		sphere = glm::vec4(position(random), position(random), position(random), radius(random));
+		culler.add(glm::vec3(sphere), sphere.w);
+	}
+
+	// What cull() replaces: a scalar test per sphere, as they are stored by the caller
+	std::vector<u8> visibility(sphere_count);
+	u32 scalar_visible = 0;
+	const f64 scalar = best_time([&] {
+		scalar_visible = 0;
+		for (u32 i = 0; i < sphere_count; i++) {
+			visibility[i] = frustum.intersects_sphere(glm::vec3(spheres[i]), spheres[i].w) ? 1 : 0;
+			scalar_visible += visibility[i];
+		}
+	});
+
+	u32 simd_visible = 0;
+	const f64 simd = best_time([&] { simd_visible = culler.cull(frustum); });
+
+	if (!JobSystem::initialize())
+		return 1;
+	u32 parallel_visible = 0;
+	const f64 parallel = best_time([&] { parallel_visible = culler.cull(frustum); });
+	const u32 thread_count = JobSystem::thread_count();
+	JobSystem::shutdown();
+
+	if (simd_visible != scalar_visible || parallel_visible != scalar_visible || culler.visibility() != visibility) {
+		CORE_ERROR("bench_frustum_culling: FrustumCuller kept %u spheres, the scalar test %u", parallel_visible, scalar_visible);
+		return 1;
+	}
+
+	CORE_INFO("bench_frustum_culling: %u spheres, %u visible", sphere_count, scalar_visible);
+	CORE_INFO("bench_frustum_culling: scalar %.3f ms, SIMD %.3f ms (x%.1f), SIMD on %u threads %.3f ms (x%.1f)",
+		scalar * 1000.0, simd * 1000.0, scalar / simd, thread_count, parallel * 1000.0, scalar / parallel);
+	return 0;
+}
@@ -0,0 +1,86 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Runs the same parallel_for over 4M elements with the JobSystem sized from 1 thread up to the hardware concurrency.
+// Usage: bench_job_system [ELEMENT_COUNT]
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "utils.h"
+#include "log.h"
+#include "core/JobSystem.h"
+
+using namespace Vulkan;
+
+static constexpr u32	DEFAULT_ELEMENT_COUNT = 4 * 1024 * 1024;
+static constexpr u32	GRAIN_SIZE = 16384;
+// Best of, the first run also wakes the workers up
+static constexpr u32	RUN_COUNT = 5;
+
+// Enough arithmetic per element that the threads aren't only waiting on memory
+static f32 work(f32 value)
+{
+	for (u32 i = 0; i < 16; i++)
+		value = std::sqrt(value * value + 1.0f) * 0.5f;
+	return value;
+}
+
+int main(int argc, char **argv)
+{
+	const u32 element_count = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_ELEMENT_COUNT;
+	if (element_count == 0) {
+		std::cerr << "Usage: " << argv[0] << " [ELEMENT_COUNT]" << std::endl;
+		return 1;
+	}
+
+	std::vector<f32> input(element_count);
+	for (u32 i = 0; i < element_count; i++)
+		input[i] = static_cast<f32>(i);
+	std::vector<f32> expected(element_count);
+	for (u32 i = 0; i < element_count; i++)
+		expected[i] = work(input[i]);
+
+	// Powers of 2, then the hardware concurrency itself when it isn't one
+	const u32 max_thread_count = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<u32> thread_counts;
+	for (u32 thread_count = 1; thread_count < max_thread_count; thread_count *= 2)
+		thread_counts.push_back(thread_count);
+	thread_counts.push_back(max_thread_count);
+
+	std::vector<f32> output(element_count);
+	f64 single_thread = 0.0;
+	for (u32 thread_count : thread_counts) {
+		if (!JobSystem::initialize(thread_count))
+			return 1;
+
+		f64 best = 0.0;
+		for (u32 run = 0; run < RUN_COUNT; run++) {
+			std::fill(output.begin(), output.end(), 0.0f);
+			const f64 start = get_absolute_time();
+			JobSystem::parallel_for(element_count, GRAIN_SIZE, [&input, &output](u32 first, u32 last) {
+				for (u32 i = first; i < last; i++)
+					output[i] = work(input[i]);
+			});
+			const f64 elapsed = get_absolute_time() - start;
+			if (run == 0 || elapsed < best)
+				best = elapsed;
+		}
+		JobSystem::shutdown();
+
+		if (output != expected) {
+			CORE_ERROR("bench_job_system: parallel_for on %u threads skipped or repeated elements", thread_count);
+			return 1;
+		}
+		if (thread_count == 1)
+			single_thread = best;
+		CORE_INFO("bench_job_system: %u elements on %u threads in %.3f ms (x%.2f)", element_count, thread_count,
+			best * 1000.0, single_thread / best);
+	}
+	return 0;
+}
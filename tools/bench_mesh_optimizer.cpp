@@ -0,0 +1,167 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Runs MeshOptimizer on 1M triangle spheres, as generated and with their triangles and vertices shuffled, and reports
+// the vertex cache before and after along with the time taken per million triangles, for each stage.
+// Usage: bench_mesh_optimizer [RINGS] [SEGMENTS]
+
+#include <iostream>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "utils.h"
+#include "log.h"
+#include "renderer/MeshOptimizer.h"
+#include "glm/gtc/constants.hpp"
+
+using namespace Vulkan;
+
+static constexpr u32	DEFAULT_RINGS = 512;
+static constexpr u32	DEFAULT_SEGMENTS = 1024;
+// Best of, the first run also pays for the page faults
+static constexpr u32	RUN_COUNT = 5;
+
+struct Mesh
+{
+	const char			*name;
+	std::vector<Vertex>	vertices;
+	std::vector<u32>	indices;
+};
+
+// UV sphere, as the application builds it
+static void generate_sphere(u32 rings, u32 segments, std::vector<Vertex>& vertices, std::vector<u32>& indices)
+{
+	for (u32 ring = 0; ring <= rings; ring++) {
+		f32 theta = glm::pi<f32>() * ring / rings;
+		for (u32 segment = 0; segment <= segments; segment++) {
+			f32 phi = 2.0f * glm::pi<f32>() * segment / segments;
+			glm::vec3 normal(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			vertices.emplace_back(normal, normal * 0.5f + 0.5f);
+		}
+	}
+	for (u32 ring = 0; ring < rings; ring++) {
+		for (u32 segment = 0; segment < segments; segment++) {
+			u32 current = ring * (segments + 1) + segment;
+			u32 below = current + segments + 1;
+			if (ring != rings - 1)
+				indices.insert(indices.end(), {current, below, below + 1});
+			if (ring != 0)
+				indices.insert(indices.end(), {current, below + 1, current + 1});
+		}
+	}
+}
+
+// The order of a mesh exported without any care, every triangle and vertex somewhere random
+static void shuffle_mesh(std::vector<Vertex>& vertices, std::vector<u32>& indices)
+{
+	std::mt19937 random(42);
+	const u32 triangle_count = static_cast<u32>(indices.size() / 3);
+	std::vector<u32> triangle_order(triangle_count);
+	std::iota(triangle_order.begin(), triangle_order.end(), 0);
+	std::shuffle(triangle_order.begin(), triangle_order.end(), random);
+	std::vector<u32> vertex_order(vertices.size());
+	std::iota(vertex_order.begin(), vertex_order.end(), 0);
+	std::shuffle(vertex_order.begin(), vertex_order.end(), random);
+
+	std::vector<Vertex> shuffled_vertices(vertices);
+	for (u32 vertex = 0; vertex < vertices.size(); vertex++)
+		shuffled_vertices[vertex_order[vertex]] = vertices[vertex];
+	std::vector<u32> shuffled_indices(indices.size());
+	for (u32 triangle = 0; triangle < triangle_count; triangle++) {
+		for (u32 corner = 0; corner < 3; corner++)
+			shuffled_indices[triangle * 3 + corner] = vertex_order[indices[triangle_order[triangle] * 3 + corner]];
+	}
+	vertices.swap(shuffled_vertices);
+	indices.swap(shuffled_indices);
+}
+
+// Triangles as the positions of their corners, starting from the smallest one so the winding is kept
+static std::vector<std::array<f32, 9>> sorted_triangles(const std::vector<Vertex>& vertices, const std::vector<u32>& indices)
+{
+	std::vector<std::array<f32, 9>> triangles(indices.size() / 3);
+	for (u32 triangle = 0; triangle < triangles.size(); triangle++) {
+		std::array<std::array<f32, 3>, 3> corners;
+		for (u32 corner = 0; corner < 3; corner++) {
+			const glm::vec3& position = vertices[indices[triangle * 3 + corner]].pos;
+			corners[corner] = {position.x, position.y, position.z};
+		}
+		std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+		for (u32 corner = 0; corner < 3; corner++)
+			std::copy(corners[corner].begin(), corners[corner].end(), triangles[triangle].begin() + corner * 3);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Each run works on a fresh copy of the mesh, the copy isn't timed
+template <typename Function>
+static f64 best_time(const Mesh& mesh, std::vector<Vertex>& vertices, std::vector<u32>& indices, Function function)
+{
+	f64 best = 0.0;
+	for (u32 run = 0; run < RUN_COUNT; run++) {
+		vertices = mesh.vertices;
+		indices = mesh.indices;
+		const f64 start = get_absolute_time();
+		function();
+		const f64 elapsed = get_absolute_time() - start;
+		if (run == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const u32 rings = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_RINGS;
+	const u32 segments = argc > 2 ? static_cast<u32>(std::strtoul(argv[2], nullptr, 10)) : DEFAULT_SEGMENTS;
+	if (rings < 2 || segments < 3) {
+		std::cerr << "Usage: " << argv[0] << " [RINGS] [SEGMENTS]" << std::endl;
+		return 1;
+	}
+
+	std::vector<Mesh> meshes(2);
+	meshes[0].name = "sphere";
+	generate_sphere(rings, segments, meshes[0].vertices, meshes[0].indices);
+	meshes[1].name = "shuffled sphere";
+	meshes[1].vertices = meshes[0].vertices;
+	meshes[1].indices = meshes[0].indices;
+	shuffle_mesh(meshes[1].vertices, meshes[1].indices);
+
+	for (const auto& mesh : meshes) {
+		const u32 vertex_count = static_cast<u32>(mesh.vertices.size());
+		const f64 million_triangles = mesh.indices.size() / 3 / 1000000.0;
+		std::vector<Vertex> vertices;
+		std::vector<u32> indices;
+
+		const f64 vertex_cache = best_time(mesh, vertices, indices, [&] {
+			MeshOptimizer::optimize_vertex_cache(indices, vertex_count);
+		});
+		const MeshOptimizer::CacheStatistics tipsify = MeshOptimizer::analyze_vertex_cache(indices, vertex_count);
+
+		const f64 without_overdraw = best_time(mesh, vertices, indices, [&] {
+			MeshOptimizer::optimize(vertices, indices, MeshOptimizer::DEFAULT_CACHE_SIZE, false);
+		});
+
+		MeshOptimizer::Report report;
+		const f64 full = best_time(mesh, vertices, indices, [&] { report = MeshOptimizer::optimize(vertices, indices); });
+
+		if (sorted_triangles(vertices, indices) != sorted_triangles(mesh.vertices, mesh.indices)) {
+			CORE_ERROR("bench_mesh_optimizer: the optimized %s doesn't have the same triangles anymore", mesh.name);
+			return 1;
+		}
+
+		CORE_INFO("bench_mesh_optimizer: %s, %u triangles, %u vertices, %u clusters", mesh.name, report.triangle_count,
+			vertex_count, report.cluster_count);
+		CORE_INFO("bench_mesh_optimizer:   ACMR %.3f -> %.3f (Tipsify alone %.3f), ATVR %.3f -> %.3f (Tipsify alone %.3f)",
+			report.before.acmr, report.after.acmr, tipsify.acmr, report.before.atvr, report.after.atvr, tipsify.atvr);
+		CORE_INFO("bench_mesh_optimizer:   Tipsify %.2f ms/Mtri, without overdraw %.2f ms/Mtri, full pipeline %.2f ms/Mtri",
+			vertex_cache * 1000.0 / million_triangles, without_overdraw * 1000.0 / million_triangles, full * 1000.0 / million_triangles);
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Computes the model matrices of 100k moving objects with the chain of glm calls draw() used to make, then with
+// TransformStore::update(), on one thread and on the JobSystem.
+// Usage: bench_transforms [OBJECT_COUNT]
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "utils.h"
+#include "log.h"
+#include "core/JobSystem.h"
+#include "renderer/TransformStore.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+using namespace Vulkan;
+
+static constexpr u32	DEFAULT_OBJECT_COUNT = 100000;
+// Best of, the first run also pays for the page faults
+static constexpr u32	RUN_COUNT = 5;
+
+template <typename Function>
+static f64 best_time(Function function)
+{
+	f64 best = 0.0;
+	for (u32 run = 0; run < RUN_COUNT; run++) {
+		const f64 start = get_absolute_time();
+		function();
+		const f64 elapsed = get_absolute_time() - start;
+		if (run == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+int main(int argc, char **argv)
+{
+	const u32 object_count = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_OBJECT_COUNT;
+	if (object_count == 0) {
+		std::cerr << "Usage: " << argv[0] << " [OBJECT_COUNT]" << std::endl;
+		return 1;
+	}
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<f32> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<f32> angle(-3.14f, 3.14f);
+	std::uniform_real_distribution<f32> scale(0.5f, 2.0f);
+	std::vector<glm::vec3> positions(object_count), rotations(object_count), scales(object_count);
+	for (u32 i = 0; i < object_count; i++) {
+		positions[i] = glm::vec3(position(random), position(random), position(random));
+		rotations[i] = glm::vec3(angle(random), angle(random), angle(random));
+		scales[i] = glm::vec3(scale(random), scale(random), scale(random));
+	}
+
+	// What every draw(mesh, pos, rot, scale) computed before TransformStore
+	std::vector<glm::mat4> chained(object_count);
+	const f64 chain = best_time([&] {
+		for (u32 i = 0; i < object_count; i++) {
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+			model = glm::rotate(model, rotations[i].z, glm::vec3(0.0f, 0.0f, 1.0f));
+			model = glm::rotate(model, rotations[i].y, glm::vec3(0.0f, 1.0f, 0.0f));
+			model = glm::rotate(model, rotations[i].x, glm::vec3(1.0f, 0.0f, 0.0f));
+			chained[i] = glm::scale(model, scales[i]);
+		}
+	});
+
+	TransformStore store;
+	for (u32 i = 0; i < object_count; i++)
+		store.create(positions[i], glm::quat(1.0f, 0.0f, 0.0f, 0.0f), scales[i]);
+
+	// Every object moves every frame, the setters are timed along with update()
+	auto move_all = [&] {
+		for (u32 i = 0; i < object_count; i++) {
+			store.set_position(i, positions[i]);
+			store.set_rotation(i, rotations[i]);
+			store.set_scale(i, scales[i]);
+		}
+		store.update();
+	};
+	const f64 single_thread = best_time(move_all);
+
+	if (!JobSystem::initialize())
+		return 1;
+	const f64 parallel = best_time(move_all);
+	const u32 thread_count = JobSystem::thread_count();
+	JobSystem::shutdown();
+
+	f32 max_difference = 0.0f;
+	for (u32 i = 0; i < object_count; i++)
+		for (u32 column = 0; column < 4; column++)
+			for (u32 row = 0; row < 4; row++)
+				max_difference = std::max(max_difference, std::abs(chained[i][column][row] - store.matrix(i)[column][row]));
+	if (max_difference > 1e-4f) {
+		CORE_ERROR("bench_transforms: TransformStore is off the glm chain by %g", max_difference);
+		return 1;
+	}
+
+	CORE_INFO("bench_transforms: %u objects, glm chain %.3f ms", object_count, chain * 1000.0);
+	CORE_INFO("bench_transforms: TransformStore %.3f ms (x%.1f), on %u threads %.3f ms (x%.1f), max difference %g",
+		single_thread * 1000.0, chain / single_thread, thread_count, parallel * 1000.0, chain / parallel, max_difference);
+	return 0;
+}
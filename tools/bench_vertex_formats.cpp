@@ -0,0 +1,159 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Uploads the same 1M triangle sphere as full-precision and as quantized vertices on a headless device, and compares
+// the device memory they take and the bytes fetched per draw, with the vertex cache of MeshOptimizer.
+// Usage: bench_vertex_formats [RINGS] [SEGMENTS]
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "Window.h"
+#include "utils.h"
+#include "log.h"
+#include "vulkan/VulkanInstance.h"
+#include "vulkan/MemoryAllocator.h"
+#include "vulkan/TransferContext.h"
+#include "vulkan/Buffer.h"
+#include "renderer/MeshOptimizer.h"
+#include "renderer/Vertex.h"
+#include "glm/gtc/constants.hpp"
+
+using namespace Vulkan;
+
+static constexpr u32	DEFAULT_RINGS = 512;
+static constexpr u32	DEFAULT_SEGMENTS = 1024;
+// Best of, the first run also pays for the page faults
+static constexpr u32	RUN_COUNT = 5;
+
+template <typename Function>
+static f64 best_time(Function function)
+{
+	f64 best = 0.0;
+	for (u32 run = 0; run < RUN_COUNT; run++) {
+		const f64 start = get_absolute_time();
+		function();
+		const f64 elapsed = get_absolute_time() - start;
+		if (run == 0 || elapsed < best)
+			best = elapsed;
+	}
+	return best;
+}
+
+// UV sphere, as the application builds it
+static void generate_sphere(u32 rings, u32 segments, std::vector<Vertex>& vertices, std::vector<u32>& indices)
+{
+	for (u32 ring = 0; ring <= rings; ring++) {
+		f32 theta = glm::pi<f32>() * ring / rings;
+		for (u32 segment = 0; segment <= segments; segment++) {
+			f32 phi = 2.0f * glm::pi<f32>() * segment / segments;
+			glm::vec3 normal(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+			vertices.emplace_back(normal, normal * 0.5f + 0.5f);
+		}
+	}
+	for (u32 ring = 0; ring < rings; ring++) {
+		for (u32 segment = 0; segment < segments; segment++) {
+			u32 current = ring * (segments + 1) + segment;
+			u32 below = current + segments + 1;
+			if (ring != rings - 1)
+				indices.insert(indices.end(), {current, below, below + 1});
+			if (ring != 0)
+				indices.insert(indices.end(), {current, below + 1, current + 1});
+		}
+	}
+}
+
+// Device memory taken by a vertex buffer of byte_count bytes, alignment and block granularity included
+static VkDeviceSize upload_vertex_buffer(const void *data, VkDeviceSize byte_count, Buffer& buffer, f64& upload_time)
+{
+	MemoryAllocator::Statistics statistics = MemoryAllocator::get_statistics();
+	const VkDeviceSize used_before = statistics.bytes_used + statistics.bytes_dedicated;
+	buffer = Buffer::create_vertex_buffer(byte_count, false);
+	const f64 start = get_absolute_time();
+	TransferContext::wait(TransferContext::upload(data, byte_count, buffer.buffer()));
+	upload_time = get_absolute_time() - start;
+	statistics = MemoryAllocator::get_statistics();
+	return statistics.bytes_used + statistics.bytes_dedicated - used_before;
+}
+
+int main(int argc, char **argv)
+{
+	const u32 rings = argc > 1 ? static_cast<u32>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_RINGS;
+	const u32 segments = argc > 2 ? static_cast<u32>(std::strtoul(argv[2], nullptr, 10)) : DEFAULT_SEGMENTS;
+	if (rings < 2 || segments < 3) {
+		std::cerr << "Usage: " << argv[0] << " [RINGS] [SEGMENTS]" << std::endl;
+		return 1;
+	}
+
+	// Optimized like every mesh the renderers upload, vertex fetching follows the triangle order
+	std::vector<Vertex> vertices;
+	std::vector<u32> indices;
+	generate_sphere(rings, segments, vertices, indices);
+	MeshOptimizer::optimize(vertices, indices);
+	const u64 vertex_count = vertices.size();
+	const u64 triangle_count = indices.size() / 3;
+
+	glm::vec3 box_min = vertices[0].pos;
+	glm::vec3 box_max = vertices[0].pos;
+	for (const auto& vertex : vertices) {
+		box_min = glm::min(box_min, vertex.pos);
+		box_max = glm::max(box_max, vertex.pos);
+	}
+	const VertexDequantization dequantization = QuantizedVertex::get_dequantization(box_min, box_max);
+	std::vector<QuantizedVertex> quantized(vertex_count);
+	const f64 quantization = best_time([&] {
+		for (u64 i = 0; i < vertex_count; i++)
+			quantized[i] = QuantizedVertex::quantize(vertices[i], dequantization);
+	});
+
+	// Half a step of the 16-bit grid at most, relative to the half extent of the box
+	f32 max_error = 0.0f;
+	for (u64 i = 0; i < vertex_count; i++) {
+		for (u32 axis = 0; axis < 3; axis++) {
+			const f32 position = dequantization.offset[axis] + quantized[i].pos[axis] / 32767.0f * dequantization.scale[axis];
+			max_error = std::max(max_error, std::abs(position - vertices[i].pos[axis]) / dequantization.scale[axis]);
+		}
+	}
+	if (max_error > 1.0f / 32767.0f) {
+		CORE_ERROR("bench_vertex_formats: quantized positions are off by %g of the box, more than half a step", max_error);
+		return 1;
+	}
+
+	// Every vertex shader invocation fetches a whole vertex, misses of the post-transform cache included
+	const MeshOptimizer::CacheStatistics cache = MeshOptimizer::analyze_vertex_cache(indices, vertex_count);
+	const f64 invocations = static_cast<f64>(cache.acmr) * triangle_count;
+
+	if (!Window::initialize_headless(64, 64) || !VulkanInstance::initialize() || !MemoryAllocator::initialize()
+		|| !TransferContext::initialize())
+		return 1;
+
+	Buffer float_buffer;
+	Buffer quantized_buffer;
+	f64 float_upload = 0.0;
+	f64 quantized_upload = 0.0;
+	const VkDeviceSize float_memory = upload_vertex_buffer(vertices.data(), vertex_count * sizeof(Vertex), float_buffer, float_upload);
+	const VkDeviceSize quantized_memory = upload_vertex_buffer(quantized.data(), vertex_count * sizeof(QuantizedVertex),
+		quantized_buffer, quantized_upload);
+
+	CORE_INFO("bench_vertex_formats: %lu vertices, %lu triangles, ACMR %.3f, %.0f vertex fetches per draw",
+		vertex_count, triangle_count, cache.acmr, invocations);
+	CORE_INFO("bench_vertex_formats: float     %lu bytes per vertex, %.2f MiB of device memory, %.2f MiB fetched per draw, uploaded in %.3f ms",
+		sizeof(Vertex), float_memory / (1024.0 * 1024.0), invocations * sizeof(Vertex) / (1024.0 * 1024.0), float_upload * 1000.0);
+	CORE_INFO("bench_vertex_formats: quantized %lu bytes per vertex, %.2f MiB of device memory, %.2f MiB fetched per draw, uploaded in %.3f ms",
+		sizeof(QuantizedVertex), quantized_memory / (1024.0 * 1024.0), invocations * sizeof(QuantizedVertex) / (1024.0 * 1024.0),
+		quantized_upload * 1000.0);
+	CORE_INFO("bench_vertex_formats: quantized in %.3f ms, x%.2f less memory, max position error %g of the box",
+		quantization * 1000.0, static_cast<f64>(float_memory) / quantized_memory, max_error);
+
+	float_buffer.release_ressources();
+	quantized_buffer.release_ressources();
+	TransferContext::shutdown();
+	MemoryAllocator::shutdown();
+	VulkanInstance::shutdown();
+	Window::shutdown();
+	return 0;
+}
@@ -0,0 +1,111 @@
+//
+// Created by nathan on 10/18/26.
+//
+
+// Packs compiled shaders into the archive read by Vulkan::ShaderBundle.
+// Usage: pack_shaders OUTPUT SHADER.spv...
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "vulkan/ShaderBundle.h"
+
+using Vulkan::ShaderBundle;
+
+static constexpr u32	SPIRV_MAGIC = 0x07230203;
+
+static std::string shader_name(const std::string& path)
+{
+	// obj/shaders/shader.vert.spv is shader.vert
+	std::string name = path.substr(path.find_last_of('/') + 1);
+	if (name.size() > 4 && name.compare(name.size() - 4, 4, ".spv") == 0)
+		name.resize(name.size() - 4);
+	return name;
+}
+
+static bool read_shader(const std::string& path, std::vector<char>& code)
+{
+	std::ifstream file(path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		std::cerr << "pack_shaders: couldn't open " << path << std::endl;
+		return false;
+	}
+	code.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(code.data(), static_cast<std::streamsize>(code.size()));
+
+	u32 magic = 0;
+	if (code.size() >= 4)
+		std::memcpy(&magic, code.data(), 4);
+	if (!file || code.size() % 4 != 0 || magic != SPIRV_MAGIC) {
+		std::cerr << "pack_shaders: " << path << " isn't SPIR-V" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		std::cerr << "Usage: " << argv[0] << " OUTPUT SHADER.spv..." << std::endl;
+		return 1;
+	}
+
+	const u32 shader_count = static_cast<u32>(argc - 2);
+	std::vector<ShaderBundle::Entry> entries(shader_count);
+	std::vector<std::vector<char>> codes(shader_count);
+
+	// The SPIR-V follows the entries, every shader starting on a word
+	u32 offset = sizeof(ShaderBundle::Header) + shader_count * sizeof(ShaderBundle::Entry);
+	offset = (offset + ShaderBundle::DATA_ALIGNMENT - 1) / ShaderBundle::DATA_ALIGNMENT * ShaderBundle::DATA_ALIGNMENT;
+	const u32 data_offset = offset;
+	for (u32 i = 0; i < shader_count; i++) {
+		const std::string path = argv[i + 2];
+		const std::string name = shader_name(path);
+		if (name.size() >= ShaderBundle::MAX_NAME_LENGTH) {
+			std::cerr << "pack_shaders: the name of " << path << " is too long" << std::endl;
+			return 1;
+		}
+		for (u32 j = 0; j < i; j++) {
+			if (name == entries[j].name) {
+				std::cerr << "pack_shaders: two shaders are named " << name << std::endl;
+				return 1;
+			}
+		}
+		if (!read_shader(path, codes[i]))
+			return 1;
+
+		std::memset(entries[i].name, 0, ShaderBundle::MAX_NAME_LENGTH);
+		std::memcpy(entries[i].name, name.c_str(), name.size());
+		entries[i].offset = offset;
+		entries[i].size = static_cast<u32>(codes[i].size());
+		offset += entries[i].size;
+	}
+
+	ShaderBundle::Header header{};
+	header.magic = ShaderBundle::MAGIC;
+	header.version = ShaderBundle::VERSION;
+	header.shader_count = shader_count;
+
+	const std::string output = argv[1];
+	std::ofstream file(output, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ShaderBundle::Entry)));
+	const std::vector<char> padding(data_offset - sizeof(header) - entries.size() * sizeof(ShaderBundle::Entry), 0);
+	file.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+	for (const auto& code : codes)
+		file.write(code.data(), static_cast<std::streamsize>(code.size()));
+	file.close();
+
+	// A partial bundle would only fail once the binary runs
+	if (!file) {
+		std::cerr << "pack_shaders: couldn't write " << output << std::endl;
+		std::remove(output.c_str());
+		return 1;
+	}
+	return 0;
+}